@@ -0,0 +1,778 @@
+/*
+ * host_io.c - ATmega16 Peripheral Models for the Linux-Native Build
+ *
+ * One byte per I/O register (data-space addresses 0x20-0x5F). The firmware
+ * reaches them through host_io_reg(); the access is remembered and its
+ * side effect is committed when the firmware touches the next register,
+ * delays, or an interrupt is taken. By then any read-modify-write on the
+ * register has completed, so the effect sees the final written value.
+ *
+ * Modelled peripherals (only what the firmware uses):
+ *   Timer1 / Timer2  CTC at 1 us per tick, compare-match interrupts, late
+ *                    OCR updates wrap through TOP as on the real counter
+ *   INT0 / INT1      edges from sim_input.c on PD2 / PD3 (when inputs),
+ *                    flagged for edge sense (ISCn1 set), GIFR/GICR
+ *   USART            19200 8N1: RX two-byte FIFO with overrun, TX shifter
+ *                    plus one-byte UDR buffer, RXC and UDRE interrupts
+ *   SPI + LTC1661    16 us per byte, DAC word latched on CS rising edge
+ *   ADC              /128 prescaler (208 us per conversion); inputs come
+ *                    from sim_input.c, PA0 current sense from the FET state
+ *   EEPROM           512 bytes, 8.5 ms write time
+ *   PORTB H-bridge   pulse counts, conduction time, dead time, shoot-through
+ *   PORTC            buttons (PC0 high) or the HD44780 in sim_lcd.c
+ *   Watchdog         reset deadline enforced against virtual time
+ *
+ * Status registers (ADCSRA.ADSC, SPSR.SPIF, EECR.EEWE) stay busy until
+ * their completion time; a poll while busy jumps virtual time forward to
+ * completion, firing any interrupts due on the way.
+ */
+
+#include "host_io.h"
+#include "sim.h"
+#include "sim_input.h"
+#include "sim_lcd.h"
+#include "MK312BT_Constants.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Register addresses (data space), mirrored from avr_registers.h */
+#define A_ADCL   0x24
+#define A_ADCH   0x25
+#define A_ADCSRA 0x26
+#define A_ADMUX  0x27
+#define A_UBRRL  0x29
+#define A_UCSRB  0x2A
+#define A_UCSRA  0x2B
+#define A_UDR    0x2C
+#define A_SPCR   0x2D
+#define A_SPSR   0x2E
+#define A_SPDR   0x2F
+#define A_DDRD   0x31
+#define A_PORTD  0x32
+#define A_PINC   0x33
+#define A_DDRC   0x34
+#define A_PORTC  0x35
+#define A_DDRB   0x37
+#define A_PORTB  0x38
+#define A_EECR   0x3C
+#define A_EEDR   0x3D
+#define A_EEARL  0x3E
+#define A_EEARH  0x3F
+#define A_WDTCR  0x41
+#define A_OCR2   0x43
+#define A_TCNT2  0x44
+#define A_TCCR2  0x45
+#define A_OCR1AL 0x4A
+#define A_OCR1AH 0x4B
+#define A_TCNT1L 0x4C
+#define A_TCNT1H 0x4D
+#define A_TCCR1B 0x4E
+#define A_TCNT0  0x52
+#define A_MCUCR  0x55
+#define A_TIMSK  0x59
+#define A_GIFR   0x5A
+#define A_GICR   0x5B
+#define A_SREG   0x5F
+
+#define REG_COUNT 0x60
+
+#define SREG_I      0x80
+#define TIMSK_OCIE2 0x80
+#define TIMSK_OCIE1A 0x10
+#define GICR_INT0   0x40        /* Same bits in GIFR (INTF0/INTF1) */
+#define GICR_INT1   0x80
+#define UCSRB_RXCIE 0x80
+#define UCSRB_UDRIE 0x20
+#define UCSRB_RXEN  0x10
+#define UCSRA_RXC   0x80
+#define UCSRA_UDRE  0x20
+#define ADCSRA_ADEN 0x80
+#define ADCSRA_ADSC 0x40
+#define SPSR_SPIF   0x80
+#define SPCR_SPE    0x40
+#define EECR_EERE   0x01
+#define EECR_EEWE   0x02
+#define EECR_EEMWE  0x04
+
+#define UART_BYTE_US    521     /* 10 bits at 19200 baud */
+#define SPI_BYTE_US     16      /* 8 bits at F_CPU/16 */
+#define EEPROM_WRITE_US 8500
+#define STALL_LIMIT     50000000UL  /* Register accesses without time moving */
+
+#define NEVER UINT64_MAX
+
+/* Interrupt vectors. Weak so a firmware without a given ISR still links. */
+extern void INT0_vect(void) __attribute__((weak));
+extern void INT1_vect(void) __attribute__((weak));
+extern void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern void TIMER2_COMP_vect(void) __attribute__((weak));
+extern void USART_RXC_vect(void) __attribute__((weak));
+extern void USART_UDRE_vect(void) __attribute__((weak));
+
+static uint8_t reg[REG_COUNT];
+static uint8_t shadow[REG_COUNT];   /* Value as of the last commit */
+static int     pending = -1;        /* Register accessed last, not yet committed */
+static uint64_t now_us;
+static uint32_t stall;
+static uint8_t  in_isr;             /* Nesting depth, 0 = main line */
+static uint8_t  in_rx_isr;
+
+static host_io_stats_t stats;
+static host_io_output_fn output_fn;
+static uint32_t digest = 2166136261u;
+
+/* ---- Timers ---------------------------------------------------------- */
+
+typedef struct {
+    uint8_t  running;
+    uint8_t  flag;          /* Compare-match flag (OCF) */
+    uint32_t top;           /* 0xFFFF or 0xFF */
+    uint64_t zero_us;       /* Time at which TCNT was 0 */
+    uint64_t next_us;       /* Next compare match */
+    uint64_t flag_us;       /* When the pending flag was raised */
+} sim_timer_t;
+
+static sim_timer_t t1, t2;
+
+static uint16_t ocr1a(void) { return (uint16_t)(reg[A_OCR1AH] << 8) | reg[A_OCR1AL]; }
+
+/* Next time TCNT equals ocr, counting from zero_us and wrapping at top. */
+static void timer_schedule(sim_timer_t *t, uint16_t ocr) {
+    uint64_t period = (uint64_t)t->top + 1;
+    uint64_t first = t->zero_us + ocr;
+    if (!t->running) {
+        t->next_us = NEVER;
+        return;
+    }
+    if (first < now_us) {
+        /* OCR written after the counter passed it: wait for the wrap */
+        first += ((now_us - first + period - 1) / period) * period;
+    }
+    t->next_us = first;
+}
+
+static void note_latency(const sim_timer_t *t) {
+    if (now_us - t->flag_us > stats.isr_late_us_max)
+        stats.isr_late_us_max = now_us - t->flag_us;
+}
+
+static uint16_t timer_count(const sim_timer_t *t) {
+    if (!t->running || now_us < t->zero_us) return 0;
+    return (uint16_t)((now_us - t->zero_us) % ((uint64_t)t->top + 1));
+}
+
+/* ---- USART ----------------------------------------------------------- */
+
+static uint8_t  rx_fifo[2];
+static uint8_t  rx_count;
+static uint64_t tx_shift_end;       /* Shifter busy until */
+static uint8_t  tx_buf, tx_buf_full;
+static uint8_t  udre_stuck;         /* UDRE ISR returned without progress */
+
+/* ---- SPI / DAC ------------------------------------------------------- */
+
+static uint64_t spi_done;
+static uint8_t  dac_bytes[2];
+static uint8_t  dac_nbytes;
+static uint16_t dac_input[2], dac_output[2];   /* Physical DAC A, B */
+
+/* ---- ADC / EEPROM / watchdog ---------------------------------------- */
+
+static uint64_t adc_done;
+static uint64_t ee_done;
+static uint8_t  ee_mwe;             /* EEMWE seen on the previous EECR write */
+static uint8_t  eeprom[512];
+
+static uint8_t  wdt_on;
+static uint16_t wdt_ms;
+static uint64_t wdt_kick;
+
+/* ---- H-bridge -------------------------------------------------------- */
+
+typedef struct {
+    uint8_t  pos_bit, neg_bit;
+    uint8_t  state;         /* bit0 = pos on, bit1 = neg on */
+    uint64_t since;         /* Time of the last state change */
+    uint64_t off_since;     /* Time both FETs last went off */
+    uint8_t  last_on;       /* 1 = pos, 2 = neg, 0 = none yet */
+    uint64_t pulse_edge;    /* Time the last pulse started, 0 = none */
+    uint64_t period;        /* Last pulse-to-pulse time inside a group */
+    uint32_t burst_len;     /* Pulses in the current group */
+} sim_leg_t;
+
+static sim_leg_t leg[2];
+
+/* ---------------------------------------------------------------------- */
+
+static void hash_event(uint64_t us, uint8_t kind, uint16_t a, uint16_t b) {
+    uint8_t buf[13];
+    uint8_t i;
+    memcpy(buf, &us, 8);
+    buf[8] = kind;
+    buf[9] = (uint8_t)a;
+    buf[10] = (uint8_t)(a >> 8);
+    buf[11] = (uint8_t)b;
+    buf[12] = (uint8_t)(b >> 8);
+    for (i = 0; i < sizeof(buf); i++) {
+        digest ^= buf[i];
+        digest *= 16777619u;
+    }
+}
+
+static void emit(uint8_t kind, uint16_t a, uint16_t b) {
+    hash_event(now_us, kind, a, b);
+    if (output_fn) output_fn(now_us, kind, a, b);
+}
+
+static void hw_set(uint8_t addr, uint8_t v) {
+    reg[addr] = v;
+    shadow[addr] = v;
+}
+
+static void service_interrupts(void);
+
+/* ---- Effects of a committed access ----------------------------------- */
+
+/* A turn-on after the bridge was off this long starts a new pulse; the
+ * turn-on after a dead time is the second half-cycle of the same pulse */
+#define PULSE_START_OFF_US  8
+
+/* Split the pulses into groups: a gap over 1.5 times the last
+ * period ends one. Gate timers and pulse-count bursts both show up here.
+ * After a gap longer than any pulse period (output stopped, e.g. after the
+ * power-on FET test) the period is learned again. */
+static void burst_edge(sim_leg_t *l, host_io_bridge_t *s, uint64_t period) {
+    if (l->period && period > l->period + l->period / 2) {
+        if (s->bursts == 0 || l->burst_len < s->burst_min) s->burst_min = l->burst_len;
+        if (l->burst_len > s->burst_max) s->burst_max = l->burst_len;
+        s->burst_hist[l->burst_len < HOST_IO_BURST_HIST ? l->burst_len : HOST_IO_BURST_HIST - 1]++;
+        s->bursts++;
+        l->burst_len = 0;
+        if (period > 0xFFFF) l->period = 0;
+    } else {
+        l->period = period;
+    }
+}
+
+static void bridge_update(uint8_t portb) {
+    uint8_t n;
+    for (n = 0; n < 2; n++) {
+        sim_leg_t *l = &leg[n];
+        host_io_bridge_t *s = &stats.bridge[n];
+        uint8_t st = (uint8_t)(((portb >> l->pos_bit) & 1) | (((portb >> l->neg_bit) & 1) << 1));
+        if (st == l->state) continue;
+
+        if (l->state & 1) s->on_us_pos += now_us - l->since;
+        if (l->state & 2) s->on_us_neg += now_us - l->since;
+        if (l->state && !st && output_fn) {
+            uint64_t width = now_us - l->since;
+            output_fn(now_us, HOST_IO_OUT_WIDTH, n | (l->state == 2 ? HOST_IO_OUT_NEG : 0),
+                      width > 0xFFFF ? 0xFFFF : (uint16_t)width);
+        }
+        if (st == 3) s->shoot_through++;
+
+        if (st && l->state == 0 && (!l->pulse_edge || now_us - l->off_since >= PULSE_START_OFF_US)) {
+            /* Observed only: pulse edges are already in the digest */
+            if (l->pulse_edge && output_fn) {
+                uint64_t period = now_us - l->pulse_edge;
+                output_fn(now_us, HOST_IO_OUT_PULSE, n, period > 0xFFFF ? 0xFFFF : (uint16_t)period);
+            }
+            if (l->pulse_edge) burst_edge(l, s, now_us - l->pulse_edge);
+            l->burst_len++;
+            l->pulse_edge = now_us;
+        }
+        if ((st & 1) && !(l->state & 1)) {
+            s->pulses_pos++;
+            if (l->state == 0 && l->last_on == 2 && now_us - l->off_since < s->min_dead_us)
+                s->min_dead_us = now_us - l->off_since;
+            l->last_on = 1;
+        }
+        if ((st & 2) && !(l->state & 2)) {
+            s->pulses_neg++;
+            if (l->state == 0 && l->last_on == 1 && now_us - l->off_since < s->min_dead_us)
+                s->min_dead_us = now_us - l->off_since;
+            l->last_on = 2;
+        }
+        if (st == 0) l->off_since = now_us;
+        l->state = st;
+        l->since = now_us;
+        hash_event(now_us, 0x80 | n, st, 0);
+    }
+}
+
+/* LTC1661 word: [cmd:4][data:10][x:2]. Physical DAC B drives logical A. */
+static void dac_latch(void) {
+    uint16_t word = (uint16_t)(dac_bytes[0] << 8) | dac_bytes[1];
+    uint8_t cmd = word >> 12;
+    uint16_t val = (word >> 2) & 0x3FF;
+    uint8_t i;
+
+    if (cmd == (DAC_CMD_LOAD_A >> 4) || cmd == (DAC_CMD_LOUPA >> 4)) dac_input[0] = val;
+    if (cmd == (DAC_CMD_LOAD_B >> 4) || cmd == (DAC_CMD_LOUPB >> 4)) dac_input[1] = val;
+    if (cmd == (DAC_CMD_UPDATE >> 4) || cmd == (DAC_CMD_LOUPA >> 4) ||
+        cmd == (DAC_CMD_LOUPB >> 4)) {
+        for (i = 0; i < 2; i++) {
+            if (dac_output[i] == dac_input[i]) continue;
+            dac_output[i] = dac_input[i];
+            stats.dac_value[1 - i] = dac_output[i];
+            emit(HOST_IO_OUT_DAC, 1 - i, dac_output[i]);
+        }
+    }
+    stats.dac_writes++;
+}
+
+static void uart_tx_start(uint8_t b) {
+    tx_shift_end = now_us + UART_BYTE_US;
+    stats.tx_bytes++;
+    emit(HOST_IO_OUT_TX, b, 0);
+}
+
+static void uart_write(uint8_t b) {
+    udre_stuck = 0;
+    if (tx_shift_end <= now_us) {
+        uart_tx_start(b);
+    } else {
+        /* Writing while UDRE is clear overwrites the buffer, as on the chip */
+        tx_buf = b;
+        tx_buf_full = 1;
+    }
+}
+
+static void commit(uint8_t a) {
+    uint8_t old = shadow[a], v = reg[a];
+    shadow[a] = v;
+
+    switch (a) {
+        case A_SPDR:
+            /* Every access is a transfer: the firmware only writes SPDR */
+            hw_set(A_SPSR, reg[A_SPSR] & ~SPSR_SPIF);
+            spi_done = now_us + SPI_BYTE_US;
+            if (!(reg[A_PORTD] & (1 << DAC_CS_LD)) && dac_nbytes < 2)
+                dac_bytes[dac_nbytes++] = v;
+            break;
+
+        case A_UDR:
+            if (!in_rx_isr) uart_write(v);
+            break;
+
+        case A_PORTD:
+            if (!(old & (1 << DAC_CS_LD)) && (v & (1 << DAC_CS_LD)) && dac_nbytes == 2)
+                dac_latch();
+            if ((old & (1 << DAC_CS_LD)) && !(v & (1 << DAC_CS_LD)))
+                dac_nbytes = 0;
+            break;
+
+        case A_PORTB:
+            bridge_update(v);
+            break;
+
+        case A_PORTC: {
+            int lcd = sim_lcd_portc(now_us, old, v);
+            if ((old & (1 << LCD_E_BIT)) && !(v & (1 << LCD_E_BIT)))
+                stats.lcd_strobes++;
+            if (lcd >= 0) emit(HOST_IO_OUT_LCD, (uint16_t)lcd >> 8, (uint16_t)lcd & 0xFF);
+            break;
+        }
+
+        case A_ADCSRA:
+            if ((v & (ADCSRA_ADEN | ADCSRA_ADSC)) == (ADCSRA_ADEN | ADCSRA_ADSC) &&
+                adc_done <= now_us) {
+                uint8_t ch = reg[A_ADMUX] & 0x07;
+                uint16_t div = (uint16_t)(2u << ((v & 0x07) ? (v & 0x07) - 1 : 0));
+                uint16_t val;
+                if (ch == 0) {
+                    /* Current sense: quiescent offset plus load current
+                     * whenever a FET conducts */
+                    val = (leg[0].state || leg[1].state) ? 220 : 20;
+                } else {
+                    val = sim_input_adc(ch);
+                }
+                if (val > 1023) val = 1023;
+                hw_set(A_ADCL, (uint8_t)val);
+                hw_set(A_ADCH, (uint8_t)(val >> 8));
+                adc_done = now_us + (13u * div + (F_CPU / 1000000UL) - 1) / (F_CPU / 1000000UL);
+                stats.adc_conversions++;
+            }
+            break;
+
+        case A_EECR: {
+            uint16_t addr = (uint16_t)((reg[A_EEARH] << 8) | reg[A_EEARL]) & 0x1FF;
+            if (v & EECR_EERE) {
+                hw_set(A_EEDR, eeprom[addr]);
+                v &= ~EECR_EERE;
+            }
+            if ((v & EECR_EEWE) && !(old & EECR_EEWE) && (ee_mwe || (v & EECR_EEMWE))) {
+                eeprom[addr] = reg[A_EEDR];
+                ee_done = now_us + EEPROM_WRITE_US;
+                stats.eeprom_writes++;
+                emit(HOST_IO_OUT_EEPROM, addr, reg[A_EEDR]);
+            }
+            ee_mwe = (v & EECR_EEMWE) != 0;
+            hw_set(A_EECR, v & ~EECR_EEMWE);
+            if (ee_done <= now_us) hw_set(A_EECR, reg[A_EECR] & ~EECR_EEWE);
+            break;
+        }
+
+        case A_TCNT1L:
+            t1.zero_us = now_us - (uint16_t)((reg[A_TCNT1H] << 8) | v);
+            timer_schedule(&t1, ocr1a());
+            break;
+        case A_TCNT2:
+            t2.zero_us = now_us - v;
+            timer_schedule(&t2, reg[A_OCR2]);
+            break;
+        case A_OCR1AL:
+            timer_schedule(&t1, ocr1a());
+            break;
+        case A_OCR2:
+            timer_schedule(&t2, v);
+            break;
+        case A_TCCR1B:
+            if ((v & 0x07) && !t1.running) {
+                t1.running = 1;
+                t1.zero_us = now_us - timer_count(&t1);
+            } else if (!(v & 0x07)) {
+                t1.running = 0;
+            }
+            timer_schedule(&t1, ocr1a());
+            break;
+        case A_TCCR2:
+            if ((v & 0x07) && !t2.running) {
+                t2.running = 1;
+                t2.zero_us = now_us - timer_count(&t2);
+            } else if (!(v & 0x07)) {
+                t2.running = 0;
+            }
+            timer_schedule(&t2, reg[A_OCR2]);
+            break;
+
+        case A_WDTCR:
+            if (v == 0) wdt_on = 0;
+            break;
+
+        case A_UCSRB:
+            udre_stuck = 0;
+            service_interrupts();
+            break;
+        case A_TIMSK:
+        case A_GICR:
+            service_interrupts();
+            break;
+        case A_GIFR:
+            hw_set(A_GIFR, old & ~v);           /* Writing 1 clears a flag */
+            break;
+        case A_SREG:
+            if ((v & SREG_I) && !(old & SREG_I)) service_interrupts();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Refresh input and status registers just before the firmware reads them. */
+static void prepare(uint8_t a) {
+    switch (a) {
+        case A_PINC: {
+            uint8_t ddr = reg[A_DDRC], port = reg[A_PORTC];
+            uint8_t in = port | ~ddr;          /* Inputs float high (pull-ups) */
+            if (port & (1 << BUTTON_ACTIVATE_BIT)) {
+                in &= ~(uint8_t)(sim_input_buttons() << 4) | ddr;
+            } else if ((port & (1 << LCD_RW_BIT)) && (port & (1 << LCD_E_BIT))) {
+                /* LCD drives DB7..4: busy flag and address counter */
+                in = (uint8_t)((in & (ddr | 0x0F)) | (sim_lcd_read(now_us) & ~ddr));
+            }
+            hw_set(A_PINC, (uint8_t)((port & ddr) | (in & ~ddr)));
+            break;
+        }
+        case A_UCSRA:
+            hw_set(A_UCSRA, (uint8_t)((rx_count ? UCSRA_RXC : 0) | (tx_buf_full ? 0 : UCSRA_UDRE)));
+            break;
+        case A_ADCSRA:
+            if (adc_done > now_us) host_io_advance(adc_done - now_us);
+            hw_set(A_ADCSRA, reg[A_ADCSRA] & ~ADCSRA_ADSC);
+            break;
+        case A_SPSR:
+            if (spi_done > now_us) host_io_advance(spi_done - now_us);
+            if (spi_done && (reg[A_SPCR] & SPCR_SPE)) hw_set(A_SPSR, reg[A_SPSR] | SPSR_SPIF);
+            break;
+        case A_EECR:
+            if (ee_done > now_us) host_io_advance(ee_done - now_us);
+            hw_set(A_EECR, reg[A_EECR] & ~EECR_EEWE);
+            break;
+        case A_TCNT0:
+            hw_set(A_TCNT0, sim_input_seed(0));
+            break;
+        case A_TCNT1L:
+            hw_set(A_TCNT1L, t1.running ? (uint8_t)timer_count(&t1) : sim_input_seed(1));
+            break;
+        case A_TCNT2:
+            hw_set(A_TCNT2, (uint8_t)timer_count(&t2));
+            break;
+        default:
+            break;
+    }
+}
+
+void host_io_flush(void) {
+    if (pending >= 0) {
+        uint8_t a = (uint8_t)pending;
+        pending = -1;
+        commit(a);
+    }
+}
+
+volatile uint8_t *host_io_reg(uint8_t addr) {
+    if (addr >= REG_COUNT) sim_fatal("access to unmapped I/O address 0x%02X", addr);
+    if (++stall > STALL_LIMIT)
+        sim_fatal("firmware spinning on I/O 0x%02X without time advancing", addr);
+    host_io_flush();
+    prepare(addr);
+    pending = addr;
+    return &reg[addr];
+}
+
+/* ---- Interrupt dispatch ---------------------------------------------- */
+
+static void run_isr(void (*isr)(void), uint64_t *counter) {
+    uint8_t sreg = reg[A_SREG];
+    uint8_t rx = in_rx_isr;
+    host_io_flush();
+    hw_set(A_SREG, sreg & ~SREG_I);
+    if (in_isr) stats.isr_nested++;
+    in_isr++;
+    in_rx_isr = (counter == &stats.isr_rx);
+    (*counter)++;
+    if (isr) isr();
+    host_io_flush();
+    in_isr--;
+    in_rx_isr = rx;
+    hw_set(A_SREG, reg[A_SREG] | SREG_I);   /* RETI */
+}
+
+static void service_interrupts(void) {
+    /* Re-entered from commit() when an ISR sets I: the pending interrupt
+     * preempts it, as on the chip. Each ISR masks its own source first. */
+    while (reg[A_SREG] & SREG_I) {
+        /* Priority order = ATmega16 vector order */
+        if ((reg[A_GIFR] & GICR_INT0) && (reg[A_GICR] & GICR_INT0)) {
+            hw_set(A_GIFR, reg[A_GIFR] & ~GICR_INT0);
+            run_isr(INT0_vect, &stats.isr_int0);
+        } else if ((reg[A_GIFR] & GICR_INT1) && (reg[A_GICR] & GICR_INT1)) {
+            hw_set(A_GIFR, reg[A_GIFR] & ~GICR_INT1);
+            run_isr(INT1_vect, &stats.isr_int1);
+        } else if (t2.flag && (reg[A_TIMSK] & TIMSK_OCIE2)) {
+            t2.flag = 0;
+            note_latency(&t2);
+            run_isr(TIMER2_COMP_vect, &stats.isr_timer2);
+            timer_schedule(&t2, reg[A_OCR2]);
+        } else if (t1.flag && (reg[A_TIMSK] & TIMSK_OCIE1A)) {
+            t1.flag = 0;
+            note_latency(&t1);
+            run_isr(TIMER1_COMPA_vect, &stats.isr_timer1);
+            timer_schedule(&t1, ocr1a());
+        } else if (rx_count && (reg[A_UCSRB] & UCSRB_RXCIE)) {
+            hw_set(A_UDR, rx_fifo[0]);
+            run_isr(USART_RXC_vect, &stats.isr_rx);
+            rx_fifo[0] = rx_fifo[1];
+            rx_count--;
+        } else if (!tx_buf_full && !udre_stuck && (reg[A_UCSRB] & UCSRB_UDRIE)) {
+            uint64_t before = stats.tx_bytes;
+            uint8_t was_full = tx_buf_full;
+            run_isr(USART_UDRE_vect, &stats.isr_udre);
+            if (stats.tx_bytes == before && tx_buf_full == was_full &&
+                (reg[A_UCSRB] & UCSRB_UDRIE))
+                udre_stuck = 1;     /* Would re-enter forever on hardware */
+        } else {
+            break;
+        }
+    }
+}
+
+void host_io_sei(void) {
+    host_io_flush();
+    hw_set(A_SREG, reg[A_SREG] | SREG_I);
+    service_interrupts();
+}
+
+void host_io_cli(void) {
+    host_io_flush();
+    hw_set(A_SREG, reg[A_SREG] & ~SREG_I);
+}
+
+/* ---- Time ------------------------------------------------------------ */
+
+static void timer_match(sim_timer_t *t, uint16_t ocr) {
+    t->zero_us = t->next_us + 1;        /* CTC clears on the next tick */
+    if (!t->flag) t->flag_us = t->next_us;   /* A match while pending is lost */
+    t->flag = 1;
+    t->next_us = t->zero_us + ocr;
+}
+
+/* Edge on INTn (pin 0 = PD2, 1 = PD3). A pin driven as output ignores it.
+ * Every edge counts for falling or rising sense; level and any-change
+ * sense are not modelled. */
+static void ext_edge(uint8_t pin) {
+    if (reg[A_DDRD] & (1 << (2 + pin))) return;
+    if (!(reg[A_MCUCR] & (2 << (2 * pin)))) return;
+    hw_set(A_GIFR, reg[A_GIFR] | (pin ? GICR_INT1 : GICR_INT0));
+}
+
+void host_io_advance(uint64_t us) {
+    uint64_t target = now_us + us;
+
+    host_io_flush();
+    stall = 0;
+    for (;;) {
+        uint64_t t = NEVER;
+        uint64_t rx_at = sim_input_next_rx_us();
+        uint64_t edge_at = sim_input_next_edge_us();
+        uint8_t src = 0;
+
+        if (t1.next_us < t) { t = t1.next_us; src = 1; }
+        if (t2.next_us < t) { t = t2.next_us; src = 2; }
+        if (rx_at < t)      { t = rx_at; src = 3; }
+        if (tx_buf_full && tx_shift_end < t) { t = tx_shift_end; src = 4; }
+        if (sim_input_next_screen_us() < t) { t = sim_input_next_screen_us(); src = 5; }
+        if (edge_at < t)    { t = edge_at; src = 6; }
+        if (t > target) break;
+        if (t > now_us) now_us = t;
+
+        switch (src) {
+            case 1: timer_match(&t1, ocr1a()); break;
+            case 2: timer_match(&t2, reg[A_OCR2]); break;
+            case 3: {
+                uint8_t b = sim_input_take_rx();
+                if (!(reg[A_UCSRB] & UCSRB_RXEN) || rx_count == 2) {
+                    stats.rx_overruns++;
+                } else {
+                    rx_fifo[rx_count++] = b;
+                    stats.rx_bytes++;
+                }
+                break;
+            }
+            case 4:
+                tx_buf_full = 0;
+                uart_tx_start(tx_buf);
+                break;
+            case 5:
+                sim_input_take_screen();
+                break;
+            case 6:
+                ext_edge(sim_input_take_edge());
+                break;
+        }
+        service_interrupts();
+    }
+    now_us = target;
+
+    if (wdt_on && now_us - wdt_kick > (uint64_t)wdt_ms * 1000u)
+        sim_fatal("watchdog reset: no wdt_reset() for %u ms", wdt_ms);
+}
+
+void host_io_delay_us(double us) {
+    if (us < 0) us = 0;
+    host_io_advance((uint64_t)(us + 0.5));
+}
+
+uint64_t host_io_now_us(void) {
+    return now_us;
+}
+
+/* Arduino core time base, 32-bit wrap as on the target */
+unsigned long millis(void) {
+    return (uint32_t)(now_us / 1000u);
+}
+
+unsigned long micros(void) {
+    return (uint32_t)now_us;
+}
+
+void host_io_wdt_enable(uint16_t timeout_ms) {
+    wdt_on = 1;
+    wdt_ms = timeout_ms;
+    wdt_kick = now_us;
+}
+
+void host_io_wdt_disable(void) {
+    wdt_on = 0;
+}
+
+void host_io_wdt_reset(void) {
+    wdt_kick = now_us;
+}
+
+/* ---- Arduino pin API ------------------------------------------------- */
+
+int host_io_digital_read(uint8_t pin) {
+    if (pin >= 16 && pin < 24) return (*host_io_reg(A_PINC) >> (pin - 16)) & 1;
+    if (pin < 8)  return (*host_io_reg(A_PORTB) >> pin) & 1;
+    if (pin < 16) return (*host_io_reg(A_PORTD) >> (pin - 8)) & 1;
+    return 0;
+}
+
+/* Same register sequence as fastAnalogRead() / the Arduino core */
+int host_io_analog_read(uint8_t pin) {
+    uint8_t ch = (pin >= 24) ? pin - 24 : pin;
+    uint8_t lo, hi;
+    *host_io_reg(A_ADMUX) = ADC_VREF_AVCC | (ch & 0x07);
+    *host_io_reg(A_ADCSRA) |= ADCSRA_ADSC;
+    while (*host_io_reg(A_ADCSRA) & ADCSRA_ADSC) { }
+    lo = *host_io_reg(A_ADCL);
+    hi = *host_io_reg(A_ADCH);
+    return (hi << 8) | lo;
+}
+
+/* ---- Simulator interface --------------------------------------------- */
+
+void host_io_reset(void) {
+    memset(reg, 0, sizeof(reg));
+    memset(shadow, 0, sizeof(shadow));
+    memset(&stats, 0, sizeof(stats));
+    memset(&t1, 0, sizeof(t1));
+    memset(&t2, 0, sizeof(t2));
+    memset(leg, 0, sizeof(leg));
+    pending = -1;
+    now_us = 0;
+    in_isr = in_rx_isr = 0;
+    t1.top = 0xFFFF;
+    t2.top = 0xFF;
+    t1.next_us = t2.next_us = NEVER;
+    rx_count = 0;
+    tx_shift_end = 0;
+    tx_buf_full = udre_stuck = 0;
+    spi_done = adc_done = ee_done = 0;
+    dac_nbytes = 0;
+    wdt_on = 0;
+    leg[0].pos_bit = HBRIDGE_CH_A_POS;
+    leg[0].neg_bit = HBRIDGE_CH_A_NEG;
+    leg[1].pos_bit = HBRIDGE_CH_B_POS;
+    leg[1].neg_bit = HBRIDGE_CH_B_NEG;
+    stats.bridge[0].min_dead_us = stats.bridge[1].min_dead_us = NEVER;
+    hw_set(A_UCSRA, UCSRA_UDRE);
+    sim_lcd_reset();
+    digest = 2166136261u;
+}
+
+const host_io_stats_t *host_io_stats(void) {
+    uint8_t n;
+    /* Close out conduction time up to now */
+    for (n = 0; n < 2; n++) {
+        if (leg[n].state & 1) stats.bridge[n].on_us_pos += now_us - leg[n].since;
+        if (leg[n].state & 2) stats.bridge[n].on_us_neg += now_us - leg[n].since;
+        leg[n].since = now_us;
+    }
+    return &stats;
+}
+
+uint8_t *host_io_eeprom(void) {
+    return eeprom;
+}
+
+uint32_t host_io_digest(void) {
+    return digest;
+}
+
+void host_io_set_output(host_io_output_fn fn) {
+    output_fn = fn;
+}
@@ -0,0 +1,93 @@
+/*
+ * host_io.h - Register File and Clock of the Linux-Native Build
+ *
+ * avr_registers.h maps every I/O register to host_io_reg() when the
+ * firmware is compiled with MK312BT_HOST_BUILD. The simulator keeps one
+ * byte per register and applies the hardware side effect of an access
+ * (ADC conversion, SPI shift, EEPROM strobe, timer start, ...) when the
+ * firmware moves on to the next register, so "REG |= bit" read-modify-write
+ * sequences behave as on the ATmega16.
+ *
+ * Time is virtual: a 64-bit microsecond counter that only moves at delays,
+ * peripheral waits and the per-loop cost set by the driver (sim_main.c).
+ * Interrupts fire at exact virtual instants, which makes every run with the
+ * same inputs bit-for-bit identical.
+ */
+
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---- Firmware-facing interface (via avr_registers.h and shims) ---- */
+
+volatile uint8_t *host_io_reg(uint8_t addr);
+void host_io_sei(void);
+void host_io_cli(void);
+
+void host_io_delay_us(double us);     /* _delay_us / _delay_ms / delay */
+uint64_t host_io_now_us(void);        /* millis() / micros() source */
+
+void host_io_wdt_enable(uint16_t timeout_ms);
+void host_io_wdt_disable(void);
+void host_io_wdt_reset(void);
+
+int  host_io_digital_read(uint8_t pin);
+int  host_io_analog_read(uint8_t pin);
+
+/* ---- Simulator-facing interface ---- */
+
+void host_io_reset(void);
+void host_io_flush(void);                 /* Commit the pending register access */
+void host_io_advance(uint64_t us);        /* Run time forward, firing interrupts */
+
+/* Peripheral statistics and output capture, reported by sim_main.c */
+#define HOST_IO_BURST_HIST 65
+typedef struct {
+    uint64_t pulses_pos, pulses_neg;      /* FET turn-on edges */
+    uint64_t on_us_pos, on_us_neg;        /* Accumulated conduction time */
+    uint64_t shoot_through;               /* Both FETs of one leg on at once */
+    uint64_t min_dead_us;                 /* Shortest pos->neg / neg->pos gap */
+    uint64_t bursts;                      /* Pulse groups ended by a gap > 1.5 periods */
+    uint32_t burst_min, burst_max;        /* Pulses per group */
+    uint32_t burst_hist[HOST_IO_BURST_HIST];  /* Groups per length, last = longer */
+} host_io_bridge_t;
+
+typedef struct {
+    uint64_t isr_timer1, isr_timer2, isr_rx, isr_udre, isr_int0, isr_int1;
+    uint64_t isr_late_us_max;             /* Worst delay from flag to ISR */
+    uint64_t isr_nested;                  /* ISRs that preempted another ISR */
+    uint64_t rx_bytes, rx_overruns, tx_bytes;
+    uint64_t dac_writes, eeprom_writes, adc_conversions, lcd_strobes;
+    host_io_bridge_t bridge[2];           /* [0] = A (PB0/PB1), [1] = B (PB2/PB3) */
+    uint16_t dac_value[2];                /* Last value latched per logical channel */
+} host_io_stats_t;
+
+const host_io_stats_t *host_io_stats(void);
+uint8_t *host_io_eeprom(void);            /* 512-byte EEPROM image */
+uint32_t host_io_digest(void);            /* FNV-1a over every output event */
+
+/* Output observer: called for TX bytes, DAC latches, EEPROM writes, LCD
+ * bytes (a = RS, b = byte), each pulse start (a = leg, b = us since the
+ * previous one, saturating) and the end of each half-cycle (a = leg, plus
+ * HOST_IO_OUT_NEG for a negative one, b = its width in us). kind is one of
+ * the HOST_IO_OUT_* values. */
+#define HOST_IO_OUT_TX      1
+#define HOST_IO_OUT_DAC     2
+#define HOST_IO_OUT_EEPROM  3
+#define HOST_IO_OUT_PULSE   4
+#define HOST_IO_OUT_LCD     5
+#define HOST_IO_OUT_WIDTH   6
+#define HOST_IO_OUT_NEG     0x100
+typedef void (*host_io_output_fn)(uint64_t us, uint8_t kind, uint16_t a, uint16_t b);
+void host_io_set_output(host_io_output_fn fn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
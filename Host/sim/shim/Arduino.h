@@ -0,0 +1,55 @@
+/*
+ * Arduino.h - Host shim for the Linux-native build
+ *
+ * The subset of the Arduino core MK312BT.ino uses, backed by host_io.c.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "host_io.h"
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void setup(void);
+void loop(void);
+
+unsigned long millis(void);     /* host_io.c; serial.c declares it too */
+unsigned long micros(void);
+static inline void delay(unsigned long ms) { host_io_delay_us(ms * 1000.0); }
+static inline void delayMicroseconds(unsigned int us) { host_io_delay_us(us); }
+static inline int digitalRead(uint8_t pin) { return host_io_digital_read(pin); }
+static inline int analogRead(uint8_t pin) { return host_io_analog_read(pin); }
+static inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+static inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+#endif
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#endif
@@ -0,0 +1,7 @@
+/* avr/interrupt.h - Host shim: ISRs become plain functions host_io calls */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+#include <avr/io.h>
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define ISR_NOBLOCK
+#endif
@@ -0,0 +1,5 @@
+/* avr/io.h - Host shim: the firmware's own register map, routed to host_io */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+#include "avr_registers.h"
+#endif
@@ -0,0 +1,16 @@
+/* avr/pgmspace.h - Host shim: flash and RAM share one address space */
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+#include <stdint.h>
+#include <string.h>
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(const void *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)   (*(void * const *)(p))
+#define memcpy_P  memcpy
+#define strcpy_P  strcpy
+#define strlen_P  strlen
+#define strncpy_P strncpy
+#endif
@@ -0,0 +1,16 @@
+/* avr/wdt.h - Host shim: watchdog deadline checked in virtual time */
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+#include "host_io.h"
+#define WDTO_15MS  0
+#define WDTO_30MS  1
+#define WDTO_60MS  2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S    6
+#define WDTO_2S    7
+#define wdt_enable(to) host_io_wdt_enable((uint16_t)(16u << (to)))
+#define wdt_disable()  host_io_wdt_disable()
+#define wdt_reset()    host_io_wdt_reset()
+#endif
@@ -0,0 +1,7 @@
+/* util/delay.h - Host shim: busy-wait delays advance virtual time */
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+#include "host_io.h"
+#define _delay_us(us) host_io_delay_us((double)(us))
+#define _delay_ms(ms) host_io_delay_us((double)(ms) * 1000.0)
+#endif
@@ -0,0 +1,30 @@
+/*
+ * sim.h - Linux-Native Simulator Driver
+ *
+ * Shared by host_io.c and sim_input.c; implemented in sim_main.c.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Stop the run with a diagnostic (watchdog, stall, bad input). The driver
+ * still prints its summary and closes the session log. */
+void sim_fatal(const char *fmt, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+/* Firmware entry points (MK312BT.ino) and the monotonic engine counters */
+void setup(void);
+void loop(void);
+uint32_t param_engine_get_tick_total(void);
+uint32_t param_engine_get_subtick_total(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,556 @@
+/*
+ * sim_input.c - Scenario Scripts, Session Recorder and Replayer
+ *
+ * Scenario script, one action per line (times in ms, may be fractional):
+ *
+ *   <t> knob A|B|MA <adc>           level pots (PA4, PA5) / Multi-Adjust (PA1)
+ *   <t> battery <adc>               12 V divider (PA3)
+ *   <t> adc <ch> <adc>              any ADC channel 1-7
+ *   <t> audio A|B sine <hz> <amp>   half-wave rectified tone (PA7 / PA6)
+ *   <t> audio A|B off
+ *   <t> edges A|B <hz> [<jitter>]   falling edges on PD3/INT1 (A) or PD2/INT0
+ *                                   (B), each moved by up to +-jitter us
+ *   <t> edges A|B off
+ *   <t> press MENU|UP|OK|DOWN <ms>  hold a button
+ *   <t> seed <tcnt0> <tcnt1l>       power-on timer values
+ *   <t> serial <hex> ...            raw bytes, back to back at 19200 baud
+ *   <t> frame <hex> ...             same, with the legacy checksum appended
+ *   <t> screen                      print the LCD contents to stdout
+ *   <t> end                         stop the run
+ *
+ * Unless disabled, OK is held for the first 100 ms the firmware spends
+ * reading buttons, which answers the "press any key" prompt at startup.
+ *
+ * In replay mode the session log (format in sim_input.h) replaces the
+ * script: each logged value becomes visible at exactly the virtual time it
+ * was sampled when recording. An event whose time or tick does not match
+ * the replaying firmware is counted as a divergence.
+ */
+
+#include "sim_input.h"
+#include "sim.h"
+#include "host_io.h"
+#include "sim_lcd.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UART_BYTE_US   521
+#define AUTOSTART_US   100000u
+#define BTN_OK_BIT     1          /* PC5 */
+#define NEVER          UINT64_MAX
+#define MAX_REPORTED_DIVERGENCES 5
+
+enum { EV_ADC, EV_AUDIO, EV_PRESS, EV_RELEASE, EV_BUTTONS, EV_SEED, EV_RX, EV_END, EV_SCREEN,
+       EV_EDGES, EV_EDGE };
+
+typedef struct {
+    uint64_t at;        /* Virtual us (or 0 when tick-keyed) */
+    uint32_t tick;      /* Logged engine tick */
+    uint8_t  kind;
+    uint8_t  ch;
+    uint16_t value;
+    double   hz, amp;
+} sim_event_t;
+
+typedef struct {
+    sim_event_t *v;
+    size_t n, cap, pos;
+} sim_queue_t;
+
+static sim_queue_t timed;       /* State changes by time */
+static sim_queue_t ticked;      /* State changes by engine tick */
+static sim_queue_t rx;          /* Serial bytes by arrival time */
+static sim_queue_t screens;     /* LCD snapshots by time */
+static sim_queue_t edges;       /* Replay: INT0/INT1 edges by time */
+
+static uint8_t  replay;
+static uint8_t  autostart = 1;
+static uint8_t  autostart_started;
+static uint64_t autostart_at;
+static uint64_t end_us = NEVER;
+static uint64_t rx_tail_us;
+static uint32_t divergences;
+
+/* Current input state */
+static uint16_t adc_val[8] = { 0, 512, 800, 800, 0, 0, 0, 0 };
+static uint8_t  audio_on[8];
+static double   audio_hz[8], audio_amp[8];
+static uint8_t  press_count[4];
+static uint8_t  edge_on[2];     /* Scenario edge streams, [pin] */
+static double   edge_period[2], edge_jitter[2], edge_ideal[2];
+static uint64_t edge_at[2];
+static uint32_t edge_rng = 0x2545F491u;
+static uint8_t  button_mask;    /* Replay: observed mask */
+static uint8_t  seed_val[2];
+
+/* Recorder */
+static FILE    *rec;
+static uint16_t rec_adc[8];
+static uint16_t rec_buttons;
+static uint16_t rec_seed[2];
+
+/* ---------------------------------------------------------------------- */
+
+static void queue_push(sim_queue_t *q, const sim_event_t *e) {
+    if (q->n == q->cap) {
+        q->cap = q->cap ? q->cap * 2 : 256;
+        q->v = realloc(q->v, q->cap * sizeof(*q->v));
+        if (!q->v) sim_fatal("out of memory");
+    }
+    q->v[q->n++] = *e;
+}
+
+static int cmp_at(const void *a, const void *b) {
+    const sim_event_t *x = a, *y = b;
+    if (x->at != y->at) return x->at < y->at ? -1 : 1;
+    return (x->tick > y->tick) - (x->tick < y->tick);
+}
+
+/* Stable sort by time: insertion order breaks ties */
+static void queue_sort(sim_queue_t *q) {
+    size_t i;
+    for (i = 0; i < q->n; i++) q->v[i].tick = (uint32_t)i;
+    qsort(q->v, q->n, sizeof(*q->v), cmp_at);
+}
+
+static uint32_t tick_now(void) {
+    return param_engine_get_tick_total();
+}
+
+static void diverged(const char *what, const sim_event_t *e) {
+    if (++divergences <= MAX_REPORTED_DIVERGENCES) {
+        fprintf(stderr, "replay: %s logged at %llu us tick %lu, seen at %llu us tick %lu\n",
+                what, (unsigned long long)e->at, (unsigned long)e->tick,
+                (unsigned long long)host_io_now_us(), (unsigned long)tick_now());
+    }
+}
+
+/* Next edge of a stream: the ideal time plus uniform jitter, in order */
+static void edge_schedule(uint8_t pin) {
+    double j = 0;
+    uint64_t at;
+    edge_ideal[pin] += edge_period[pin];
+    if (edge_jitter[pin] > 0) {
+        edge_rng ^= edge_rng << 13;
+        edge_rng ^= edge_rng >> 17;
+        edge_rng ^= edge_rng << 5;
+        j = ((double)edge_rng / 4294967295.0 * 2.0 - 1.0) * edge_jitter[pin];
+    }
+    at = (uint64_t)(edge_ideal[pin] + j + 0.5);
+    if (at <= edge_at[pin]) at = edge_at[pin] + 1;
+    if (at < host_io_now_us()) at = host_io_now_us();
+    edge_at[pin] = at;
+}
+
+static void apply(const sim_event_t *e) {
+    switch (e->kind) {
+        case EV_ADC:     adc_val[e->ch] = e->value; audio_on[e->ch] = 0; break;
+        case EV_AUDIO:
+            audio_on[e->ch] = e->amp > 0;
+            audio_hz[e->ch] = e->hz;
+            audio_amp[e->ch] = e->amp;
+            break;
+        case EV_PRESS:   press_count[e->ch]++; break;
+        case EV_RELEASE: if (press_count[e->ch]) press_count[e->ch]--; break;
+        case EV_BUTTONS: button_mask = (uint8_t)e->value; break;
+        case EV_SEED:    seed_val[e->ch] = (uint8_t)e->value; break;
+        case EV_RX: {
+            sim_event_t r = *e;
+            r.at = host_io_now_us();
+            r.tick = tick_now();
+            queue_push(&rx, &r);
+            break;
+        }
+        case EV_END:     end_us = host_io_now_us(); break;
+        case EV_EDGES:
+            edge_on[e->ch] = e->hz > 0;
+            if (e->hz > 0) {
+                edge_period[e->ch] = 1e6 / e->hz;
+                edge_jitter[e->ch] = e->amp;
+                edge_ideal[e->ch] = (double)e->at;
+                edge_at[e->ch] = e->at;
+                edge_schedule(e->ch);
+            }
+            break;
+    }
+}
+
+/* Apply every timed or tick-keyed event that is due. */
+static void sync(void) {
+    uint64_t now = host_io_now_us();
+    sim_input_poll();
+    while (timed.pos < timed.n && timed.v[timed.pos].at <= now) {
+        const sim_event_t *e = &timed.v[timed.pos++];
+        if (replay && (e->at != now || e->tick != tick_now()))
+            diverged("input", e);
+        apply(e);
+    }
+}
+
+static void log_event(const char *fmt, ...) {
+    va_list ap;
+    if (!rec) return;
+    fprintf(rec, "%llu %lu ", (unsigned long long)host_io_now_us(), (unsigned long)tick_now());
+    va_start(ap, fmt);
+    vfprintf(rec, fmt, ap);
+    va_end(ap);
+    fputc('\n', rec);
+}
+
+/* ---- Queries from host_io.c ------------------------------------------ */
+
+uint16_t sim_input_adc(uint8_t ch) {
+    uint16_t v;
+    ch &= 7;
+    sync();
+    v = adc_val[ch];
+    if (audio_on[ch]) {
+        double t = (double)host_io_now_us() / 1e6;
+        double s = audio_amp[ch] * sin(2.0 * M_PI * audio_hz[ch] * t);
+        v = (s <= 0) ? 0 : (s >= 1023.0) ? 1023 : (uint16_t)(s + 0.5);
+    }
+    if (v != rec_adc[ch]) {
+        rec_adc[ch] = v;
+        log_event("adc %u %u", ch, v);
+    }
+    return v;
+}
+
+uint8_t sim_input_buttons(void) {
+    uint8_t mask = 0, i;
+    sync();
+    if (replay) {
+        mask = button_mask;
+    } else {
+        for (i = 0; i < 4; i++)
+            if (press_count[i]) mask |= (uint8_t)(1 << i);
+    }
+    if (autostart) {
+        if (!autostart_started) {
+            autostart_started = 1;
+            autostart_at = host_io_now_us();
+        }
+        if (host_io_now_us() - autostart_at < AUTOSTART_US) mask |= 1 << BTN_OK_BIT;
+        else autostart = 0;
+    }
+    if (mask != rec_buttons) {
+        rec_buttons = mask;
+        log_event("buttons %u", mask);
+    }
+    return mask;
+}
+
+uint8_t sim_input_seed(uint8_t which) {
+    which &= 1;
+    sync();
+    if (seed_val[which] != rec_seed[which]) {
+        rec_seed[which] = seed_val[which];
+        log_event("seed %u %u", which, seed_val[which]);
+    }
+    return seed_val[which];
+}
+
+uint64_t sim_input_next_rx_us(void) {
+    return rx.pos < rx.n ? rx.v[rx.pos].at : NEVER;
+}
+
+uint8_t sim_input_take_rx(void) {
+    sim_event_t *e = &rx.v[rx.pos++];
+    if (replay && e->tick != tick_now())
+        diverged("rx byte", e);
+    log_event("rx %u", e->value);
+    return (uint8_t)e->value;
+}
+
+uint64_t sim_input_next_edge_us(void) {
+    uint64_t t = edges.pos < edges.n ? edges.v[edges.pos].at : NEVER;
+    uint8_t pin;
+    sync();
+    for (pin = 0; pin < 2; pin++)
+        if (edge_on[pin] && edge_at[pin] < t) t = edge_at[pin];
+    return t;
+}
+
+uint8_t sim_input_take_edge(void) {
+    uint64_t now = host_io_now_us();
+    uint8_t pin;
+    if (edges.pos < edges.n && edges.v[edges.pos].at <= now) {
+        sim_event_t *e = &edges.v[edges.pos++];
+        if (e->tick != tick_now())
+            diverged("edge", e);
+        pin = e->ch;
+    } else {
+        pin = (edge_on[1] && edge_at[1] <= now && !(edge_on[0] && edge_at[0] <= edge_at[1])) ? 1 : 0;
+        edge_schedule(pin);
+    }
+    log_event("edge %u", pin);
+    return pin;
+}
+
+uint64_t sim_input_next_screen_us(void) {
+    return screens.pos < screens.n ? screens.v[screens.pos].at : NEVER;
+}
+
+void sim_input_take_screen(void) {
+    screens.pos++;
+    sim_lcd_print(stdout, host_io_now_us());
+}
+
+void sim_input_poll(void) {
+    while (ticked.pos < ticked.n && ticked.v[ticked.pos].tick <= tick_now())
+        apply(&ticked.v[ticked.pos++]);
+}
+
+uint64_t sim_input_end_us(void) {
+    return end_us;
+}
+
+uint32_t sim_input_divergences(void) {
+    return divergences;
+}
+
+void sim_input_set_autostart(uint8_t on) {
+    autostart = on;
+}
+
+/* ---- Scenario scripts ------------------------------------------------ */
+
+static int button_index(const char *name) {
+    static const char *const names[4] = { "DOWN", "OK", "UP", "MENU" };   /* PC4..PC7 */
+    int i;
+    for (i = 0; i < 4; i++)
+        if (!strcmp(name, names[i])) return i;
+    return -1;
+}
+
+static int knob_channel(const char *name) {
+    if (!strcmp(name, "A")) return 4;
+    if (!strcmp(name, "B")) return 5;
+    if (!strcmp(name, "MA")) return 1;
+    return -1;
+}
+
+static void queue_bytes(uint64_t at, const uint8_t *b, size_t n) {
+    sim_event_t e;
+    size_t i;
+    memset(&e, 0, sizeof(e));
+    e.kind = EV_RX;
+    if (at < rx_tail_us) at = rx_tail_us;
+    for (i = 0; i < n; i++) {
+        e.at = at + i * UART_BYTE_US;
+        e.value = b[i];
+        queue_push(&rx, &e);
+    }
+    rx_tail_us = at + n * UART_BYTE_US;
+}
+
+void sim_input_rx_live(const uint8_t *b, size_t n) {
+    queue_bytes(host_io_now_us(), b, n);
+}
+
+int sim_input_load_scenario(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[1024];
+    int lineno = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *tok[40];
+        int n = 0;
+        char *p = strchr(line, '#');
+        sim_event_t e;
+        uint64_t at;
+
+        lineno++;
+        if (p) *p = 0;
+        for (p = strtok(line, " \t\r\n"); p && n < 40; p = strtok(NULL, " \t\r\n"))
+            tok[n++] = p;
+        if (n == 0) continue;
+        if (n < 2) goto bad;
+
+        memset(&e, 0, sizeof(e));
+        at = (uint64_t)(strtod(tok[0], NULL) * 1000.0 + 0.5);
+        e.at = at;
+
+        if (!strcmp(tok[1], "knob") && n == 4 && knob_channel(tok[2]) >= 0) {
+            e.kind = EV_ADC;
+            e.ch = (uint8_t)knob_channel(tok[2]);
+            e.value = (uint16_t)strtoul(tok[3], NULL, 0);
+        } else if (!strcmp(tok[1], "battery") && n == 3) {
+            e.kind = EV_ADC;
+            e.ch = 3;
+            e.value = (uint16_t)strtoul(tok[2], NULL, 0);
+        } else if (!strcmp(tok[1], "adc") && n == 4) {
+            e.kind = EV_ADC;
+            e.ch = (uint8_t)(strtoul(tok[2], NULL, 0) & 7);
+            e.value = (uint16_t)strtoul(tok[3], NULL, 0);
+        } else if (!strcmp(tok[1], "audio") && n >= 4 &&
+                   (!strcmp(tok[2], "A") || !strcmp(tok[2], "B"))) {
+            e.kind = EV_AUDIO;
+            e.ch = (tok[2][0] == 'A') ? 7 : 6;
+            if (!strcmp(tok[3], "sine") && n == 6) {
+                e.hz = strtod(tok[4], NULL);
+                e.amp = strtod(tok[5], NULL);
+            } else if (strcmp(tok[3], "off")) {
+                goto bad;
+            }
+        } else if (!strcmp(tok[1], "edges") && (n == 4 || n == 5) &&
+                   (!strcmp(tok[2], "A") || !strcmp(tok[2], "B"))) {
+            e.kind = EV_EDGES;
+            e.ch = (tok[2][0] == 'A') ? 1 : 0;
+            if (strcmp(tok[3], "off")) {
+                e.hz = strtod(tok[3], NULL);
+                e.amp = (n == 5) ? strtod(tok[4], NULL) : 0;
+                if (e.hz <= 0) goto bad;
+            } else if (n == 5) {
+                goto bad;
+            }
+        } else if (!strcmp(tok[1], "press") && n == 4 && button_index(tok[2]) >= 0) {
+            e.kind = EV_PRESS;
+            e.ch = (uint8_t)button_index(tok[2]);
+            queue_push(&timed, &e);
+            e.kind = EV_RELEASE;
+            e.at = at + (uint64_t)(strtod(tok[3], NULL) * 1000.0 + 0.5);
+        } else if (!strcmp(tok[1], "seed") && n == 4) {
+            e.kind = EV_SEED;
+            e.value = (uint16_t)strtoul(tok[2], NULL, 0);
+            queue_push(&timed, &e);
+            e.ch = 1;
+            e.value = (uint16_t)strtoul(tok[3], NULL, 0);
+        } else if ((!strcmp(tok[1], "serial") || !strcmp(tok[1], "frame")) && n >= 3) {
+            uint8_t bytes[40];
+            uint8_t sum = 0;
+            int i, nb = 0;
+            for (i = 2; i < n; i++) {
+                bytes[nb] = (uint8_t)strtoul(tok[i], NULL, 16);
+                sum += bytes[nb++];
+            }
+            if (tok[1][0] == 'f') bytes[nb++] = sum;
+            queue_bytes(at, bytes, (size_t)nb);
+            continue;
+        } else if (!strcmp(tok[1], "screen") && n == 2) {
+            e.kind = EV_SCREEN;
+            queue_push(&screens, &e);
+            continue;
+        } else if (!strcmp(tok[1], "end") && n == 2) {
+            if (at < end_us) end_us = at;
+            continue;
+        } else {
+            goto bad;
+        }
+        queue_push(&timed, &e);
+        continue;
+bad:
+        fprintf(stderr, "%s:%d: cannot parse scenario line\n", path, lineno);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    queue_sort(&timed);
+    queue_sort(&rx);
+    queue_sort(&screens);
+    return 0;
+}
+
+/* ---- Session logs ---------------------------------------------------- */
+
+int sim_input_load_replay(const char *path, uint32_t *loop_us, uint8_t *eeprom) {
+    FILE *f = fopen(path, "r");
+    char line[1200];
+    int lineno = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    replay = 1;
+    autostart = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char at_s[32], kind[16];
+        unsigned long tick;
+        unsigned a = 0, b = 0;
+        int n;
+        sim_event_t e;
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        if (!strncmp(line, "cfg loop_us ", 12)) {
+            *loop_us = (uint32_t)strtoul(line + 12, NULL, 0);
+            continue;
+        }
+        if (!strncmp(line, "cfg autostart ", 14)) {
+            autostart = (uint8_t)strtoul(line + 14, NULL, 0);
+            continue;
+        }
+        if (!strncmp(line, "eeprom ", 7)) {
+            const char *p = line + 7;
+            int i;
+            for (i = 0; i < 512 && p[0] && p[1]; i++, p += 2) {
+                char hex[3] = { p[0], p[1], 0 };
+                eeprom[i] = (uint8_t)strtoul(hex, NULL, 16);
+            }
+            continue;
+        }
+        n = sscanf(line, "%31s %lu %15s %u %u", at_s, &tick, kind, &a, &b);
+        if (n < 3) goto bad;
+
+        memset(&e, 0, sizeof(e));
+        e.at = strtoull(at_s, NULL, 10);
+        e.tick = (uint32_t)tick;
+        if (!strcmp(kind, "adc") && n == 5)          { e.kind = EV_ADC; e.ch = a & 7; e.value = (uint16_t)b; }
+        else if (!strcmp(kind, "buttons") && n == 4) { e.kind = EV_BUTTONS; e.value = (uint16_t)a; }
+        else if (!strcmp(kind, "seed") && n == 5)    { e.kind = EV_SEED; e.ch = a & 1; e.value = (uint16_t)b; }
+        else if (!strcmp(kind, "rx") && n == 4)      { e.kind = EV_RX; e.value = (uint16_t)a; }
+        else if (!strcmp(kind, "edge") && n == 4)    { e.kind = EV_EDGE; e.ch = a & 1; }
+        else if (!strcmp(kind, "end") && n == 3)     { e.kind = EV_END; }
+        else goto bad;
+
+        if (at_s[0] == '-') {
+            e.at = 0;
+            queue_push(&ticked, &e);
+        } else if (e.kind == EV_RX) {
+            queue_push(&rx, &e);
+        } else if (e.kind == EV_EDGE) {
+            queue_push(&edges, &e);
+        } else if (e.kind == EV_END) {
+            end_us = e.at;
+        } else {
+            queue_push(&timed, &e);
+        }
+        continue;
+bad:
+        fprintf(stderr, "%s:%d: cannot parse session log line\n", path, lineno);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+int sim_input_record(const char *path, uint32_t loop_us, const uint8_t *eeprom) {
+    int i;
+    rec = fopen(path, "w");
+    if (!rec) {
+        perror(path);
+        return -1;
+    }
+    for (i = 0; i < 8; i++) rec_adc[i] = 0xFFFF;
+    rec_buttons = rec_seed[0] = rec_seed[1] = 0xFFFF;
+    fprintf(rec, "# MK-312BT session log v1\ncfg loop_us %lu\neeprom ", (unsigned long)loop_us);
+    for (i = 0; i < 512; i++) fprintf(rec, "%02x", eeprom[i]);
+    fputc('\n', rec);
+    return 0;
+}
+
+void sim_input_finish(void) {
+    if (!rec) return;
+    fprintf(rec, "%llu %lu end\n", (unsigned long long)host_io_now_us(), (unsigned long)tick_now());
+    fclose(rec);
+    rec = NULL;
+}
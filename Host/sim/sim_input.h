@@ -0,0 +1,72 @@
+/*
+ * sim_input.h - External Inputs of the Linux-Native Build
+ *
+ * Everything the firmware can observe from outside: ADC channels (knobs,
+ * audio, battery), the four buttons, serial bytes, edges on the digital
+ * audio inputs and the power-on timer values that seed the PRNG. Inputs
+ * come either from a scenario script or from a recorded session log;
+ * either way every value the firmware actually samples can be written to
+ * a new session log.
+ *
+ * Session log, one event per line:
+ *
+ *   <us> <tick> seed <0|1> <value>     TCNT0 / TCNT1L read at power-on
+ *   <us> <tick> adc <ch> <value>       ADC channel 1-7 sampled (10-bit)
+ *   <us> <tick> buttons <mask>         button mask read, bit n = PC(4+n)
+ *   <us> <tick> rx <byte>              serial byte arrived at the UART
+ *   <us> <tick> edge <0|1>             edge on INT0 (PD2) / INT1 (PD3)
+ *   <us> <tick> end                    end of the session
+ *
+ * <us> is virtual time, <tick> param_engine_get_tick_total() at that
+ * moment. Values are logged only when they differ from what the firmware
+ * saw last time. A <us> of "-" keys the event to the engine tick instead
+ * (logs converted from the on-device trace). Header lines:
+ *
+ *   cfg loop_us <n>                    driver loop cost used when recording
+ *   cfg autostart 1                    answer the startup prompt (converted
+ *                                      on-device traces, which omit it)
+ *   eeprom <1024 hex digits>           EEPROM image at power-on
+ */
+
+#ifndef SIM_INPUT_H
+#define SIM_INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Input sources (call one before the run, or neither for idle defaults) */
+int  sim_input_load_scenario(const char *path);
+int  sim_input_load_replay(const char *path, uint32_t *loop_us, uint8_t *eeprom);
+void sim_input_set_autostart(uint8_t on);   /* Default: on unless replaying */
+
+/* Session recording */
+int  sim_input_record(const char *path, uint32_t loop_us, const uint8_t *eeprom);
+void sim_input_finish(void);
+
+/* Queried by host_io.c when the firmware samples an input */
+uint16_t sim_input_adc(uint8_t ch);
+uint8_t  sim_input_buttons(void);
+uint8_t  sim_input_seed(uint8_t which);
+uint64_t sim_input_next_rx_us(void);      /* UINT64_MAX when none queued */
+uint8_t  sim_input_take_rx(void);
+void     sim_input_rx_live(const uint8_t *b, size_t n);   /* --pty: arriving now */
+uint64_t sim_input_next_screen_us(void);  /* Scenario "screen" lines */
+uint64_t sim_input_next_edge_us(void);    /* UINT64_MAX when no edge source */
+uint8_t  sim_input_take_edge(void);       /* Returns the pin: 0 = INT0, 1 = INT1 */
+void     sim_input_take_screen(void);
+
+/* Called by the driver once per loop() for tick-keyed events */
+void sim_input_poll(void);
+
+uint64_t sim_input_end_us(void);          /* UINT64_MAX when open-ended */
+uint32_t sim_input_divergences(void);     /* Replay events seen off-schedule */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
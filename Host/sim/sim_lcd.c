@@ -0,0 +1,251 @@
+/*
+ * sim_lcd.c - HD44780 Model of the Linux-Native Build
+ *
+ * Controller behaviour follows the HD44780U datasheet at fosc = 270 kHz:
+ *
+ *   Power-on     8-bit interface, every E strobe is one instruction with
+ *                DB3..DB0 = 0 (not wired). Function Set with DL=0 switches
+ *                to 4-bit, after which bytes are transferred high nibble
+ *                first. Reads and writes share the nibble counter, as on
+ *                the chip.
+ *   Timing       Clear Display / Return Home 1.52 ms, everything else
+ *                37 us, data writes 37 + 4 us. BF reads 1 until then.
+ *   DDRAM        2-line layout, 0x00-0x27 and 0x40-0x67; the address
+ *                counter wraps from the end of one line to the other.
+ *   CGRAM        8 characters of 8 rows.
+ *
+ * Display shift and data reads (RW=1, RS=1) are not modelled; the
+ * firmware uses neither. A byte latched while the controller is still
+ * busy is applied anyway and counted, so a pacing bug shows up in the
+ * summary instead of as a garbled screen.
+ */
+
+#include "sim_lcd.h"
+#include "MK312BT_Constants.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EXEC_US        37
+#define EXEC_DATA_US   41
+#define EXEC_CLEAR_US  1520
+
+#define E_BIT   (1 << LCD_E_BIT)
+#define RS_BIT  (1 << LCD_RS_BIT)
+#define RW_BIT  (1 << LCD_RW_BIT)
+#define BTN_BIT (1 << BUTTON_ACTIVATE_BIT)
+
+static uint8_t  ddram[0x68];
+static uint8_t  cgram[64];
+static uint8_t  ac;             /* Address counter */
+static uint8_t  ac_cgram;       /* Last address set was CGRAM */
+static uint8_t  increment;      /* Entry mode I/D */
+static uint8_t  display_on;
+static uint8_t  four_bit;
+static uint8_t  nibble_low;     /* Next 4-bit transfer is the low nibble */
+static uint8_t  high_nibble;    /* Latched high nibble of a write */
+static uint64_t busy_until;
+static uint8_t  stuck;          /* BF never clears (sim_lcd_set_stuck) */
+
+static uint8_t  bus_active;     /* Strobed since PC0 last went low */
+static uint64_t bus_since;
+
+static sim_lcd_stats_t stats;
+static sim_lcd_second_t *seconds;
+static uint32_t seconds_cap;
+
+/* ---- Per-second accounting ------------------------------------------ */
+
+static sim_lcd_second_t *second_at(uint64_t us) {
+    uint32_t s = (uint32_t)(us / 1000000u);
+    if (s >= seconds_cap) {
+        uint32_t cap = seconds_cap ? seconds_cap : 64;
+        while (cap <= s) cap *= 2;
+        seconds = realloc(seconds, cap * sizeof(*seconds));
+        if (!seconds) abort();
+        memset(seconds + seconds_cap, 0, (cap - seconds_cap) * sizeof(*seconds));
+        seconds_cap = cap;
+    }
+    if (s >= stats.seconds) stats.seconds = s + 1;
+    return &seconds[s];
+}
+
+/* Credit bus time from bus_since to now, split at second boundaries */
+static void account_bus(uint64_t now_us) {
+    while (bus_since < now_us) {
+        uint64_t end = (bus_since / 1000000u + 1) * 1000000u;
+        if (end > now_us) end = now_us;
+        second_at(bus_since)->bus_us += end - bus_since;
+        stats.bus_us += end - bus_since;
+        bus_since = end;
+    }
+}
+
+/* ---- Controller ----------------------------------------------------- */
+
+static void ac_step(void) {
+    if (ac_cgram) {
+        ac = (uint8_t)((ac + (increment ? 1 : -1)) & 0x3F);
+        return;
+    }
+    if (increment) {
+        ac++;
+        if (ac == 0x28) ac = 0x40;
+        else if (ac == 0x68) ac = 0x00;
+    } else {
+        if (ac == 0x00) ac = 0x67;
+        else if (ac == 0x40) ac = 0x27;
+        else ac--;
+    }
+}
+
+static uint16_t instruction(uint8_t v) {
+    if (v & 0x80) {
+        ac = v & 0x7F;
+        if ((ac > 0x27 && ac < 0x40) || ac > 0x67) ac = 0x00;   /* Invalid: undefined */
+        ac_cgram = 0;
+    } else if (v & 0x40) {
+        ac = v & 0x3F;
+        ac_cgram = 1;
+    } else if (v & 0x20) {
+        four_bit = !(v & 0x10);
+    } else if (v & 0x10) {
+        if (!(v & 0x08)) {              /* Cursor move, no display shift */
+            uint8_t inc = increment;
+            increment = (v & 0x04) != 0;
+            ac_step();
+            increment = inc;
+        }
+    } else if (v & 0x08) {
+        display_on = (v & 0x04) != 0;
+    } else if (v & 0x04) {
+        increment = (v & 0x02) != 0;
+    } else if (v & 0x02) {
+        ac = 0;
+        ac_cgram = 0;
+        return EXEC_CLEAR_US;
+    } else if (v & 0x01) {
+        memset(ddram, ' ', sizeof(ddram));
+        ac = 0;
+        ac_cgram = 0;
+        increment = 1;
+        stats.clears++;
+        return EXEC_CLEAR_US;
+    }
+    return EXEC_US;
+}
+
+static void data_write(uint8_t v) {
+    if (ac_cgram) cgram[ac & 0x3F] = v;
+    else ddram[ac] = v;
+    ac_step();
+}
+
+static int latch_byte(uint64_t now_us, uint8_t rs, uint8_t v) {
+    uint16_t exec;
+    sim_lcd_second_t *sec = second_at(now_us);
+
+    if (now_us < busy_until) stats.busy_writes++;
+    if (rs) {
+        data_write(v);
+        exec = EXEC_DATA_US;
+        stats.data_bytes++;
+        sec->data_bytes++;
+    } else {
+        exec = instruction(v);
+        stats.cmd_bytes++;
+        sec->cmd_bytes++;
+    }
+    busy_until = now_us + exec;
+    return (rs << 8) | v;
+}
+
+/* ---- Bus interface -------------------------------------------------- */
+
+void sim_lcd_reset(void) {
+    memset(ddram, ' ', sizeof(ddram));
+    memset(cgram, 0, sizeof(cgram));
+    ac = 0;
+    ac_cgram = 0;
+    increment = 1;
+    display_on = 0;
+    four_bit = 0;
+    nibble_low = 0;
+    high_nibble = 0;
+    busy_until = 0;
+    bus_active = 0;
+    bus_since = 0;
+    free(seconds);
+    seconds = NULL;
+    seconds_cap = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+int sim_lcd_portc(uint64_t now_us, uint8_t old, uint8_t portc) {
+    int latched = -1;
+
+    if (portc & BTN_BIT) {
+        if (bus_active) account_bus(now_us);
+        bus_active = 0;
+    } else if (!bus_active && (portc & E_BIT) && !(old & E_BIT)) {
+        bus_active = 1;
+        bus_since = now_us;
+    }
+
+    if (!(old & E_BIT) || (portc & E_BIT)) return -1;   /* Act on E falling */
+    if (portc & BTN_BIT) stats.bus_conflicts++;
+
+    if (portc & RW_BIT) {
+        if (four_bit) nibble_low = !nibble_low;          /* Read transfer */
+        return -1;
+    }
+    if (!four_bit) {
+        latched = latch_byte(now_us, (portc & RS_BIT) != 0, portc & 0xF0);
+        nibble_low = 0;
+    } else if (!nibble_low) {
+        high_nibble = portc & 0xF0;
+        nibble_low = 1;
+    } else {
+        nibble_low = 0;
+        latched = latch_byte(now_us, (portc & RS_BIT) != 0,
+                             (uint8_t)(high_nibble | ((portc & 0xF0) >> 4)));
+    }
+    return latched;
+}
+
+void sim_lcd_set_stuck(uint8_t on) {
+    stuck = on;
+}
+
+uint8_t sim_lcd_read(uint64_t now_us) {
+    if (stuck) return 0xF0;                             /* Pull-ups only */
+    uint8_t v = (uint8_t)((now_us < busy_until ? 0x80 : 0) | (ac & 0x7F));
+    if (four_bit && nibble_low) return (uint8_t)(v << 4);
+    return v & 0xF0;
+}
+
+const sim_lcd_stats_t *sim_lcd_stats(uint64_t now_us) {
+    if (bus_active) account_bus(now_us);
+    if (now_us) second_at(now_us - 1);
+    stats.per_second = seconds;
+    return &stats;
+}
+
+void sim_lcd_print(FILE *f, uint64_t now_us) {
+    static const char *const cg[8] = { "₀", "₁", "₂", "₃", "₄", "₅", "₆", "₇" };
+    uint8_t row, col;
+
+    fprintf(f, "screen %.3f s%s\n", now_us / 1e6, display_on ? "" : " (display off)");
+    for (row = 0; row < 2; row++) {
+        fputc('|', f);
+        for (col = 0; col < 16; col++) {
+            uint8_t c = ddram[row * 0x40 + col];
+            if (c < 0x10)                fputs(cg[c & 7], f);
+            else if (c == 0x7E)          fputs("→", f);
+            else if (c == 0x7F)          fputs("←", f);
+            else if (c == 0xFF)          fputs("█", f);
+            else if (c >= 0x20 && c < 0x7E) fputc(c, f);
+            else                         fputc('?', f);
+        }
+        fputs("|\n", f);
+    }
+}
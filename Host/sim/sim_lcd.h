@@ -0,0 +1,68 @@
+/*
+ * sim_lcd.h - HD44780 Model of the Linux-Native Build
+ *
+ * host_io.c hands every committed PORTC value to sim_lcd_portc(). The
+ * model decodes the 4-bit bus the way the controller does: DB7..DB4 are
+ * latched on the falling edge of E, RS picks instruction or data, RW=1
+ * clocks out the busy flag and address counter. DDRAM, CGRAM, the address
+ * counter, entry mode and the execution time of each instruction are
+ * kept, so the busy flag reads exactly as long as the panel would be busy.
+ *
+ * Bus accounting: every public lcd.c call ends with lcd_enable_buttons(),
+ * which raises PC0. The time from the first E strobe after the bus was
+ * taken to that hand-back is the time the firmware spent on the display,
+ * waits and fixed delays included (between calls the bus is parked in LCD
+ * mode without strobes, which is not counted). It is kept per second of
+ * virtual time together with the instruction and data byte counts.
+ */
+
+#ifndef SIM_LCD_H
+#define SIM_LCD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t cmd_bytes, data_bytes;
+    uint64_t bus_us;                  /* First strobe to PC0 high */
+} sim_lcd_second_t;
+
+typedef struct {
+    uint64_t cmd_bytes, data_bytes;
+    uint64_t bus_us;
+    uint64_t busy_writes;             /* Byte latched while still busy */
+    uint64_t bus_conflicts;           /* E strobed with the buttons on the bus */
+    uint64_t clears;                  /* Clear Display instructions */
+    uint32_t seconds;                 /* Entries in per_second */
+    const sim_lcd_second_t *per_second;
+} sim_lcd_stats_t;
+
+void sim_lcd_reset(void);
+
+/* PORTC committed. Returns -1, or (rs << 8) | byte when a whole byte
+ * (or an 8-bit mode instruction) was latched. */
+int sim_lcd_portc(uint64_t now_us, uint8_t old, uint8_t portc);
+
+/* DB7..DB4 driven by the LCD while RW=1 and E=1, in bits 7..4 */
+uint8_t sim_lcd_read(uint64_t now_us);
+
+/* Model an absent or hung controller: reads return the pull-ups, i.e.
+ * BF = 1 forever. Writes are still decoded. Survives sim_lcd_reset(). */
+void sim_lcd_set_stuck(uint8_t on);
+
+/* Close the per-second accounting up to now_us and return it */
+const sim_lcd_stats_t *sim_lcd_stats(uint64_t now_us);
+
+/* The 16x2 window as text. CGRAM characters print as subscript digits,
+ * 0x7E/0x7F as arrows and 0xFF as a full block (UTF-8). */
+void sim_lcd_print(FILE *f, uint64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
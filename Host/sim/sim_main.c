@@ -0,0 +1,444 @@
+/*
+ * sim_main.c - Linux-Native Firmware Driver
+ *
+ * Runs the unmodified firmware (setup() once, then loop() forever) against
+ * the peripheral models in host_io.c, in virtual time. Inputs come from a
+ * scenario script or a recorded session log (sim_input.c); every input the
+ * firmware samples can be recorded again, so a session recorded once
+ * replays bit-for-bit, at many times real speed, under a debugger or a
+ * profiler.
+ *
+ * With --pty the run is paced to the wall clock instead and the UART is
+ * bridged to a pseudo terminal, so host tools talk to the emulated box as
+ * to a serial port. --skew-ppm makes the box crystal run fast or slow
+ * against the wall clock; several instances with different skews model a
+ * multi-box session on one machine.
+ *
+ * At the end of the run a summary is printed to stderr, including a digest
+ * of all outputs (serial TX, DAC latches, EEPROM writes, LCD bytes and
+ * every H-bridge transition with its time stamp). Two runs behaved
+ * identically if and only if their digests match.
+ */
+
+#define _GNU_SOURCE             /* ppoll, posix_openpt */
+
+#include "host_io.h"
+#include "sim.h"
+#include "sim_input.h"
+#include "sim_lcd.h"
+#include "tick_sync.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_LOOP_US   100
+#define DEFAULT_RUN_S     10
+
+#define PACE_SLACK_US     500     /* Sleep once virtual time is this far ahead */
+
+static jmp_buf abort_run;
+static char    abort_msg[256];
+static FILE   *trace;
+
+static int     pty_fd = -1;
+static double  skew_ppm;
+static volatile sig_atomic_t stop_requested;
+
+void sim_fatal(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(abort_msg, sizeof(abort_msg), fmt, ap);
+    va_end(ap);
+    longjmp(abort_run, 1);
+}
+
+static void trace_output(uint64_t us, uint8_t kind, uint16_t a, uint16_t b) {
+    switch (kind) {
+        case HOST_IO_OUT_TX:
+            fprintf(trace, "%llu tx %02x\n", (unsigned long long)us, a);
+            break;
+        case HOST_IO_OUT_DAC:
+            fprintf(trace, "%llu dac %c %u\n", (unsigned long long)us, a ? 'B' : 'A', b);
+            break;
+        case HOST_IO_OUT_EEPROM:
+            fprintf(trace, "%llu eeprom %03x %02x\n", (unsigned long long)us, a, b);
+            break;
+        case HOST_IO_OUT_PULSE:
+            fprintf(trace, "%llu pulse %c %u\n", (unsigned long long)us, a ? 'B' : 'A', b);
+            break;
+        case HOST_IO_OUT_LCD:
+            fprintf(trace, "%llu lcd %s %02x\n", (unsigned long long)us, a ? "data" : "cmd", b);
+            break;
+        case HOST_IO_OUT_WIDTH:
+            fprintf(trace, "%llu width %c %c%u\n", (unsigned long long)us, (a & 1) ? 'B' : 'A',
+                    (a & HOST_IO_OUT_NEG) ? '-' : '+', b);
+            break;
+    }
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Host CPU time spent in the engine, ticks and sub-ticks. The Makefile
+ * links with --wrap for both entry points, so every call from loop()
+ * passes through here. */
+static struct { uint64_t calls, ns; } engine_cpu[2];
+
+void __real_mode_dispatcher_update(void);
+void __real_mode_dispatcher_subtick(void);
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void __wrap_mode_dispatcher_update(void) {
+    uint64_t t0 = cpu_ns();
+    __real_mode_dispatcher_update();
+    engine_cpu[0].ns += cpu_ns() - t0;
+    engine_cpu[0].calls++;
+}
+
+void __wrap_mode_dispatcher_subtick(void) {
+    uint64_t t0 = cpu_ns();
+    __real_mode_dispatcher_subtick();
+    engine_cpu[1].ns += cpu_ns() - t0;
+    engine_cpu[1].calls++;
+}
+
+static void on_output(uint64_t us, uint8_t kind, uint16_t a, uint16_t b) {
+    if (trace) trace_output(us, kind, a, b);
+    if (pty_fd >= 0 && kind == HOST_IO_OUT_TX) {
+        uint8_t byte = (uint8_t)a;
+        if (write(pty_fd, &byte, 1) != 1 && errno != EAGAIN) sim_fatal("pty write: %s", strerror(errno));
+    }
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* Pseudo terminal for --pty. The slave side is set raw and kept open, so
+ * the master neither echoes nor sees EIO while no host is attached. */
+static int pty_open(const char *link_path) {
+    struct termios t;
+    const char *name;
+    int slave;
+
+    pty_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (pty_fd < 0 || grantpt(pty_fd) || unlockpt(pty_fd) || !(name = ptsname(pty_fd))) {
+        perror("pty");
+        return -1;
+    }
+    slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0 || tcgetattr(slave, &t)) {
+        perror(name);
+        return -1;
+    }
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(pty_fd, F_SETFL, O_NONBLOCK);
+    if (link_path) {
+        unlink(link_path);
+        if (symlink(name, link_path)) {
+            perror(link_path);
+            return -1;
+        }
+    }
+    fprintf(stderr, "pty            %s%s%s\n", name, link_path ? " -> " : "", link_path ? link_path : "");
+    return 0;
+}
+
+/* --pty: hold virtual time to the wall clock scaled by the crystal skew,
+ * and hand bytes the host wrote to the UART as they arrive. */
+static void pace(void) {
+    static double wall0;
+    static uint64_t virt0;
+    struct pollfd pfd = { pty_fd, POLLIN, 0 };
+    uint8_t buf[64];
+    double ahead;
+    ssize_t n;
+
+    if (!wall0) {
+        wall0 = wall_seconds();
+        virt0 = host_io_now_us();
+    }
+    ahead = (double)(host_io_now_us() - virt0) -
+            (wall_seconds() - wall0) * 1e6 * (1.0 + skew_ppm * 1e-6);
+    if (ahead > PACE_SLACK_US) {
+        struct timespec ts;
+        double wait_us = ahead / (1.0 + skew_ppm * 1e-6);
+        ts.tv_sec = (time_t)(wait_us / 1e6);
+        ts.tv_nsec = (long)((wait_us - ts.tv_sec * 1e6) * 1000);
+        ppoll(&pfd, 1, &ts, NULL);
+    }
+    while ((n = read(pty_fd, buf, sizeof(buf))) > 0)
+        sim_input_rx_live(buf, (size_t)n);
+}
+
+static int load_file(const char *path, uint8_t *buf, size_t len) {
+    FILE *f = fopen(path, "rb");
+    size_t n;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    n = fread(buf, 1, len, f);
+    fclose(f);
+    if (n != len) {
+        fprintf(stderr, "%s: expected %zu bytes, got %zu\n", path, len, n);
+        return -1;
+    }
+    return 0;
+}
+
+static int save_file(const char *path, const uint8_t *buf, size_t len) {
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(buf, 1, len, f) != len) {
+        perror(path);
+        if (f) fclose(f);
+        return -1;
+    }
+    return fclose(f);
+}
+
+static void print_bridge(const char *name, const host_io_bridge_t *b) {
+    fprintf(stderr, "  output %s     %llu+/%llu- pulses, on %.1f/%.1f ms, min dead %s%llu us, shoot-through %llu\n",
+            name, (unsigned long long)b->pulses_pos, (unsigned long long)b->pulses_neg,
+            b->on_us_pos / 1000.0, b->on_us_neg / 1000.0,
+            b->min_dead_us == UINT64_MAX ? "-" : "",
+            (unsigned long long)(b->min_dead_us == UINT64_MAX ? 0 : b->min_dead_us),
+            (unsigned long long)b->shoot_through);
+    if (b->bursts) {
+        uint32_t n, common = 1;
+        for (n = 1; n < HOST_IO_BURST_HIST - 1; n++)
+            if (b->burst_hist[n] > b->burst_hist[common]) common = n;
+        fprintf(stderr, "  bursts %s     %llu, %u-%u pulses, %u of %u pulses\n",
+                name, (unsigned long long)b->bursts, b->burst_min, b->burst_max,
+                b->burst_hist[common], common);
+    }
+}
+
+/* One line per second of virtual time: bytes sent and bus time held */
+static int save_lcd_log(const char *path, const sim_lcd_stats_t *l) {
+    FILE *f = fopen(path, "w");
+    uint32_t i;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "# second cmd_bytes data_bytes bus_us\n");
+    for (i = 0; i < l->seconds; i++) {
+        const sim_lcd_second_t *s = &l->per_second[i];
+        fprintf(f, "%lu %lu %lu %llu\n", (unsigned long)i, (unsigned long)s->cmd_bytes,
+                (unsigned long)s->data_bytes, (unsigned long long)s->bus_us);
+    }
+    return fclose(f);
+}
+
+static void print_lcd(const sim_lcd_stats_t *l, uint64_t run_us) {
+    uint64_t peak = 0;
+    uint32_t i, peak_s = 0;
+    for (i = 0; i < l->seconds; i++) {
+        if (l->per_second[i].bus_us > peak) {
+            peak = l->per_second[i].bus_us;
+            peak_s = i;
+        }
+    }
+    fprintf(stderr, "lcd            %llu cmd + %llu data bytes (%llu clears), bus held %.1f ms = %.2f ms/s, peak %.1f ms in second %lu\n",
+            (unsigned long long)l->cmd_bytes, (unsigned long long)l->data_bytes,
+            (unsigned long long)l->clears, l->bus_us / 1000.0,
+            run_us ? l->bus_us * 1000.0 / run_us : 0.0, peak / 1000.0, (unsigned long)peak_s);
+    if (l->busy_writes || l->bus_conflicts)
+        fprintf(stderr, "lcd errors     %llu bytes written while busy, %llu strobes with buttons on the bus\n",
+                (unsigned long long)l->busy_writes, (unsigned long long)l->bus_conflicts);
+}
+
+/* Power on and run until end_us. Returns 0, or 3 if the run was stopped. */
+static int run(uint64_t end_us, uint32_t loop_us, uint64_t *loops) {
+    if (setjmp(abort_run)) {
+        fprintf(stderr, "stopped at %.6f s: %s\n", host_io_now_us() / 1e6, abort_msg);
+        return 3;
+    }
+    setup();
+    while (host_io_now_us() < end_us && !stop_requested) {
+        loop();
+        (*loops)++;
+        sim_input_poll();
+        host_io_advance(loop_us);
+        if (pty_fd >= 0) pace();
+    }
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -s, --scenario FILE    drive inputs from a scenario script\n"
+        "  -r, --replay LOG       replay a recorded session log\n"
+        "  -w, --record LOG       record every input the firmware samples\n"
+        "  -t, --time SEC         virtual run time (default: end of scenario/log, else %d)\n"
+        "      --loop-us N        virtual cost of one loop() pass (default %d)\n"
+        "      --eeprom FILE      initial 512-byte EEPROM image (default: erased)\n"
+        "      --eeprom-out FILE  save the EEPROM image at exit\n"
+        "      --trace FILE       write TX bytes, DAC latches, EEPROM writes, LCD bytes and pulse periods\n"
+        "      --lcd-log FILE     write LCD bytes and bus time per second of virtual time\n"
+        "      --screen           print the LCD contents at exit\n"
+        "      --lcd-stuck        LCD busy flag never clears (absent or hung controller)\n"
+        "      --pty              run in real time with the UART on a pseudo terminal\n"
+        "      --pty-link PATH    also make PATH a symlink to the pseudo terminal\n"
+        "      --skew-ppm N       box crystal error against the wall clock (with --pty)\n"
+        "      --no-autostart     do not answer the startup key prompt\n",
+        argv0, DEFAULT_RUN_S, DEFAULT_LOOP_US);
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        { "scenario",     required_argument, 0, 's' },
+        { "replay",       required_argument, 0, 'r' },
+        { "record",       required_argument, 0, 'w' },
+        { "time",         required_argument, 0, 't' },
+        { "loop-us",      required_argument, 0, 'L' },
+        { "eeprom",       required_argument, 0, 'E' },
+        { "eeprom-out",   required_argument, 0, 'O' },
+        { "trace",        required_argument, 0, 'T' },
+        { "no-autostart", no_argument,       0, 'A' },
+        { "lcd-log",      required_argument, 0, 'D' },
+        { "screen",       no_argument,       0, 'S' },
+        { "lcd-stuck",    no_argument,       0, 'B' },
+        { "pty",          no_argument,       0, 'P' },
+        { "pty-link",     required_argument, 0, 'K' },
+        { "skew-ppm",     required_argument, 0, 'k' },
+        { "help",         no_argument,       0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+    const char *scenario = NULL, *replay = NULL, *record = NULL;
+    const char *eeprom_in = NULL, *eeprom_out = NULL, *trace_path = NULL;
+    const char *lcd_log = NULL, *pty_link = NULL;
+    double run_s = 0;
+    uint32_t loop_us = DEFAULT_LOOP_US;
+    uint8_t loop_us_set = 0, autostart = 1, screen = 0, use_pty = 0, lcd_stuck = 0;
+    uint8_t *ee = host_io_eeprom();
+    uint64_t loops = 0;
+    uint64_t end_us;
+    const host_io_stats_t *st;
+    double wall0, wall;
+    int c, status = 0;
+
+    while ((c = getopt_long(argc, argv, "s:r:w:t:h", opts, NULL)) != -1) {
+        switch (c) {
+            case 's': scenario = optarg; break;
+            case 'r': replay = optarg; break;
+            case 'w': record = optarg; break;
+            case 't': run_s = strtod(optarg, NULL); break;
+            case 'L': loop_us = (uint32_t)strtoul(optarg, NULL, 0); loop_us_set = 1; break;
+            case 'E': eeprom_in = optarg; break;
+            case 'O': eeprom_out = optarg; break;
+            case 'T': trace_path = optarg; break;
+            case 'A': autostart = 0; break;
+            case 'D': lcd_log = optarg; break;
+            case 'S': screen = 1; break;
+            case 'B': lcd_stuck = 1; break;
+            case 'P': use_pty = 1; break;
+            case 'K': pty_link = optarg; use_pty = 1; break;
+            case 'k': skew_ppm = strtod(optarg, NULL); break;
+            default:  usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (scenario && replay) {
+        fprintf(stderr, "--scenario and --replay are exclusive\n");
+        return 2;
+    }
+
+    host_io_reset();
+    sim_lcd_set_stuck(lcd_stuck);
+    memset(ee, 0xFF, 512);
+    if (eeprom_in && load_file(eeprom_in, ee, 512)) return 2;
+    if (replay) {
+        uint32_t logged_loop_us = loop_us;
+        if (sim_input_load_replay(replay, &logged_loop_us, ee)) return 2;
+        if (!loop_us_set) loop_us = logged_loop_us;
+    }
+    if (scenario && sim_input_load_scenario(scenario)) return 2;
+    if (!autostart) sim_input_set_autostart(0);
+    if (record && sim_input_record(record, loop_us, ee)) return 2;
+    if (trace_path) {
+        trace = fopen(trace_path, "w");
+        if (!trace) {
+            perror(trace_path);
+            return 2;
+        }
+    }
+    if (use_pty && pty_open(pty_link)) return 2;
+    if (trace || use_pty) host_io_set_output(on_output);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    end_us = sim_input_end_us();
+    if (run_s > 0) end_us = (uint64_t)(run_s * 1e6);
+    else if (end_us == UINT64_MAX && !use_pty) end_us = (uint64_t)DEFAULT_RUN_S * 1000000u;
+
+    wall0 = wall_seconds();
+    status = run(end_us, loop_us, &loops);
+    wall = wall_seconds() - wall0;
+
+    sim_input_finish();
+    if (trace) fclose(trace);
+    if (pty_link) unlink(pty_link);
+    if (eeprom_out && save_file(eeprom_out, ee, 512)) status = 2;
+    if (lcd_log && save_lcd_log(lcd_log, sim_lcd_stats(host_io_now_us()))) status = 2;
+    if (screen) sim_lcd_print(stdout, host_io_now_us());
+
+    st = host_io_stats();
+    fprintf(stderr, "virtual time   %.3f s in %.3f s wall (%.0fx real time)\n",
+            host_io_now_us() / 1e6, wall, wall > 0 ? host_io_now_us() / 1e6 / wall : 0.0);
+    fprintf(stderr, "engine ticks   %lu + %lu sub-ticks, loop passes %llu\n",
+            (unsigned long)param_engine_get_tick_total(),
+            (unsigned long)param_engine_get_subtick_total(), (unsigned long long)loops);
+    if (engine_cpu[0].calls && host_io_now_us())
+        fprintf(stderr, "engine cpu     %.2f us per tick, %.2f us per sub-tick, %.1f us per s (host)\n",
+                engine_cpu[0].ns / 1e3 / engine_cpu[0].calls,
+                engine_cpu[1].calls ? engine_cpu[1].ns / 1e3 / engine_cpu[1].calls : 0.0,
+                (engine_cpu[0].ns + engine_cpu[1].ns) / 1e3 / (host_io_now_us() / 1e6));
+    fprintf(stderr, "interrupts     T1 %llu, T2 %llu, RX %llu, UDRE %llu, INT0 %llu, INT1 %llu (%llu nested), worst timer latency %llu us\n",
+            (unsigned long long)st->isr_timer1, (unsigned long long)st->isr_timer2,
+            (unsigned long long)st->isr_rx, (unsigned long long)st->isr_udre,
+            (unsigned long long)st->isr_int0, (unsigned long long)st->isr_int1,
+            (unsigned long long)st->isr_nested, (unsigned long long)st->isr_late_us_max);
+    fprintf(stderr, "serial         rx %llu (overruns %llu), tx %llu bytes\n",
+            (unsigned long long)st->rx_bytes, (unsigned long long)st->rx_overruns,
+            (unsigned long long)st->tx_bytes);
+    fprintf(stderr, "peripherals    %llu ADC, %llu DAC words (A=%u B=%u), %llu EEPROM writes, %llu LCD strobes\n",
+            (unsigned long long)st->adc_conversions, (unsigned long long)st->dac_writes,
+            st->dac_value[0], st->dac_value[1], (unsigned long long)st->eeprom_writes,
+            (unsigned long long)st->lcd_strobes);
+    print_bridge("A", &st->bridge[0]);
+    print_bridge("B", &st->bridge[1]);
+    print_lcd(sim_lcd_stats(host_io_now_us()), host_io_now_us());
+    if (tick_sync_regs.status)
+        fprintf(stderr, "tick sync      %u steps, trim %+.1f ppm, last error %+.2f ticks\n",
+                tick_sync_regs.steps,
+                (int16_t)(tick_sync_regs.trim[0] | tick_sync_regs.trim[1] << 8) / 256.0 / TICK_SYNC_PERIOD_US * 1e6,
+                (int16_t)(tick_sync_regs.error[0] | tick_sync_regs.error[1] << 8) / 256.0);
+    if (replay)
+        fprintf(stderr, "replay         %lu divergences\n", (unsigned long)sim_input_divergences());
+    fprintf(stderr, "digest         %08lx\n", (unsigned long)host_io_digest());
+
+    if (replay && sim_input_divergences()) status = status ? status : 1;
+    return status;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+edge_accuracy.py - Accuracy of the audio input frequency tracker
+
+Feeds synthetic edge streams to the INT0/INT1 inputs of the emulated box
+(Host/sim/build/mk312bt-sim, scenario "edges" lines) and reads the
+smoothed periods back over the serial link at 0x43E0 (see
+MK312BT/audio_processor.h). Both channels get the same stream; each
+frequency settles for --settle-ms, then --samples readings are taken.
+A 16-bit period is read hi, lo, hi and the sample is dropped when the
+two hi bytes differ (the box updated it in between).
+
+Usage:
+    python3 Host/tools/edge_accuracy.py [--freqs 50,440,1000] [--jitter 0,20]
+
+One row per frequency, jitter and channel: true period, mean reading,
+mean error in ppm, standard deviation and worst error in us, readings of
+0 (no input) and the overload counter at the end of the run.
+"""
+
+import argparse
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+from mk312link import SIM
+
+AUDIO_FREQ = 0x43E0
+OVERLOADS = AUDIO_FREQ + 5
+START_MS = 5000             # Past the startup screens
+SAMPLE_MS = 25
+
+
+def read_frames(addr):
+    return ["frame 3C %02X %02X" % (addr >> 8, addr & 0xFF)]
+
+
+def scenario(freqs, jitter, settle_ms, samples):
+    """Scenario lines and the (hz, channel) each sample's three reads belong to."""
+    lines = ["0 seed 0x3B 0x00"]
+    order = []
+    t = START_MS
+    for hz in freqs:
+        for ch in "AB":
+            lines.append("%d edges %s %g %g" % (t, ch, hz, jitter))
+        t += settle_ms
+        for _ in range(samples):
+            for ch, base in (("A", AUDIO_FREQ), ("B", AUDIO_FREQ + 2)):
+                for addr in (base + 1, base, base + 1):
+                    lines.append("%d %s" % (t, read_frames(addr)[0]))
+                order.append((hz, ch))
+            t += SAMPLE_MS
+    lines.append("%d %s" % (t, read_frames(OVERLOADS)[0]))
+    lines.append("%d end" % (t + 50))
+    return "\n".join(lines) + "\n", order
+
+
+def replies(trace):
+    """Values of the READ replies ([0x22][value][checksum]) in the trace."""
+    tx = [int(f[2], 16) for f in (l.split() for l in open(trace)) if len(f) == 3 and f[1] == "tx"]
+    return [tx[i + 1] for i in range(0, len(tx) - 2, 3) if tx[i] == 0x22]
+
+
+def run(freqs, jitter, settle_ms, samples, tmp):
+    text, order = scenario(freqs, jitter, settle_ms, samples)
+    scn = os.path.join(tmp, "edges_%g.scn" % jitter)
+    trc = os.path.join(tmp, "edges_%g.trace" % jitter)
+    with open(scn, "w") as f:
+        f.write(text)
+    subprocess.run([SIM, "-s", scn, "--trace", trc], check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    vals = replies(trc)
+    if len(vals) != 3 * len(order) + 1:
+        sys.exit("expected %d replies, got %d" % (3 * len(order) + 1, len(vals)))
+    got = {}
+    for i, key in enumerate(order):
+        hi, lo, hi2 = vals[3 * i:3 * i + 3]
+        if hi == hi2:
+            got.setdefault(key, []).append(hi << 8 | lo)
+    return got, vals[-1]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--freqs", default="30,50,100,220,440,1000,2000,4000,7000",
+                    help="input frequencies in Hz (comma separated)")
+    ap.add_argument("--jitter", default="0,8,50", help="edge jitter in +-us (comma separated)")
+    ap.add_argument("--settle-ms", type=int, default=300, help="time before sampling each frequency")
+    ap.add_argument("--samples", type=int, default=40, help="readings per frequency and channel")
+    args = ap.parse_args()
+
+    if not os.path.exists(SIM):
+        sys.exit("%s not built (make -C Host/sim)" % SIM)
+    freqs = [float(f) for f in args.freqs.split(",")]
+    tmp = tempfile.mkdtemp(prefix="edge_accuracy_")
+
+    print("%8s %6s %2s  %9s %9s %8s %7s %7s %5s" % ("hz", "jitter", "ch", "true us", "mean us",
+                                                   "err ppm", "sd us", "worst", "zero"))
+    for jitter in (float(j) for j in args.jitter.split(",")):
+        got, overloads = run(freqs, jitter, args.settle_ms, args.samples, tmp)
+        for hz in freqs:
+            true = 1e6 / hz
+            for ch in "AB":
+                v = got.get((hz, ch), [])
+                live = [x for x in v if x]
+                if not live:
+                    print("%8g %6g %2s  %9.1f %9s" % (hz, jitter, ch, true, "-"))
+                    continue
+                mean = sum(live) / len(live)
+                sd = math.sqrt(sum((x - mean) ** 2 for x in live) / len(live))
+                worst = max(abs(x - true) for x in live)
+                print("%8g %6g %2s  %9.1f %9.1f %+8.0f %7.2f %7.1f %5d" %
+                      (hz, jitter, ch, true, mean, (mean - true) / true * 1e6, sd, worst,
+                       len(v) - len(live)))
+        print("jitter %g: overloads %d" % (jitter, overloads))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+engine_rate.py - Engine load and sweep resolution at each ENGINE_RATE
+
+Runs the emulated box (Host/sim/build/mk312bt-sim) once per engine rate
+(ENGINE_RATE, 0x439F: 0 = 250 Hz, 1 = 500 Hz, 2 = 1000 Hz), stepping
+through the modes with NEXT_MODE box commands (0x4070 = 0x10) one every
+--interval-ms, and reads the engine counters and host CPU time from the
+simulator summary and the pulse periods from its trace.
+
+Usage:
+    python3 Host/tools/engine_rate.py [--rates 0,1,2] [--switches 12]
+
+One row per rate: engine ticks and sub-ticks in the run, host CPU time
+per tick, per sub-tick and per second of virtual time, that time
+relative to rate 0, distinct pulse periods per second (both channels,
+after the first switch) and the mean difference of the 100 ms average
+period from rate 0's run, in percent. The timers count ticks at every
+rate, so the tick count does not change and the period difference stays
+at about half a sweep step; the glides show up as more distinct periods.
+Sub-ticks a slow loop pass missed are merged, so the sub-tick count
+falls short of (2^rate - 1) per tick. CPU times are host times of the x86
+build, only comparable with each other.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from mk312link import SIM
+
+BOX_COMMAND = 0x4070
+NEXT_MODE = 0x10
+ENGINE_RATE = 0x439F
+START_MS = 6000             # Past the startup screens
+WINDOW_US = 100000
+
+
+def write_frame(addr, value):
+    return "frame 4D %02X %02X %02X" % (addr >> 8, addr & 0xFF, value)
+
+
+def scenario(rate, switches, interval_ms):
+    lines = ["0 knob A 600", "0 knob B 600", "%d serial 00" % START_MS,
+             "%d %s" % (START_MS + 100, write_frame(ENGINE_RATE, rate))]
+    t = START_MS + 1000
+    for _ in range(switches):
+        lines.append("%d %s" % (t, write_frame(BOX_COMMAND, NEXT_MODE)))
+        t += interval_ms
+    lines.append("%d end" % t)
+    return "\n".join(lines) + "\n"
+
+
+def run(rate, args, tmp):
+    scn = os.path.join(tmp, "rate%d.scn" % rate)
+    trc = os.path.join(tmp, "rate%d.trace" % rate)
+    with open(scn, "w") as f:
+        f.write(scenario(rate, args.switches, args.interval_ms))
+    res = subprocess.run([SIM, "-s", scn, "--trace", trc], check=True,
+                         stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    summary = res.stderr
+    m = re.search(r"virtual time\s+([\d.]+) s", summary)
+    t = re.search(r"engine ticks\s+(\d+) \+ (\d+) sub-ticks", summary)
+    c = re.search(r"engine cpu\s+([\d.]+) us per tick, ([\d.]+) us per sub-tick, ([\d.]+) us per s",
+                  summary)
+    if not (m and t and c):
+        sys.exit("rate %d: no engine summary from the simulator" % rate)
+
+    windows = {}
+    changes = 0
+    last = {}
+    t0 = (START_MS + 1000) * 1000
+    for line in open(trc):
+        f = line.split()
+        if len(f) != 4 or f[1] != "pulse" or int(f[0]) < t0:
+            continue
+        us, ch, period = int(f[0]), f[2], int(f[3])
+        if last.get(ch) != period:
+            changes += 1
+            last[ch] = period
+        w = windows.setdefault((ch, us // WINDOW_US), [0, 0])
+        w[0] += period
+        w[1] += 1
+    run_s = float(m.group(1)) - t0 / 1e6
+    return {
+        "ticks": int(t.group(1)), "subs": int(t.group(2)),
+        "us_tick": float(c.group(1)), "us_sub": float(c.group(2)), "us_s": float(c.group(3)),
+        "changes": changes / run_s,
+        "means": {k: s / n for k, (s, n) in windows.items()},
+    }
+
+
+def deviation(means, ref):
+    common = [k for k in means if k in ref]
+    if not common:
+        return 0.0
+    return sum(abs(means[k] - ref[k]) / ref[k] for k in common) / len(common) * 100
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--rates", default="0,1,2", help="ENGINE_RATE values to run (comma separated)")
+    ap.add_argument("--switches", type=int, default=12, help="NEXT_MODE commands per run (default 12)")
+    ap.add_argument("--interval-ms", type=int, default=4000, help="time in each mode (default 4000)")
+    args = ap.parse_args()
+
+    if not os.path.exists(SIM):
+        sys.exit("%s not built (make -C Host/sim)" % SIM)
+    rates = [int(r) for r in args.rates.split(",")]
+    if 0 not in rates:
+        rates.insert(0, 0)
+    tmp = tempfile.mkdtemp(prefix="engine_rate_")
+    results = {r: run(r, args, tmp) for r in rates}
+    ref = results[0]
+
+    print("%4s %7s %9s %9s %9s %9s %6s %10s %7s" % ("rate", "ticks", "sub-ticks", "us/tick",
+                                                    "us/sub", "us/s", "load", "periods/s", "dev %"))
+    for r in rates:
+        x = results[r]
+        print("%4d %7d %9d %9.3f %9.3f %9.1f %5.2fx %10.1f %7.2f" %
+              (r, x["ticks"], x["subs"], x["us_tick"], x["us_sub"],
+               x["us_s"], x["us_s"] / ref["us_s"] if ref["us_s"] else 0.0, x["changes"],
+               deviation(x["means"], ref["means"])))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
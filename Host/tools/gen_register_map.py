@@ -0,0 +1,467 @@
+#!/usr/bin/env python3
+"""
+gen_register_map.py - Generate the firmware's virtual address decoder
+
+Reads register_map.def (see that file for the directive syntax) and writes
+MK312BT/register_map.h and MK312BT/register_map.c:
+
+  - VIRT_* address defines for every region, register and block
+  - a PROGMEM descriptor per register (kind, access rights, argument,
+    storage pointer)
+  - a two-level index: one byte per 16-byte block of each region, pointing
+    either at a 16-entry page of descriptor slots (sparse registers) or at
+    a linear storage chunk (channel blocks)
+
+regmap_decode() resolves any virtual address with one range check per
+region, one block-index read and at most one page read; no search, no
+switch ladder. regmap_bytecode_ptr() uses the same index for the mode
+bytecode interpreter.
+
+Usage:
+    python3 Host/tools/gen_register_map.py [--check]
+
+--check regenerates in memory and exits non-zero if the checked-in files
+are out of date.
+"""
+
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, "..", ".."))
+SPEC = os.path.join(HERE, "register_map.def")
+OUT_H = os.path.join(ROOT, "MK312BT", "register_map.h")
+OUT_C = os.path.join(ROOT, "MK312BT", "register_map.c")
+
+BLOCK = 16
+KINDS = ["none", "const", "ram8", "cfg", "cfg_mode", "handler", "eeprom"]
+DEFAULTS = {"zero": "none", "eeprom": "eeprom"}
+
+
+class SpecError(Exception):
+    pass
+
+
+def parse_int(text, where):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise SpecError("%s: bad number '%s'" % (where, text))
+
+
+def parse_access(text, where):
+    acc = 0
+    parts = text.split("+")
+    base = parts[0]
+    if "R" in base:
+        acc |= 1
+    if "W" in base:
+        acc |= 2
+    if base.replace("R", "").replace("W", ""):
+        raise SpecError("%s: bad access '%s'" % (where, text))
+    for extra in parts[1:]:
+        if extra != "BC":
+            raise SpecError("%s: bad access flag '%s'" % (where, extra))
+        acc |= 4
+    return acc
+
+
+def parse(path):
+    includes, regions, regs, blocks = [], [], [], []
+    with open(path) as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.split("#", 1)[0].strip()
+            if not line:
+                continue
+            where = "%s:%d" % (os.path.basename(path), lineno)
+            tok = line.split()
+            cond = None
+            if len(tok) > 2 and tok[-2] == "if":
+                cond, tok = tok[-1], tok[:-2]
+                if tok[0] not in ("reg", "block"):
+                    raise SpecError("%s: only reg and block can be conditional" % where)
+            d = tok[0]
+            if d == "include" and len(tok) == 2:
+                includes.append(tok[1])
+            elif d == "region" and len(tok) == 7:
+                base, end = parse_int(tok[2], where), parse_int(tok[3], where)
+                if base % BLOCK or end % BLOCK or end <= base:
+                    raise SpecError("%s: region must be 16-byte aligned" % where)
+                if tok[4] not in DEFAULTS or tok[6] not in ("abs", "rel"):
+                    raise SpecError("%s: bad region options" % where)
+                regions.append(dict(name=tok[1], base=base, end=end,
+                                    default=DEFAULTS[tok[4]], prefix=tok[5],
+                                    rel=tok[6] == "rel"))
+            elif d == "reg" and len(tok) in (6, 7):
+                kind = tok[5]
+                if kind not in KINDS[1:6]:
+                    raise SpecError("%s: bad kind '%s'" % (where, kind))
+                arg = tok[6] if len(tok) == 7 else "-"
+                if kind != "handler" and arg == "-":
+                    raise SpecError("%s: kind '%s' needs an argument" % (where, kind))
+                access = parse_access(tok[4], where)
+                if access & 4 and kind != "ram8":
+                    raise SpecError("%s: only ram8 registers take +BC" % where)
+                regs.append(dict(region=tok[1], addr=parse_int(tok[2], where),
+                                 name=tok[3], access=access,
+                                 kind=kind, arg=arg, cond=cond, where=where))
+            elif d == "block" and len(tok) == 7:
+                addr, size = parse_int(tok[2], where), parse_int(tok[3], where)
+                if addr % BLOCK or size % BLOCK or size == 0:
+                    raise SpecError("%s: block must be 16-byte aligned" % where)
+                blocks.append(dict(region=tok[1], addr=addr, size=size,
+                                   name=tok[4], access=parse_access(tok[5], where),
+                                   storage=tok[6], cond=cond, where=where))
+            else:
+                raise SpecError("%s: cannot parse '%s'" % (where, line))
+    return includes, regions, regs, blocks
+
+
+def build(includes, regions, regs, blocks):
+    by_name = {r["name"]: r for r in regions}
+    first_block = {}
+    nblocks = 0
+    for r in regions:
+        first_block[r["name"]] = nblocks
+        nblocks += (r["end"] - r["base"]) // BLOCK
+
+    index = [0] * nblocks          # 0 = region default
+    index_cond = {}                # block -> flag, for conditional entries
+    pages = []                     # list of 16-entry lists (desc index + 1)
+    page_cond = {}                 # (page, slot) -> flag
+    page_of_block = {}
+    chunks = []                    # (storage expr, offset, access, flag)
+    descs = []
+    handlers = []
+    seen = {}
+
+    def locate(region, addr, where):
+        if region not in by_name:
+            raise SpecError("%s: unknown region '%s'" % (where, region))
+        r = by_name[region]
+        if not r["base"] <= addr < r["end"]:
+            raise SpecError("%s: 0x%04X outside region %s" % (where, addr, region))
+        if addr in seen:
+            raise SpecError("%s: 0x%04X already mapped at %s" % (where, addr, seen[addr]))
+        seen[addr] = where
+        return r, first_block[region] + (addr - r["base"]) // BLOCK
+
+    # Conditional entries go last so that compiling them out (#if) leaves
+    # the numbering of everything else intact; a conditional run followed
+    # by another one is padded with blank rows (#else) to keep its numbers.
+    for b in sorted(blocks, key=lambda x: x["cond"] is not None):
+        for off in range(0, b["size"], BLOCK):
+            for i in range(BLOCK):
+                _, blk = locate(b["region"], b["addr"] + off + i, b["where"])
+            if index[blk]:
+                raise SpecError("%s: block overlaps registers" % b["where"])
+            if len(chunks) >= 0x7F:
+                raise SpecError("too many linear chunks")
+            index[blk] = 0x80 | len(chunks)
+            if b["cond"]:
+                index_cond[blk] = b["cond"]
+            chunks.append((b["storage"], off, b["access"], b["cond"]))
+
+    for reg in sorted(regs, key=lambda x: (x["cond"] is not None, x["addr"])):
+        r, blk = locate(reg["region"], reg["addr"], reg["where"])
+        if index[blk] & 0x80:
+            raise SpecError("%s: register inside a linear block" % reg["where"])
+        if blk not in page_of_block:
+            pages.append([0] * BLOCK)
+            page_of_block[blk] = len(pages) - 1
+            index[blk] = len(pages)
+            if reg["cond"]:
+                index_cond[blk] = reg["cond"]
+        elif not reg["cond"]:
+            index_cond.pop(blk, None)
+        if len(descs) >= 0xFF or len(pages) >= 0x80:
+            raise SpecError("register map too large for 8-bit index")
+        reg["define"] = r["prefix"] + reg["name"]
+        if reg["kind"] == "handler":
+            reg["handler"] = "REG_H_" + reg["define"][len("VIRT_"):]
+            handlers.append(reg["handler"])
+        descs.append(reg)
+        slot = (reg["addr"] - r["base"]) % BLOCK
+        pages[page_of_block[blk]][slot] = len(descs)
+        if reg["cond"]:
+            page_cond[(page_of_block[blk], slot)] = reg["cond"]
+
+    return dict(includes=includes, regions=regions, regs=regs, blocks=blocks,
+                first_block=first_block, nblocks=nblocks, index=index,
+                index_cond=index_cond, pages=pages, page_cond=page_cond,
+                chunks=chunks, descs=descs, handlers=handlers)
+
+
+def emit_rows(out, rows, blank):
+    """Emit (flag, line) rows with #if around each conditional run. A run
+    that is not the last one gets #else blank rows, so compiling it out
+    does not renumber the runs after it."""
+    runs = []
+    for flag, line in rows:
+        if runs and runs[-1][0] == flag:
+            runs[-1][1].append(line)
+        else:
+            runs.append((flag, [line]))
+    for n, (flag, lines) in enumerate(runs):
+        if flag:
+            out.append("#if %s\n" % flag)
+        out.extend(lines)
+        if flag:
+            if n < len(runs) - 1:
+                out.append("#else\n")
+                out.extend([blank] * len(lines))
+            out.append("#endif\n")
+
+
+def acc_expr(acc):
+    names = [n for bit, n in ((1, "REG_ACC_R"), (2, "REG_ACC_W"), (4, "REG_ACC_BC")) if acc & bit]
+    return " | ".join(names) if names else "0"
+
+
+BANNER = """\
+/*
+ * %s - %s
+ *
+ * GENERATED by Host/tools/gen_register_map.py from
+ * Host/tools/register_map.def. Do not edit by hand: change the .def file
+ * and regenerate.
+%s */
+"""
+
+
+def emit_h(m):
+    out = []
+    out.append(BANNER % ("register_map.h", "Virtual Register Map (generated)", """\
+ *
+ * Every address the serial protocol or the mode bytecode can touch is
+ * described once. regmap_decode() turns a virtual address into a
+ * descriptor in constant time; serial_mem.c acts on the descriptor.
+"""))
+    out.append("#ifndef REGISTER_MAP_H\n#define REGISTER_MAP_H\n\n#include <stdint.h>\n\n")
+    out.append('#ifdef __cplusplus\nextern "C" {\n#endif\n\n')
+
+    out.append("/* Virtual memory region boundaries */\n")
+    for r in m["regions"]:
+        out.append("#define VIRT_%-18s 0x%04X\n" % (r["name"] + "_BASE", r["base"]))
+        out.append("#define VIRT_%-18s 0x%04X\n" % (r["name"] + "_END", r["end"]))
+    out.append("\n")
+
+    for r in m["regions"]:
+        items = [g for g in m["regs"] if g["region"] == r["name"]]
+        blks = [b for b in m["blocks"] if b["region"] == r["name"]]
+        if not items and not blks:
+            continue
+        rel = " (offsets from VIRT_%s_BASE)" % r["name"] if r["rel"] else ""
+        out.append("/* %s registers%s */\n" % (r["name"], rel))
+        for b in blks:
+            base = b["addr"] - (r["base"] if r["rel"] else 0)
+            out.append("#define %-26s 0x%04X\n" % (r["prefix"] + b["name"] + "_BASE", base))
+            out.append("#define %-26s 0x%04X\n" % (r["prefix"] + b["name"] + "_END", base + b["size"]))
+        for g in sorted(items, key=lambda x: x["addr"]):
+            val = g["addr"] - (r["base"] if r["rel"] else 0)
+            out.append("#define %-26s 0x%04X\n" % (g["define"], val))
+        out.append("\n")
+
+    out.append("/* Descriptor kinds */\n")
+    for i, k in enumerate(KINDS):
+        out.append("#define REG_KIND_%-17s %d\n" % (k.upper(), i))
+    out.append("\n/* Access rights */\n")
+    out.append("#define REG_ACC_R                  0x01\n")
+    out.append("#define REG_ACC_W                  0x02\n")
+    out.append("#define REG_ACC_BC                 0x04  /* reachable from mode bytecode */\n\n")
+
+    out.append("/* Side-effect handler ids (implemented in serial_mem.c) */\n")
+    out.append("enum {\n")
+    for h in m["handlers"]:
+        out.append("    %s,\n" % h)
+    out.append("    REG_H_COUNT\n};\n\n")
+
+    out.append("""\
+/* Decoded register. ptr is the byte to access for REG_KIND_RAM8; arg is
+ * the value (CONST), system_config_t offset (CFG, CFG_MODE) or handler id. */
+typedef struct {
+    uint8_t kind;
+    uint8_t access;
+    uint8_t arg;
+    void   *ptr;
+} reg_desc_t;
+
+uint8_t  regmap_decode(uint16_t addr, reg_desc_t *out);  /* Returns out->kind */
+uint8_t* regmap_bytecode_ptr(uint16_t addr);             /* NULL unless REG_ACC_BC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+""")
+    return "".join(out)
+
+
+def emit_c(m):
+    out = []
+    out.append(BANNER % ("register_map.c", "Virtual Register Map tables (generated)", ""))
+    out.append('\n#include "register_map.h"\n')
+    for inc in m["includes"]:
+        out.append('#include "%s"\n' % inc)
+    out.append("#include <avr/pgmspace.h>\n#include <stddef.h>\n\n")
+
+    out.append("/* Linear storage chunk: one 16-byte block of a block directive */\n")
+    out.append("typedef struct {\n    void   *ptr;\n    uint8_t access;\n} reg_chunk_t;\n\n")
+
+    out.append("#define REGMAP_LINEAR  0x80\n\n")
+    for r in m["regions"]:
+        out.append("#define REGMAP_FIRST_%-8s %d\n" % (r["name"], m["first_block"][r["name"]]))
+    out.append("#define REGMAP_BLOCKS        %d\n\n" % m["nblocks"])
+
+    out.append("static const reg_desc_t regmap_desc[] PROGMEM = {\n")
+    rows = []
+    for i, g in enumerate(m["descs"]):
+        kind = "REG_KIND_" + g["kind"].upper()
+        arg, ptr = "0", "NULL"
+        if g["kind"] == "const":
+            arg = g["arg"]
+        elif g["kind"] == "ram8":
+            ptr = "(void*)&%s" % g["arg"]
+        elif g["kind"] in ("cfg", "cfg_mode"):
+            arg = "offsetof(system_config_t, %s)" % g["arg"]
+        elif g["kind"] == "handler":
+            arg = g["handler"]
+        rows.append((g["cond"], "    /* %2d */ { %-19s %-24s %-42s %s },  /* 0x%04X %s */\n" % (
+            i + 1, kind + ",", acc_expr(g["access"]) + ",", arg + ",", ptr,
+            g["addr"], g["define"])))
+    emit_rows(out, rows, "    /* -- */ { REG_KIND_NONE,      0,                       0,                                         NULL },\n")
+    out.append("};\n\n")
+
+    out.append("static const reg_chunk_t regmap_chunk[] PROGMEM = {\n")
+    emit_rows(out, [(flag, "    { (uint8_t*)&%s + 0x%02X, %s },\n" % (storage, off, acc_expr(acc)))
+                    for storage, off, acc, flag in m["chunks"]], "    { NULL, 0 },\n")
+    if not m["chunks"]:
+        out.append("    { NULL, 0 },\n")
+    out.append("};\n\n")
+
+    out.append("/* Sparse pages: descriptor number (1-based) per address, 0 = unmapped */\n")
+    out.append("static const uint8_t regmap_page[][16] PROGMEM = {\n")
+    for n, p in enumerate(m["pages"]):
+        cells = []
+        for slot, v in enumerate(p):
+            flag = m["page_cond"].get((n, slot))
+            cells.append("(%s ? %d : 0)" % (flag, v) if flag else "%2d" % v)
+        out.append("    { %s },\n" % ", ".join(cells))
+    out.append("};\n\n")
+
+    out.append("/* Block index: 0 = region default, 1..0x7F = page + 1, 0x80|n = chunk n */\n")
+    out.append("static const uint8_t regmap_index[REGMAP_BLOCKS] PROGMEM = {\n")
+    for r in m["regions"]:
+        first = m["first_block"][r["name"]]
+        cnt = (r["end"] - r["base"]) // BLOCK
+        row = m["index"][first:first + cnt]
+        out.append("    /* %s */\n" % r["name"])
+        for i in range(0, cnt, 16):
+            cells = []
+            for j, v in enumerate(row[i:i + 16]):
+                flag = m["index_cond"].get(first + i + j)
+                cells.append("(%s ? 0x%02X : 0)" % (flag, v) if flag else "0x%02X" % v)
+            out.append("    %s,\n" % ", ".join(cells))
+    out.append("};\n\n")
+
+    out.append("""\
+uint8_t regmap_decode(uint16_t addr, reg_desc_t *out) {
+    uint8_t blk, dflt, entry, slot;
+
+""")
+    first = True
+    for r in m["regions"]:
+        kw = "if" if first else "} else if"
+        first = False
+        out.append("    %s ((uint16_t)(addr - VIRT_%s_BASE) < (VIRT_%s_END - VIRT_%s_BASE)) {\n" % (
+            kw, r["name"], r["name"], r["name"]))
+        out.append("        blk  = REGMAP_FIRST_%s + ((addr - VIRT_%s_BASE) >> 4);\n" % (r["name"], r["name"]))
+        out.append("        dflt = REG_KIND_%s;\n" % r["default"].upper())
+    out.append("""\
+    } else {
+        blk  = 0;
+        dflt = REG_KIND_NONE;
+        goto unmapped;
+    }
+
+    entry = pgm_read_byte(&regmap_index[blk]);
+    if (entry & REGMAP_LINEAR) {
+        const reg_chunk_t *c = &regmap_chunk[entry & ~REGMAP_LINEAR];
+        out->kind   = REG_KIND_RAM8;
+        out->access = pgm_read_byte(&c->access);
+        out->arg    = 0;
+        out->ptr    = (uint8_t*)pgm_read_ptr(&c->ptr) + (addr & 0x0F);
+        return REG_KIND_RAM8;
+    }
+    if (entry) {
+        slot = pgm_read_byte(&regmap_page[entry - 1][addr & 0x0F]);
+        if (slot) {
+            memcpy_P(out, &regmap_desc[slot - 1], sizeof(reg_desc_t));
+            return out->kind;
+        }
+    }
+
+unmapped:
+    out->kind   = dflt;
+    out->access = (dflt == REG_KIND_NONE) ? 0 : (REG_ACC_R | REG_ACC_W);
+    out->arg    = 0;
+    out->ptr    = NULL;
+    return dflt;
+}
+
+/* Bytecode addresses are RAM region offsets (0x000-0x3FF). */
+uint8_t* regmap_bytecode_ptr(uint16_t addr) {
+    uint8_t entry, slot;
+    const reg_chunk_t *c;
+    const reg_desc_t *d;
+
+    if (addr >= (VIRT_RAM_END - VIRT_RAM_BASE)) return NULL;
+    entry = pgm_read_byte(&regmap_index[REGMAP_FIRST_RAM + (addr >> 4)]);
+    if (entry & REGMAP_LINEAR) {
+        c = &regmap_chunk[entry & ~REGMAP_LINEAR];
+        if (!(pgm_read_byte(&c->access) & REG_ACC_BC)) return NULL;
+        return (uint8_t*)pgm_read_ptr(&c->ptr) + (addr & 0x0F);
+    }
+    if (!entry) return NULL;
+    slot = pgm_read_byte(&regmap_page[entry - 1][addr & 0x0F]);
+    if (!slot) return NULL;
+    d = &regmap_desc[slot - 1];
+    if (!(pgm_read_byte(&d->access) & REG_ACC_BC)) return NULL;
+    return (uint8_t*)pgm_read_ptr(&d->ptr);
+}
+""")
+    return "".join(out)
+
+
+def main(argv):
+    check = "--check" in argv
+    try:
+        m = build(*parse(SPEC))
+    except SpecError as e:
+        sys.stderr.write("register_map.def: %s\n" % e)
+        return 1
+    if "RAM" not in m["first_block"]:
+        sys.stderr.write("register_map.def: a RAM region is required\n")
+        return 1
+    outputs = {OUT_H: emit_h(m), OUT_C: emit_c(m)}
+    stale = []
+    for path, text in outputs.items():
+        old = open(path).read() if os.path.exists(path) else None
+        if old != text:
+            stale.append(path)
+            if not check:
+                with open(path, "w") as f:
+                    f.write(text)
+    if check and stale:
+        for p in stale:
+            sys.stderr.write("out of date: %s\n" % os.path.relpath(p, ROOT))
+        return 1
+    if not check:
+        for p in outputs:
+            print("wrote %s" % os.path.relpath(p, ROOT))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+mirror_bench.py - Wire bytes per UI interaction, direct vs. register mirror
+
+Starts two emulated boxes (Host/sim/build/mk312bt-sim --pty) and plays
+the same scripted UI session against each: once with every write and
+read sent straight to the box, once through mk312link.Mirror. Events are
+paced in real time like a UI would send them, so the mirror's flush
+interval sees realistic bursts. Both links do the key exchange, so the
+frames are the ones a real controller sends.
+
+Usage:
+    python3 Host/tools/mirror_bench.py [--flush-ms 50] [--port PATH]
+
+--port runs against a real box (or an already running sim) instead, one
+pass after the other. The report gives, per interaction, bytes on the
+wire in both directions, frames, and the wire time at 19200 baud. After
+the manual-control steps both boxes are read back to check that the
+mirror left the same register values as the direct run.
+"""
+
+import argparse
+import sys
+import time
+
+from mk312link import BYTE_S, Link, Mirror, start_sims, stop_sims
+
+CHAN_A, CHAN_B = 0x4080, 0x4180
+INTENSITY, FREQ, WIDTH = 0x25, 0x2E, 0x37
+VALUE, MIN, MAX, RATE, SELECT = 0, 1, 2, 3, 7
+REG_CURRENT_MODE = 0x407B
+PANEL = [ch + g + f for ch in (CHAN_A, CHAN_B) for g in (INTENSITY, FREQ, WIDTH)
+         for f in (VALUE, MIN, MAX, RATE, SELECT)]
+
+
+class Direct:
+    """Same interface as Mirror, every access on the wire."""
+
+    def __init__(self, link):
+        self.link = link
+
+    def write(self, addr, data):
+        self.link.write(addr, [data] if isinstance(data, int) else data)
+
+    def read(self, addr):
+        return self.link.read(addr)
+
+    def service(self):
+        pass
+
+    def flush(self):
+        pass
+
+
+def paced(events, gap_s, client):
+    """Run the event callables gap_s apart, servicing the client between."""
+    for ev in events:
+        ev()
+        end = time.monotonic() + gap_s
+        while time.monotonic() < end:
+            client.service()
+            time.sleep(0.002)
+
+
+def session(c):
+    """(name, UI events, callable) in order; each callable drives client c."""
+    def take_control():
+        for ch in (CHAN_A, CHAN_B):
+            for g, v in ((INTENSITY, 0x80), (FREQ, 0x40), (WIDTH, 0x82)):
+                c.write(ch + g + SELECT, 0)
+                c.write(ch + g + VALUE, v)
+
+    def slider():
+        paced([lambda v=v: c.write(CHAN_A + INTENSITY + VALUE, v)
+               for v in range(0x80, 0xD0, 2)], 0.010, c)
+
+    def range_dialog():
+        for ch in (CHAN_A, CHAN_B):
+            c.write(ch + INTENSITY + MIN, 0x40)
+            c.write(ch + INTENSITY + MAX, 0xE0)
+            c.write(ch + INTENSITY + RATE, 0x04)
+            c.write(ch + FREQ + MIN, 0x20)
+            c.write(ch + FREQ + MAX, 0xC0)
+
+    def nudge():
+        steps = [1] * 10 + [-1] * 10
+        state = {"w": 0x82}
+
+        def one(d):
+            state["w"] += d
+            c.write(CHAN_B + WIDTH + VALUE, state["w"])
+        paced([lambda d=d: one(d) for d in steps], 0.025, c)
+
+    def refresh():
+        paced([lambda: [c.read(a) for a in PANEL]] * 4, 0.100, c)
+
+    def mode_change():
+        c.write(REG_CURRENT_MODE, (c.read(REG_CURRENT_MODE) + 1 - 0x76) % 26 + 0x76)
+        time.sleep(0.2)
+        for a in PANEL:
+            c.read(a)
+
+    return [("take control", 12, take_control),
+            ("intensity slider", 40, slider),
+            ("range dialog", 10, range_dialog),
+            ("width nudge +10/-10", 20, nudge),
+            ("panel refresh x4", 120, refresh),
+            ("mode change + refresh", 32, mode_change)]
+
+
+CHECK_AFTER = "panel refresh x4"
+
+
+def run(path, mirrored, flush_s):
+    link = Link(path)
+    link.handshake()
+    link.key_exchange()
+    client = Mirror(link, flush_s) if mirrored else Direct(link)
+    rows, check = [], None
+    for name, events, fn in session(client):
+        b0, f0, t0 = link.wire_bytes(), link.frames, time.monotonic()
+        fn()
+        client.flush()
+        rows.append((name, events, link.wire_bytes() - b0, link.frames - f0,
+                     time.monotonic() - t0))
+        if name == CHECK_AFTER:
+            check = [link.read(a) for a in PANEL]
+    stats = (client.hits, client.misses, client.collapsed) if mirrored else None
+    link.close()
+    return rows, check, stats
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--flush-ms", type=float, default=50, help="mirror flush interval (default 50)")
+    ap.add_argument("--port", help="use this box for both passes instead of two emulated boxes")
+    args = ap.parse_args()
+
+    procs = []
+    if args.port:
+        paths = [args.port, args.port]
+    else:
+        procs, paths, _ = start_sims([[], []])
+    try:
+        direct, check_d, _ = run(paths[0], False, 0)
+        mirror, check_m, stats = run(paths[1], True, args.flush_ms / 1000.0)
+    except (IOError, OSError) as e:
+        sys.exit(str(e))
+    finally:
+        stop_sims(procs)
+
+    print("%-22s %6s  %14s  %14s  %6s  %9s" % ("interaction", "events", "direct B/fr",
+                                                "mirror B/fr", "saved", "wire ms"))
+    td = tm = 0
+    for (name, events, bd, fd, _), (_, _, bm, fm, _) in zip(direct, mirror):
+        td += bd
+        tm += bm
+        print("%-22s %6d  %8d/%-5d  %8d/%-5d  %5.0f%%  %4.0f/%-4.0f" %
+              (name, events, bd, fd, bm, fm, 100.0 * (bd - bm) / bd,
+               bd * BYTE_S * 1000, bm * BYTE_S * 1000))
+    print("%-22s %6s  %8d        %8d        %5.0f%%" % ("total", "", td, tm, 100.0 * (td - tm) / td))
+    print("mirror: %d reads served locally, %d from the box, %d writes collapsed" % stats)
+    if check_d != check_m:
+        diff = ["0x%04X %02X/%02X" % (a, d, m) for a, d, m in zip(PANEL, check_d, check_m) if d != m]
+        print("MISMATCH after '%s': %s" % (CHECK_AFTER, ", ".join(diff)))
+        return 1
+    print("registers match after '%s' (%d bytes)" % (CHECK_AFTER, len(PANEL)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
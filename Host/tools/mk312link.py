@@ -0,0 +1,368 @@
+"""
+mk312link.py - Host-side controller library for the MK-312BT serial protocol
+
+Import from the other Host/tools scripts (or add Host/tools to sys.path):
+
+    from mk312link import Link, Mirror
+
+Link is one serial connection (a real port or an emulated box on a
+pseudo terminal) speaking the legacy frames of Documentation/
+SERIAL_PROTOCOL.md: handshake, optional key exchange, single-byte READ,
+1-12 byte WRITE and the 1-16 character LCD_WRITE. It counts every byte on
+the wire in both directions.
+
+Mirror sits on a Link and keeps a host-side copy of the virtual address
+space (0x0000-0x00FF flash, 0x4000-0x43FF RAM, 0x8000-0x81FF EEPROM):
+
+  - Writes are held for up to flush_interval seconds. Writes to the same
+    address within the interval collapse into one; at flush, dirty bytes
+    that are adjacent (or a few known bytes apart) go out as one
+    multi-byte WRITE. Values equal to what the box already holds are
+    dropped.
+  - Reads of a known byte are answered locally. Bytes the firmware
+    changes on its own are "live" and always read from the box.
+  - Writes to registers with side effects (box commands, mode, power
+    level, SYNC_CTRL, ...) are never delayed or merged: pending bytes are
+    flushed first, then the write goes out on its own.
+  - A mode change (CURRENT_MODE or BOX_COMMAND written, or a changed mode
+    seen through poll_mode() / observe()) invalidates all of RAM.
+
+Which bytes are live or have side effects comes from register_map.def:
+handler registers, ram8 registers and read-only blocks are live; writable
+handler registers have side effects. Inside the channel blocks the
+engine-owned bytes (routine timers, gate value, module timer) are live,
+and so are value, min, select and timer of each parameter group unless
+the group's select byte is known to be 0 (static, see param_engine.c).
+Modules started by a running mode may still rewrite any channel byte;
+call invalidate() after handing a channel back to a mode.
+"""
+
+import os
+import select
+import struct
+import subprocess
+import sys
+import tempfile
+import termios
+import time
+
+import gen_register_map
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, "..", ".."))
+SIM = os.path.join(ROOT, "Host", "sim", "build", "mk312bt-sim")
+
+BAUD = 19200
+BYTE_S = 10.0 / BAUD
+MAX_WRITE = 12                  # Data bytes per WRITE frame (opcode nibble 15)
+MAX_LCD_WRITE = 16              # Characters per LCD_WRITE frame
+LCD_SIZE = 32                   # Two rows of 16; row 1 starts at 16
+FRAME_OVERHEAD = 5              # Opcode, address, checksum, 0x06 reply
+
+CMD_SYNC = 0x00
+CMD_READ = 0x3C
+CMD_WRITE = 0x0D
+CMD_KEY_EXCHANGE = 0x2F
+CMD_LCD_WRITE = 0x4C
+REPLY_READ = 0x22
+REPLY_KEY_EXCHANGE = 0x21
+REPLY_OK = 0x06
+REPLY_SYNC = 0x07
+
+REG_BOX_COMMAND = 0x4070
+REG_CURRENT_MODE = 0x407B
+REG_DOSE_CTRL = 0x43AF
+DOSE_BLOCKS = (0x43B0, 0x43F0)                  # Channel A, B snapshots
+DOSE_SNAPSHOT = 0x01
+DOSE_RESET = 0x80
+RAM = (0x4000, 0x4400)
+CHANNELS = (0x4080, 0x4180)
+CHANNEL_SIZE = 0x40
+GROUPS = (0x1C, 0x25, 0x2E, 0x37)               # ramp, intensity, freq, width
+GROUP_LIVE = (0, 1, 7, 8)                       # value, min, select, timer
+CHANNEL_LIVE = (0x02, 0x08, 0x09, 0x0A, 0x0B, 0x10, 0x14, 0x1B)
+
+
+class Link:
+    """One legacy-protocol connection."""
+
+    def __init__(self, path, timeout=1.0):
+        self.path = path
+        self.timeout = timeout
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[0] = attrs[1] = attrs[3] = 0                  # raw
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[4] = attrs[5] = termios.B19200
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.key = None
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+        self.frames = 0
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, frame):
+        if self.key is not None:
+            frame = bytes(b ^ self.key for b in frame)
+        os.write(self.fd, frame)
+        self.tx_bytes += len(frame)
+
+    def recv(self, n, timeout=None):
+        data = b""
+        end = time.monotonic() + (self.timeout if timeout is None else timeout)
+        while len(data) < n:
+            left = end - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                raise IOError("%s: timeout" % self.path)
+            data += os.read(self.fd, n - len(data))
+        self.rx_bytes += len(data)
+        return data
+
+    def handshake(self):
+        for _ in range(20):
+            self.send(bytes([CMD_SYNC]))
+            try:
+                if self.recv(1, 0.5) == bytes([REPLY_SYNC]):
+                    return
+            except IOError:
+                pass
+        raise IOError("%s: no reply to sync" % self.path)
+
+    def key_exchange(self, host_key=0):
+        """Switch the link to encrypted frames (host to box only)."""
+        frame = bytes([CMD_KEY_EXCHANGE, host_key])
+        self.send(frame + bytes([sum(frame) & 0xFF]))
+        reply = self.recv(3)
+        if reply[0] != REPLY_KEY_EXCHANGE or reply[2] != (reply[0] + reply[1]) & 0xFF:
+            raise IOError("%s: bad key exchange reply %s" % (self.path, reply.hex()))
+        self.key = reply[1] ^ host_key ^ 0x55
+
+    def write(self, addr, data):
+        """One WRITE frame; returns the time the 0x06 reply arrived."""
+        data = bytes(data)
+        if not 1 <= len(data) <= MAX_WRITE:
+            raise ValueError("WRITE carries 1-%d bytes, not %d" % (MAX_WRITE, len(data)))
+        frame = bytes([((3 + len(data)) << 4) | CMD_WRITE, addr >> 8, addr & 0xFF]) + data
+        self.send(frame + bytes([sum(frame) & 0xFF]))
+        self.frames += 1
+        reply = self.recv(1)
+        if reply != bytes([REPLY_OK]):
+            raise IOError("%s: write 0x%04X answered %s" % (self.path, addr, reply.hex()))
+        return time.monotonic()
+
+    def lcd_write(self, pos, text):
+        """One LCD_WRITE frame: text (str or bytes) into the box's LCD
+        framebuffer from position pos (0-31, wrapping), shown on the panel
+        within a few ms. The first one takes the panel from the menu."""
+        text = text.encode("latin-1") if isinstance(text, str) else bytes(text)
+        if not 1 <= len(text) <= MAX_LCD_WRITE:
+            raise ValueError("LCD_WRITE carries 1-%d characters, not %d" % (MAX_LCD_WRITE, len(text)))
+        frame = bytes([CMD_LCD_WRITE, pos % LCD_SIZE, len(text)]) + text
+        self.send(frame + bytes([sum(frame) & 0xFF]))
+        self.frames += 1
+        reply = self.recv(1)
+        if reply != bytes([REPLY_OK]):
+            raise IOError("%s: LCD write answered %s" % (self.path, reply.hex()))
+
+    def read(self, addr):
+        frame = bytes([CMD_READ, addr >> 8, addr & 0xFF])
+        self.send(frame + bytes([sum(frame) & 0xFF]))
+        self.frames += 1
+        reply = self.recv(3)
+        if reply[0] != REPLY_READ or reply[2] != (reply[0] + reply[1]) & 0xFF:
+            raise IOError("%s: bad read reply %s" % (self.path, reply.hex()))
+        return reply[1]
+
+    def read16(self, addr):
+        """Signed little-endian 16-bit register pair."""
+        v = self.read(addr) | (self.read(addr + 1) << 8)
+        return v - 0x10000 if v & 0x8000 else v
+
+    def dose(self, reset=False):
+        """Dose meter snapshot since the last reset, per channel
+        (pulses, Gate+ us, Gate- us, energy in us at full scale).
+        reset=True starts the next interval at the same instant. Needs
+        firmware built with DOSE_METER_ENABLE=1."""
+        self.write(REG_DOSE_CTRL, [DOSE_SNAPSHOT | (DOSE_RESET if reset else 0)])
+        return [struct.unpack("<4I", bytes(self.read(b + i) for i in range(16)))
+                for b in DOSE_BLOCKS]
+
+    def wire_bytes(self):
+        return self.tx_bytes + self.rx_bytes
+
+
+def register_classes(spec=gen_register_map.SPEC):
+    """(live, side_effect) address sets from register_map.def."""
+    _, _, regs, blocks = gen_register_map.parse(spec)
+    live, side = set(), set()
+    for r in regs:
+        if r["kind"] == "handler":
+            (side if r["access"] & 2 else live).add(r["addr"])
+        elif r["kind"] == "ram8":
+            live.add(r["addr"])
+    for b in blocks:
+        if not b["access"] & 2:
+            live.update(range(b["addr"], b["addr"] + b["size"]))
+    for ch in CHANNELS:
+        live.update(ch + off for off in CHANNEL_LIVE)
+    return live, side
+
+
+class Mirror:
+    """Write-coalescing, read-caching view of one box's address space."""
+
+    LIVE, SIDE_EFFECT = register_classes()
+
+    def __init__(self, link, flush_interval=0.05, bridge=FRAME_OVERHEAD - 1):
+        self.link = link
+        self.flush_interval = flush_interval
+        self.bridge = bridge            # Known bytes a WRITE may carry to join two runs
+        self.known = {}                 # addr -> value the box holds
+        self.pending = {}               # addr -> value to write at the next flush
+        self.deadline = None
+        self.mode = None
+        self.hits = 0
+        self.misses = 0
+        self.collapsed = 0
+
+    # ---- classification ----------------------------------------------
+    def is_live(self, addr):
+        if addr in self.LIVE:
+            return True
+        for ch in CHANNELS:
+            off = addr - ch
+            if 0 <= off < CHANNEL_SIZE:
+                for g in GROUPS:
+                    if off - g in GROUP_LIVE:
+                        return self._value(ch + g + 7) != 0
+        return False
+
+    # ---- reads -------------------------------------------------------
+    def read(self, addr):
+        if addr in self.pending:
+            self.hits += 1
+            return self.pending[addr]
+        if addr in self.known and not self.is_live(addr):
+            self.hits += 1
+            return self.known[addr]
+        self.misses += 1
+        value = self.link.read(addr)
+        self.known[addr] = value
+        if addr == REG_CURRENT_MODE:
+            self._mode_seen(value)
+        return value
+
+    def read_block(self, addr, n):
+        return bytes(self.read(addr + i) for i in range(n))
+
+    # ---- writes ------------------------------------------------------
+    def write(self, addr, data):
+        if isinstance(data, int):
+            data = [data]
+        data = bytes(data)
+        span = range(addr, addr + len(data))
+        if any(a in self.SIDE_EFFECT for a in span):
+            self.flush()
+            for i in range(0, len(data), MAX_WRITE):
+                self.link.write(addr + i, data[i:i + MAX_WRITE])
+            self.known.update(zip(span, data))
+            if REG_BOX_COMMAND in span or REG_CURRENT_MODE in span:
+                self.invalidate()
+            return
+        for a, v in zip(span, data):
+            if a in self.pending:
+                self.collapsed += 1
+            self.pending[a] = v
+        if self.deadline is None:
+            self.deadline = time.monotonic() + self.flush_interval
+        self.service()
+
+    def service(self):
+        """Flush if the oldest pending write is due; call from the UI loop."""
+        if self.deadline is not None and time.monotonic() >= self.deadline:
+            self.flush()
+
+    def flush(self):
+        self.deadline = None
+        dirty = sorted(a for a, v in self.pending.items()
+                       if self.known.get(a) != v or self.is_live(a))
+        for start, data in self._runs(dirty):
+            self.link.write(start, data)
+            self.known.update(zip(range(start, start + len(data)), data))
+        self.pending.clear()
+
+    def _value(self, addr):
+        return self.pending.get(addr, self.known.get(addr))
+
+    def _bridgeable(self, start, end):
+        return all(a in self.known and a not in self.SIDE_EFFECT and not self.is_live(a)
+                   for a in range(start, end))
+
+    def _runs(self, dirty):
+        """Merge dirty addresses into WRITE frames, sent in the order the
+        host first wrote them (a select byte before the value it frees)."""
+        order = {a: i for i, a in enumerate(self.pending)}
+        runs = []
+        for a in dirty:
+            if runs:
+                start, last, first = runs[-1]
+                gap = a - last - 1
+                if (a - start < MAX_WRITE and gap <= self.bridge and
+                        self._bridgeable(last + 1, a)):
+                    runs[-1] = (start, a, min(first, order[a]))
+                    continue
+            runs.append((a, a, order[a]))
+        runs.sort(key=lambda r: r[2])
+        return [(s, bytes(self._value(a) for a in range(s, e + 1))) for s, e, _ in runs]
+
+    # ---- invalidation ------------------------------------------------
+    def invalidate(self, start=RAM[0], end=RAM[1]):
+        """Forget what the box holds in [start, end); pending writes stay."""
+        for a in [a for a in self.known if start <= a < end]:
+            del self.known[a]
+
+    def observe(self, addr, value):
+        """Telemetry: the box was seen holding value at addr."""
+        self.known[addr] = value
+        if addr == REG_CURRENT_MODE:
+            self._mode_seen(value)
+
+    def poll_mode(self):
+        """Read CURRENT_MODE; a change (front panel, mode program) invalidates RAM."""
+        return self.read(REG_CURRENT_MODE)
+
+    def _mode_seen(self, mode):
+        if self.mode is not None and mode != self.mode:
+            self.invalidate()
+            self.known[REG_CURRENT_MODE] = mode
+        self.mode = mode
+
+
+def start_sims(extra_args, logdir=None):
+    """Start one mk312bt-sim per argument list with --pty-link into a
+    temporary directory; returns (processes, pty paths, directory)."""
+    if not os.path.exists(SIM):
+        sys.exit("%s not built (make -C Host/sim)" % SIM)
+    tmp = logdir or tempfile.mkdtemp(prefix="mk312link.")
+    procs, links = [], []
+    for i, args in enumerate(extra_args):
+        link = os.path.join(tmp, "box%d" % i)
+        log = open(os.path.join(tmp, "box%d.log" % i), "w")
+        procs.append(subprocess.Popen([SIM, "--pty-link", link] + list(args),
+                                      stdout=log, stderr=log))
+        links.append(link)
+    end = time.monotonic() + 10
+    while not all(os.path.exists(l) for l in links):
+        if time.monotonic() > end:
+            sys.exit("simulators did not start (logs in %s)" % tmp)
+        time.sleep(0.05)
+    return procs, links, tmp
+
+
+def stop_sims(procs):
+    for p in procs:
+        p.terminate()
+        p.wait()
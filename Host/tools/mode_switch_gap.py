@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+mode_switch_gap.py - Output gap at each mode switch
+
+Steps the emulated box (Host/sim/build/mk312bt-sim) through the modes
+with NEXT_MODE box commands (0x4070 = 0x10), one every --interval-ms,
+and measures from the pulse trace how long each channel's output stops
+around each switch. The gap is the time between the last pulse before
+the switch and the first one after it; the expected gap is the longer
+of the pulse periods on either side. Anything beyond that is downtime.
+Pulses lost is the gap in units of the expected gap, rounded, less one.
+
+Usage:
+    python3 Host/tools/mode_switch_gap.py [--switches 25] [--xfade 16]
+
+One row per switch and channel: pulse periods before and after, the
+gap, the downtime in us and the pulses lost. A channel whose mode gates
+the output off around the switch (no pulse within --window-ms on one
+side, or none for half a period before the switch) is listed as gated
+and left out of the totals. --xfade sets the
+mode-switch crossfade (MODE_XFADE, 0x4398) before the first switch.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+from mk312link import SIM
+
+BOX_COMMAND = 0x4070
+NEXT_MODE = 0x10
+MODE_XFADE = 0x4398
+START_MS = 6000             # Past the startup screens
+
+
+def write_frame(addr, value):
+    return "frame 4D %02X %02X %02X" % (addr >> 8, addr & 0xFF, value)
+
+
+def scenario(switches, interval_ms, xfade):
+    lines = ["0 knob A 600", "0 knob B 600", "%d serial 00" % START_MS]
+    if xfade is not None:
+        lines.append("%d %s" % (START_MS + 100, write_frame(MODE_XFADE, xfade)))
+    times = [START_MS + 1000 + i * interval_ms for i in range(switches)]
+    lines += ["%d %s" % (t, write_frame(BOX_COMMAND, NEXT_MODE)) for t in times]
+    lines.append("%d end" % (times[-1] + interval_ms))
+    return "\n".join(lines) + "\n", times
+
+
+def parse(trace):
+    """Pulses per channel as (start us, period us), and the ack times."""
+    out = {"A": [], "B": []}
+    acks = []
+    for line in open(trace):
+        f = line.split()
+        if len(f) == 4 and f[1] == "pulse":
+            out[f[2]].append((int(f[0]), int(f[3])))
+        elif len(f) == 3 and f[1] == "tx" and f[2] == "06":
+            acks.append(int(f[0]))
+    return out, acks
+
+
+def measure(train, t_us, window_us):
+    """(before, after, gap) periods around t_us, or None when gated."""
+    i = next((k for k, (t, _) in enumerate(train) if t > t_us), None)
+    if i is None or i == 0 or i + 1 >= len(train):
+        return None
+    gap = train[i][1]
+    before = train[i - 1][1]
+    after = train[i + 1][1]
+    if gap > window_us or before > window_us or after > window_us:
+        return None
+    if t_us - (train[i][0] - gap) > before * 3 // 2:
+        return None                 # The old mode had already gated it off
+    return before, after, gap
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--switches", type=int, default=25, help="NEXT_MODE commands to send (default 25)")
+    ap.add_argument("--interval-ms", type=int, default=1500, help="time between switches (default 1500)")
+    ap.add_argument("--window-ms", type=int, default=60, help="longest period that counts as running output")
+    ap.add_argument("--xfade", type=int, help="MODE_XFADE ticks to set first")
+    args = ap.parse_args()
+
+    if not os.path.exists(SIM):
+        sys.exit("%s not built (make -C Host/sim)" % SIM)
+    tmp = tempfile.mkdtemp(prefix="mode_switch_gap_")
+    scn = os.path.join(tmp, "switch.scn")
+    trc = os.path.join(tmp, "switch.trace")
+    text, times = scenario(args.switches, args.interval_ms, args.xfade)
+    with open(scn, "w") as f:
+        f.write(text)
+    subprocess.run([SIM, "-s", scn, "--trace", trc], check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    trains, acks = parse(trc)
+
+    print("%6s %2s  %9s %9s %9s %9s %5s" % ("switch", "ch", "before", "after", "gap",
+                                           "down us", "lost"))
+    measured = lost_total = down_worst = 0
+    for n, t in enumerate(times):
+        # The box runs the queued switch in the loop pass that acked the frame
+        t_us = next(a for a in acks if a > t * 1000)
+        for ch in "AB":
+            m = measure(trains[ch], t_us, args.window_ms * 1000)
+            if m is None:
+                print("%6d %2s  %9s" % (n + 1, ch, "gated"))
+                continue
+            before, after, gap = m
+            down = max(0, gap - max(before, after))
+            lost = max(0, int(gap / max(before, after) + 0.5) - 1)
+            measured += 1
+            lost_total += lost
+            down_worst = max(down_worst, down)
+            print("%6d %2s  %9d %9d %9d %9d %5d" % (n + 1, ch, before, after, gap, down, lost))
+    print("%d switch edges measured: %d pulses lost, worst downtime %d us" %
+          (measured, lost_total, down_worst))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
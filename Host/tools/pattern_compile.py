@@ -0,0 +1,907 @@
+#!/usr/bin/env python3
+"""
+pattern_compile.py - Compile mode patterns to module bytecode, with costs
+
+Translates a readable pattern file into the bytecode executed by
+execute_module() (MK312BT/mode_dispatcher.c) and user_prog_execute()
+(MK312BT/user_programs.c), see Documentation/MK312BT_INSTRUCTION_SET.md.
+For every module, user slot and mode it reports:
+
+  - flash bytes (module array incl. terminator) or slot bytes used of 30
+  - interpreter cycles for one execution of the module
+  - steady-state param_engine_tick() cycles once the module has run,
+    from the select/rate/step settings it leaves in the channel blocks,
+    including modules it triggers from sweep boundaries or the next-module
+    timer
+
+Cycle counts come from a static model of the interpreter and engine code
+paths (COST below). They rank patterns and catch expensive ones; they are
+not target measurements.
+
+Pattern file:
+
+    module 40 "Slow stroke"          # built-in module number, optional name
+        apply both                   # SET apply_channel (A | B | both)
+        ma_at_knob_min = 0x00        # SET, routed by apply_channel
+        B.intensity_min = 0xE6       # SET forced to channel B
+        A.width_value = 200          # COPY to channel A (no forced-A SET)
+        intensity_select = timer 244hz, rate ma, min ~adv
+        intensity_action_max = rev_toggle   # reverse | rev_toggle | loop | stop | module N
+        gate_select = timer 30hz, on ma, off tempo
+        gate_value = on, biphasic    # on, pos | neg | biphasic, alt, invert
+        freq_step += 1               # MATHOP: += -= &= |= ^=
+        width_rate /= 2              # MEMOP DIV2
+        freq_rate = random           # MEMOP RAND (random_min..random_max)
+        bank = freq_value            # MEMOP LOAD; "bank = ma" is LOAD_MA
+        width_value = bank           # MEMOP STORE
+        copy B.gate_ontime 0x3F 0x3F # explicit COPY of 1-8 bytes
+        width_table A 0 20 40 20     # per-pulse width offsets (us), up to 15
+        raw 0x12 0x34                # bytes as given
+    end
+
+    user 0 "Slow pulse"              # user program slot 0-6, SET only
+        gate_ontime = 20
+    end
+
+    mode "Slow" = 1 40               # modules run on mode entry, for costs
+
+Fields are the ChannelBlock names from MK312BT/channel_mem.h. Select
+sources are own, adv, ma and other, each optionally inverted with "~".
+Module numbers not defined in the file are looked up in
+MK312BT/mode_programs.c. Consecutive forced-channel assignments to
+consecutive fields are packed into one COPY when that is shorter.
+
+Usage:
+    python3 Host/tools/pattern_compile.py PATTERN [--c FILE] [--eeprom IMAGE]
+        [--ma RAW] [--budget CYCLES] [--no-pack]
+    python3 Host/tools/pattern_compile.py Host/tools/patterns/builtin.pat
+        --store MK312BT/mode_programs.c [--check]
+    python3 Host/tools/pattern_compile.py --disasm MK312BT/mode_programs.c
+
+--c writes the modules as standalone PROGMEM arrays. --store writes the
+firmware's module store (the .c file and the .h next to it) from a file
+that defines modules 0-N without gaps; with --check it only compares and
+exits 1 if the checked-in files are out of date.
+--eeprom writes the user slots into a 512-byte EEPROM image (created
+erased if missing), e.g. for mk312bt-sim --eeprom. --budget exits 1 if a
+module or mode exceeds the given steady-state cycles per engine tick.
+--disasm prints existing modules in pattern form.
+"""
+
+import argparse
+import math
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, "..", ".."))
+FW = os.path.join(ROOT, "MK312BT")
+
+F_CPU = 8000000
+ENGINE_TICK_HZ = 244
+USER_SLOT_BASE = 0x020
+USER_SLOT_SIZE = 32
+USER_SLOT_COUNT = 7
+USER_PROG_MAGIC = 0xE3
+PULSE_MOD_BASE = {"A": 0x3C0, "B": 0x3D0}   # pulse_mod_a/b, see pulse_gen.h
+PULSE_MOD_STEPS = 15
+COPY_MAX = 8
+STORE_PAGE = 256            # module_offset holds the low byte of each start
+
+# Static cycle model (avr-gcc -Os code paths, rounded). Interpreter: one
+# fetch, then the category tests in execute_module() order until one
+# matches; register accesses go through channel_get_reg_ptr() and
+# regmap_bytecode_ptr() (two calls, three flash reads).
+COST = {
+    "module_entry": 30,     # module_start() lookup, call, END
+    "insn": 14,             # opcode fetch and loop
+    "test": 3,              # each category test that does not match
+    "reg_ptr": 48,
+    "set": 10,
+    "copy": 12, "copy_byte": 10,
+    "math": 24, "math_ch": 10,
+    "memop": 24, "memop_ch": 10,
+    "rand": 260,            # prng_next() plus 16-bit modulo
+    "load_ma": 70,
+    "cond": 6,
+    # param_engine_tick(), per tick
+    "tick": 180,            # counters, MA cache check, config_get, flags
+    "group_static": 25,     # timer bits 0
+    "resolve": 14,          # one resolve_source()
+    "group_idle": 30,       # timer not due
+    "group_fire": 35,       # rate resolve and timer count
+    "group_step": 40,       # value step and bound check
+    "gate_idle": 15, "gate_fire": 50,
+    "next_idle": 10, "next_fire": 30,
+}
+
+# Category test position in execute_module(): END, COPY, MEMOP, MATHOP,
+# LOAD_MA, SET, conditional
+TEST_INDEX = {"end": 0, "copy": 1, "memop": 2, "math": 3, "load_ma": 4, "set": 5, "cond": 6}
+
+# Advanced settings defaults (config.c) as (min source, rate source) per group
+ADV_DEFAULT = {"ramp": (128, 0), "intensity": (50, 50), "freq": (107, 128), "width": (130, 50)}
+
+GROUPS = [("ramp", 0x1C), ("intensity", 0x25), ("freq", 0x2E), ("width", 0x37)]
+ACTIONS = {"reverse": 0xFF, "rev_toggle": 0xFE, "loop": 0xFD, "stop": 0xFC}
+TIMERS = {"none": 0, "244hz": 1, "30hz": 2, "1hz": 3}
+TIMER_HZ = {0: 0.0, 1: 1.0, 2: 1.0 / 8, 3: 1.0 / 256}
+SOURCES = {"own": 0, "adv": 1, "ma": 2, "other": 3}
+GATE_POL = {"none": 0x00, "neg": 0x02, "pos": 0x04, "biphasic": 0x06}
+GATE_FLAGS = {"on": 0x01, "alt": 0x08, "invert": 0x10}
+GATE_SEL = {("off", "tempo"): 0x04, ("off", "ma"): 0x08, ("on", "effect"): 0x20, ("on", "ma"): 0x40}
+MATH_OPS = {"+=": 0, "&=": 1, "|=": 2, "^=": 3}
+
+
+class PatternError(Exception):
+    pass
+
+
+# ---- Firmware tables ----------------------------------------------------
+
+def load_fields():
+    """ChannelBlock field name -> offset, in declaration order."""
+    with open(os.path.join(FW, "channel_mem.h")) as f:
+        text = f.read()
+    body = text[text.index("typedef struct {"):text.index("} ChannelBlock;")]
+    names = re.findall(r"uint8_t\s+(\w+);", body)
+    return {n: i for i, n in enumerate(names)}
+
+
+def load_defaults():
+    with open(os.path.join(FW, "channel_mem.c")) as f:
+        text = f.read()
+    body = text[text.index("channel_defaults"):]
+    body = body[body.index("{") + 1:body.index("};")]
+    vals = [int(m, 16) for m in re.findall(r"^\s*0x([0-9A-Fa-f]{2}),", body, re.M)]
+    if len(vals) != 64:
+        raise PatternError("channel_mem.c: expected 64 defaults, found %d" % len(vals))
+    return vals
+
+
+def c_bytes(text):
+    text = re.sub(r"//[^\n]*|/\*.*?\*/", "", text, flags=re.S)
+    return [int(t, 0) for t in re.findall(r"0x[0-9A-Fa-f]+|\d+", text)]
+
+
+def load_modules(path):
+    """Module number -> bytes from a module store (mode_programs.c) or a
+    file of per-module PROGMEM arrays (--c output)."""
+    with open(path) as f:
+        text = f.read()
+    store = re.search(r"module_store\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", text, re.S)
+    offsets = re.search(r"module_offset\[\w*\]\s*PROGMEM\s*=\s*\{(.*?)\};", text, re.S)
+    if store and offsets:
+        data, starts, page = c_bytes(store.group(1)), [], 0
+        for lo in c_bytes(offsets.group(1)):
+            if starts and page + lo < starts[-1]:
+                page += STORE_PAGE      # Low byte wrapped: next page
+            starts.append(page + lo)
+        ends = starts[1:] + [len(data)]
+        return {n: data[s:e] for n, (s, e) in enumerate(zip(starts, ends))}
+    mods = {}
+    for m in re.finditer(r"module_(\d+)\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", text, re.S):
+        mods[int(m.group(1))] = c_bytes(m.group(2))
+    return mods
+
+
+FIELDS = load_fields()
+NAMES = {v: k for k, v in FIELDS.items()}
+DEFAULTS = load_defaults()
+
+
+# ---- Value syntax -------------------------------------------------------
+
+def parse_num(tok, where):
+    try:
+        v = int(tok, 0)
+    except ValueError:
+        raise PatternError("%s: expected a number, got '%s'" % (where, tok))
+    if not 0 <= v <= 0xFF:
+        raise PatternError("%s: %s does not fit a byte" % (where, tok))
+    return v
+
+
+def parse_source(tok, where):
+    inv = tok.startswith("~")
+    name = tok[1:] if inv else tok
+    if name not in SOURCES:
+        raise PatternError("%s: unknown source '%s' (own, adv, ma, other)" % (where, tok))
+    return SOURCES[name] | (4 if inv else 0)
+
+
+def clauses(text):
+    return [c.split() for c in text.split(",") if c.strip()]
+
+
+def parse_value(field, text, where):
+    text = text.strip()
+    words = text.split()
+    if len(words) == 1 and re.match(r"^(0x[0-9a-fA-F]+|\d+)$", words[0]):
+        return parse_num(words[0], where)
+    if field.endswith(("_action_min", "_action_max")) or field == "next_module_number":
+        if len(words) == 1 and words[0] in ACTIONS and field != "next_module_number":
+            return ACTIONS[words[0]]
+        if len(words) == 2 and words[0] == "module":
+            n = parse_num(words[1], where)
+            if n >= 0xFC:
+                raise PatternError("%s: module number %d collides with the actions" % (where, n))
+            return n
+    elif field == "gate_select":
+        v = 0
+        for c in clauses(text):
+            if len(c) == 2 and c[0] == "timer" and c[1] in TIMERS:
+                v |= TIMERS[c[1]]
+            elif len(c) == 2 and tuple(c) in GATE_SEL:
+                v |= GATE_SEL[tuple(c)]
+            else:
+                raise PatternError("%s: bad gate_select clause '%s'" % (where, " ".join(c)))
+        return v
+    elif field.endswith("_select"):
+        v = 0
+        for c in clauses(text):
+            if len(c) == 2 and c[0] == "timer" and c[1] in TIMERS:
+                v |= TIMERS[c[1]]
+            elif len(c) == 2 and c[0] in ("min", "value"):
+                v |= parse_source(c[1], where) << 2
+            elif len(c) == 2 and c[0] == "rate":
+                v |= parse_source(c[1], where) << 5
+            else:
+                raise PatternError("%s: bad select clause '%s'" % (where, " ".join(c)))
+        return v
+    elif field == "gate_value":
+        v = 0
+        for c in clauses(text):
+            if len(c) == 1 and c[0] in GATE_POL:
+                v |= GATE_POL[c[0]]
+            elif len(c) == 1 and c[0] in GATE_FLAGS:
+                v |= GATE_FLAGS[c[0]]
+            else:
+                raise PatternError("%s: bad gate_value flag '%s'" % (where, " ".join(c)))
+        return v
+    raise PatternError("%s: cannot parse value '%s' for %s" % (where, text, field))
+
+
+def source_text(idx):
+    name = {v: k for k, v in SOURCES.items()}[idx & 3]
+    return ("~" if idx & 4 else "") + name
+
+
+def format_value(field, v):
+    """Inverse of parse_value, falling back to hex."""
+    timers = {b: n for n, b in TIMERS.items()}
+    if field.endswith(("_action_min", "_action_max")):
+        for n, b in ACTIONS.items():
+            if v == b:
+                return n
+        return "module %d" % v
+    if field == "gate_select" and not v & 0x90:
+        parts = ["timer " + timers[v & 3]]
+        parts += ["%s %s" % k for k, b in sorted(GATE_SEL.items(), key=lambda x: x[1]) if v & b]
+        return ", ".join(parts)
+    if field.endswith("_select") and field != "gate_select":
+        parts = ["timer " + timers[v & 3]]
+        if (v >> 2) & 7:
+            parts.append("%s %s" % ("min" if v & 3 else "value", source_text((v >> 2) & 7)))
+        if (v >> 5) & 7:
+            parts.append("rate " + source_text((v >> 5) & 7))
+        return ", ".join(parts)
+    if field == "gate_value" and not v & 0xE0:
+        parts = [n for n, b in GATE_FLAGS.items() if b == 0x01 and v & b]
+        parts.append({b: n for n, b in GATE_POL.items()}[v & 0x06])
+        parts += [n for n, b in GATE_FLAGS.items() if b != 0x01 and v & b]
+        return ", ".join(parts)
+    return "0x%02X" % v
+
+
+# ---- Compiler -----------------------------------------------------------
+
+class Insn:
+    """One bytecode instruction: kind, bytes, comment, channel routing."""
+
+    def __init__(self, kind, data, comment, **kw):
+        self.kind = kind
+        self.data = data
+        self.comment = comment
+        self.__dict__.update(kw)
+
+
+def parse_target(tok, where):
+    chan = None
+    if tok.startswith(("A.", "B.")):
+        chan, tok = tok[0], tok[2:]
+    if tok not in FIELDS:
+        raise PatternError("%s: unknown channel field '%s'" % (where, tok))
+    return chan, tok
+
+
+def compile_statement(line, where, user, warn):
+    m = re.match(r"^([\w.]+)\s*(=|\+=|-=|&=|\|=|\^=|/=)\s*(.*)$", line)
+    words = line.split()
+
+    if words[0] == "apply" and len(words) == 2:
+        v = {"A": 1, "B": 2, "both": 3}.get(words[1])
+        if v is None:
+            raise PatternError("%s: apply A, B or both" % where)
+        return [Insn("set", [0x80 | FIELDS["apply_channel"], v], "SET apply_channel = %s" % words[1],
+                     off=FIELDS["apply_channel"], chan=None, value=v)]
+    if words[0] == "raw":
+        return [Insn("raw", [parse_num(t, where) for t in words[1:]], "raw")]
+    if words[0] == "width_table" and len(words) >= 2:
+        if words[1] not in PULSE_MOD_BASE:
+            raise PatternError("%s: width_table A or B" % where)
+        steps = [int(t, 0) for t in words[2:]]
+        if len(steps) > PULSE_MOD_STEPS or any(not -128 <= s <= 127 for s in steps):
+            raise PatternError("%s: width_table takes up to %d offsets of -128..127"
+                               % (where, PULSE_MOD_STEPS))
+        vals = [len(steps)] + [s & 0xFF for s in steps]
+        base = PULSE_MOD_BASE[words[1]]
+        return [Insn("copy", [0x20 | ((len(vals[k:k + COPY_MAX]) - 1) << 2) | ((base + k) >> 8),
+                              (base + k) & 0xFF] + vals[k:k + COPY_MAX],
+                     "COPY [0x%03X] pulse_mod_%s" % (base + k, words[1].lower()))
+                for k in range(0, len(vals), COPY_MAX)]
+    if words[0] == "copy" and len(words) >= 3:
+        chan, field = parse_target(words[1], where)
+        if chan is None:
+            raise PatternError("%s: copy needs an A. or B. field" % where)
+        vals = [parse_num(t, where) for t in words[2:]]
+        if FIELDS[field] + len(vals) > 64 or len(vals) > COPY_MAX:
+            raise PatternError("%s: copy of %d bytes does not fit" % (where, len(vals)))
+        return [make_copy(chan, FIELDS[field], vals)]
+    if not m:
+        raise PatternError("%s: cannot parse '%s'" % (where, line))
+
+    lhs, op, rhs = m.group(1), m.group(2), m.group(3).strip()
+    if lhs == "bank" and op == "=":
+        if rhs == "ma":
+            return [Insn("load_ma", [0x60], "LOAD_MA into bank")]
+        chan, field = parse_target(rhs, where)
+        return [memop(1, chan, field, where, warn, "LOAD %s -> bank" % field)]
+
+    chan, field = parse_target(lhs, where)
+    off = FIELDS[field]
+    if op == "=" and rhs == "random":
+        return [memop(3, chan, field, where, warn, "RAND")]
+    if op == "=" and rhs == "bank":
+        return [memop(0, chan, field, where, warn, "STORE bank ->")]
+    if op == "/=":
+        if rhs != "2":
+            raise PatternError("%s: only /= 2 (DIV2) exists" % where)
+        return [memop(2, chan, field, where, warn, "DIV2")]
+    if op != "=":
+        v = parse_num(rhs, where)
+        if op == "-=":
+            op, v = "+=", (-v) & 0xFF
+        if chan == "A":
+            raise PatternError("%s: MATHOP on channel A follows apply_channel; use 'apply A'" % where)
+        if chan == "B":
+            warn("%s: MATHOP on a channel B address is skipped by the interpreter; use 'apply B'" % where)
+        addr = (0x180 if chan == "B" else 0x080) + off
+        name = {0: "ADD", 1: "AND", 2: "OR", 3: "XOR"}[MATH_OPS[op]]
+        return [Insn("math", [0x50 | (MATH_OPS[op] << 2) | (addr >> 8), addr & 0xFF, v],
+                     "MATHOP %s %s%s %s 0x%02X" % (name, "ch_b " if chan == "B" else "", field, op, v),
+                     off=off, chan=chan, op=MATH_OPS[op], value=v)]
+
+    v = parse_value(field, rhs, where)
+    if chan == "A":
+        return [make_copy("A", off, [v])]
+    opcode = (0xC0 if chan == "B" else 0x80) | off
+    return [Insn("set", [opcode, v], "SET %s%s = %s" % ("ch_b " if chan == "B" else "", field,
+                                                        format_value(field, v)),
+                 off=off, chan=chan, value=v)]
+
+
+def make_copy(chan, off, vals):
+    addr = (0x180 if chan == "B" else 0x080) + off
+    names = NAMES[off] if len(vals) == 1 else "%s..%s" % (NAMES[off], NAMES[off + len(vals) - 1])
+    return Insn("copy", [0x20 | ((len(vals) - 1) << 2) | (addr >> 8), addr & 0xFF] + vals,
+                "COPY [0x%03X] %s%s" % (addr, "ch_b " if chan == "B" else "", names),
+                off=off, chan=chan, values=vals)
+
+
+def memop(op, chan, field, where, warn, what):
+    if chan == "A":
+        raise PatternError("%s: MEMOP on channel A follows apply_channel; use 'apply A'" % where)
+    if chan == "B":
+        warn("%s: MEMOP on a channel B address acts on 0x2xx (the interpreter adds 0x100 "
+             "again); use 'apply B'" % where)
+    addr = (0x180 if chan == "B" else 0x080) + FIELDS[field]
+    return Insn("memop", [0x40 | (op << 2) | (addr >> 8), addr & 0xFF],
+                "MEMOP %s [0x%03X] %s" % (what, addr, field), off=FIELDS[field], chan=chan, op=op)
+
+
+def pack(insns):
+    """Replace runs of forced-channel SET/COPY on consecutive fields with
+    COPY chunks of up to COPY_MAX bytes when that is shorter."""
+    def values(i):
+        return i.values if i.kind == "copy" else [i.value]
+
+    out, i = [], 0
+    while i < len(insns):
+        ins = insns[i]
+        if ins.kind not in ("set", "copy") or getattr(ins, "chan", None) not in ("A", "B"):
+            out.append(ins)
+            i += 1
+            continue
+        run, vals = [ins], list(values(ins))
+        while i + len(run) < len(insns):
+            nxt = insns[i + len(run)]
+            if (nxt.kind not in ("set", "copy") or getattr(nxt, "chan", None) != ins.chan
+                    or nxt.off != ins.off + len(vals)):
+                break
+            run.append(nxt)
+            vals += values(nxt)
+        chunks = [make_copy(ins.chan, ins.off + k, vals[k:k + COPY_MAX])
+                  for k in range(0, len(vals), COPY_MAX)]
+        if sum(len(c.data) for c in chunks) < sum(len(r.data) for r in run):
+            out += chunks
+        else:
+            out += run
+        i += len(run)
+    return out
+
+
+class Program:
+    def __init__(self, kind, number, name, where):
+        self.kind = kind            # "module" or "user"
+        self.number = number
+        self.name = name
+        self.where = where
+        self.insns = []
+
+    def code(self):
+        data = [b for i in self.insns for b in i.data]
+        return data + ([0x00, 0x00] if self.kind == "module" else [0x00])
+
+
+def parse_file(path, do_pack=True):
+    progs, modes, warnings = [], [], []
+    cur = None
+    with open(path) as f:
+        lines = f.read().split("\n")
+    for n, raw in enumerate(lines, 1):
+        where = "%s:%d" % (path, n)
+        line = raw.split("#", 1)[0].strip()
+        if not line:
+            continue
+        head = re.match(r'^(module|user)\s+(\d+)(?:\s+"([^"]*)")?$', line)
+        mode = re.match(r'^mode\s+"([^"]*)"\s*=\s*([\d\s]+)$', line)
+        if head:
+            if cur:
+                raise PatternError("%s: missing 'end' for %s %d" % (where, cur.kind, cur.number))
+            cur = Program(head.group(1), int(head.group(2)), head.group(3) or "", where)
+            if cur.kind == "user" and cur.number >= USER_SLOT_COUNT:
+                raise PatternError("%s: user slots are 0-%d" % (where, USER_SLOT_COUNT - 1))
+            if cur.kind == "module" and cur.number >= 0xFC:
+                raise PatternError("%s: module numbers stop at 251" % where)
+        elif line == "end":
+            if not cur:
+                raise PatternError("%s: 'end' outside a block" % where)
+            if do_pack:
+                cur.insns = pack(cur.insns)
+            progs.append(cur)
+            cur = None
+        elif mode:
+            if cur:
+                raise PatternError("%s: 'mode' inside a block" % where)
+            modes.append((mode.group(1), [int(t) for t in mode.group(2).split()], where))
+        elif cur:
+            insns = compile_statement(line, where, cur.kind == "user", warnings.append)
+            if cur.kind == "user" and any(i.kind != "set" or i.chan == "A" for i in insns):
+                raise PatternError("%s: user programs run SET only (no A. fields, MATHOP, "
+                                   "MEMOP, COPY or raw)" % where)
+            cur.insns += insns
+        else:
+            raise PatternError("%s: statement outside a module/user block" % where)
+    if cur:
+        raise PatternError("%s: missing 'end' for %s %d" % (path, cur.kind, cur.number))
+    for p in progs:
+        if p.kind == "user" and len(p.code()) - 1 > USER_SLOT_SIZE - 2:
+            raise PatternError("%s: user slot %d needs %d bytes, %d available"
+                               % (p.where, p.number, len(p.code()) - 1, USER_SLOT_SIZE - 2))
+    return progs, modes, warnings
+
+
+# ---- Decoder and cost model ---------------------------------------------
+
+def decode(code, user=False):
+    """Yield (kind, bytes) per instruction, as the interpreters walk them."""
+    pc = 0
+    while pc < len(code):
+        op = code[pc]
+        if user:
+            if op == 0x00 or not op & 0x80:
+                return
+            yield "set", code[pc:pc + 2]
+            pc += 2
+            continue
+        if op & 0xE0 == 0x00:
+            return
+        if op & 0xE0 == 0x20:
+            n = 2 + 1 + ((op & 0x1C) >> 2)
+            yield "copy", code[pc:pc + n]
+            pc += n
+        elif op & 0xF0 == 0x40:
+            yield "memop", code[pc:pc + 2]
+            pc += 2
+        elif op & 0xF0 == 0x50:
+            yield "math", code[pc:pc + 3]
+            pc += 3
+        elif op == 0x60:
+            yield "load_ma", code[pc:pc + 1]
+            pc += 1
+        elif op & 0x80:
+            yield "set", code[pc:pc + 2]
+            pc += 2
+        elif op & 0x10:
+            yield "cond", code[pc:pc + 2]
+            pc += 2
+        else:
+            yield "skip", code[pc:pc + 1]
+            pc += 1
+
+
+def map_ma(raw, at_max, at_min):
+    if at_max >= at_min:
+        return at_min + ((raw * (at_max - at_min)) >> 8)
+    return at_min - ((raw * (at_min - at_max)) >> 8)
+
+
+class State:
+    """Both channel blocks as the interpreter would leave them."""
+
+    def __init__(self, ma_raw):
+        self.ch = [list(DEFAULTS), list(DEFAULTS)]
+        self.ma_raw = ma_raw
+        for c in self.ch:               # apply_mode_init()
+            c[FIELDS["ramp_min"]] = 0x9C
+            c[FIELDS["ramp_max"]] = 0xFF
+            c[FIELDS["ramp_rate"]] = 0x07
+            c[FIELDS["ramp_step"]] = 0x01
+            c[FIELDS["ramp_action_min"]] = 0xFC
+            c[FIELDS["ramp_action_max"]] = 0xFC
+            c[FIELDS["ramp_select"]] = 0x01
+            c[FIELDS["intensity_value"]] = 0xFF
+            c[FIELDS["intensity_select"]] = 0x00
+            c[FIELDS["freq_select"]] = 0x08
+            c[FIELDS["width_select"]] = 0x00
+
+    def apply(self):
+        return self.ch[0][FIELDS["apply_channel"]]
+
+    def reg(self, addr):
+        if 0x080 <= addr < 0x0C0:
+            return self.ch[0], addr - 0x080
+        if 0x180 <= addr < 0x1C0:
+            return self.ch[1], addr - 0x180
+        return None, 0
+
+    def ma(self, n):
+        c = self.ch[n]
+        return map_ma(self.ma_raw, c[FIELDS["ma_at_knob_max"]], c[FIELDS["ma_at_knob_min"]])
+
+
+def run_program(code, st, user=False):
+    """Execute on st; return interpreter cycles."""
+    cyc = COST["module_entry"]
+    for kind, b in decode(code, user):
+        ac = st.apply()
+        chans = [n for n in (0, 1) if ac & (1 << n)]
+        cyc += COST["insn"]
+        if kind in TEST_INDEX:
+            cyc += COST["test"] * TEST_INDEX[kind]
+        if kind == "set":
+            off = b[0] & 0x3F
+            targets = [1] if b[0] & 0x40 else chans
+            for n in targets:
+                st.ch[n][off] = b[1]
+            cyc += COST["set"] + len(targets) * COST["reg_ptr"]
+        elif kind == "copy":
+            addr = ((b[0] & 3) << 8) | b[1]
+            for i, v in enumerate(b[2:]):
+                blk, off = st.reg(addr + i)
+                if blk is not None:
+                    blk[off] = v
+            cyc += COST["copy"] + (len(b) - 2) * (COST["copy_byte"] + COST["reg_ptr"])
+        elif kind in ("math", "memop"):
+            addr = ((b[0] & 3) << 8) | b[1]
+            op = (b[0] & 0x0C) >> 2
+            if 0x080 <= addr < 0x0C0:
+                targets = chans
+            elif 0x180 <= addr < 0x1C0:
+                targets = [] if kind == "math" else [2]     # see compile warnings
+            else:
+                targets = [0]
+            off = addr & 0x3F
+            for n in targets:
+                if n > 1:
+                    continue
+                c = st.ch[n]
+                if kind == "math":
+                    c[off] = [(c[off] + b[2]) & 0xFF, c[off] & b[2], c[off] | b[2], c[off] ^ b[2]][op]
+                elif op == 0:
+                    c[off] = c[FIELDS["bank"]]
+                elif op == 1:
+                    c[FIELDS["bank"]] = c[off]
+                elif op == 2:
+                    c[off] >>= 1
+                else:
+                    lo, hi = c[FIELDS["random_min"]], c[FIELDS["random_max"]]
+                    c[off] = (lo + hi) // 2 if hi > lo else lo
+            per = COST["math_ch"] if kind == "math" else COST["memop_ch"]
+            cyc += COST[kind] + len(targets) * (per + COST["reg_ptr"] * (2 if op < 2 and kind == "memop" else 1))
+            if kind == "memop" and op == 3:
+                cyc += COST["rand"]
+        elif kind == "load_ma":
+            for n in chans:
+                st.ch[n][FIELDS["bank"]] = st.ma(n)
+            cyc += COST["load_ma"] + len(chans) * COST["reg_ptr"]
+        elif kind == "cond":
+            cyc += COST["cond"]
+    return cyc
+
+
+def resolve(idx, own, adv, ma, other):
+    v = [own, adv, ma, other][idx & 3]
+    return (~v & 0xFF) if idx & 4 else v
+
+
+def tick_cost(st, module_cost):
+    """Steady-state cycles per param_engine_tick() and triggered modules."""
+    cyc = COST["tick"]
+    triggers = {}
+    for n in (0, 1):
+        c, o = st.ch[n], st.ch[1 - n]
+        ma = st.ma(n)
+        for name, base in GROUPS:
+            value, lo, hi, rate, step, a_min, a_max, sel = c[base:base + 8]
+            adv_min, adv_rate = ADV_DEFAULT[name]
+            timer = sel & 3
+            min_idx, rate_idx = (sel >> 2) & 7, (sel >> 5) & 7
+            if timer == 0:
+                cyc += COST["group_static"] + (COST["resolve"] if min_idx else 0)
+                continue
+            f = TIMER_HZ[timer]
+            eff_rate = max(1, resolve(rate_idx, rate, adv_rate, ma, o[base]))
+            steps_per_tick = f / eff_rate
+            cyc += COST["group_idle"] + f * (COST["group_fire"] + COST["resolve"])
+            cyc += steps_per_tick * (COST["group_step"] + (COST["resolve"] if min_idx else 0))
+            if min_idx:
+                lo = resolve(min_idx, lo, adv_min, ma, o[base])
+            if step == 0:
+                continue
+            hits = steps_per_tick / max(1, math.ceil(abs(hi - lo) / step))
+            ends = [a for a in (a_min, a_max) if a < 0xFC]
+            for a in ends:
+                triggers[a] = triggers.get(a, 0.0) + hits / 2
+        gsel = c[FIELDS["gate_select"]]
+        gf = TIMER_HZ[gsel & 3]
+        cyc += COST["gate_idle"] + gf * COST["gate_fire"]
+        nsel = c[FIELDS["next_module_select"]]
+        nf = TIMER_HZ[nsel & 3]
+        cyc += COST["next_idle"] + nf * COST["next_fire"]
+        if nf:
+            tmax = max(1, resolve((nsel >> 5) & 7, c[FIELDS["next_module_timer_max"]],
+                                  50, ma, o[FIELDS["next_module_timer_max"]]))
+            m = c[FIELDS["next_module_number"]]
+            triggers[m] = triggers.get(m, 0.0) + nf / tmax
+    for m, per_tick in triggers.items():
+        cyc += per_tick * module_cost(m)
+    return cyc, triggers
+
+
+# ---- Reports and outputs ------------------------------------------------
+
+def c_array(p):
+    lines = ["/* Module %d%s */" % (p.number, " - " + p.name if p.name else ""),
+             "const uint8_t module_%02d[] PROGMEM = {" % p.number]
+    for i in p.insns:
+        bytes_text = " ".join("0x%02X," % b for b in i.data)
+        lines.append("    %-15s // %s" % (bytes_text, i.comment))
+    lines += ["    0x00, 0x00", "};", ""]
+    return "\n".join(lines)
+
+
+def store_files(progs, c_name, source):
+    """(.c text, .h text) of the module store: every module back to back,
+    each ended by one END byte, and the low byte of each start."""
+    mods = sorted((p for p in progs if p.kind == "module"), key=lambda p: p.number)
+    if [p.number for p in mods] != list(range(len(mods))):
+        raise PatternError("--store: modules must be numbered 0-%d without gaps" % (len(mods) - 1))
+    base = os.path.splitext(c_name)[0]
+    note = [" *", " * GENERATED by Host/tools/pattern_compile.py --store from",
+            " * %s. Do not edit by hand: change the" % source,
+            " * pattern file and regenerate.", " *"]
+    c = ["/*", " * %s.c - Built-in Bytecode Modules (generated)" % base] + note + [
+         " * All modules sit back to back in module_store, each ended by one END",
+         " * byte. module_offset holds the low byte of each start; module_start()",
+         " * in %s.h adds the %d-byte pages. No pointer table and no" % (base, STORE_PAGE),
+         " * second terminator byte per module.", " */", "",
+         '#include "%s.h"' % base, "#include <avr/pgmspace.h>", "",
+         "const uint8_t module_store[] PROGMEM = {"]
+    starts, pos = [], 0
+    for p in mods:
+        starts.append(pos)
+        c.append("    /* 0x%03X Module %d%s */" % (pos, p.number, " - " + p.name if p.name else ""))
+        for i in p.insns:
+            c.append("    %-15s // %s" % (" ".join("0x%02X," % b for b in i.data), i.comment))
+            pos += len(i.data)
+        c.append("    0x00,")
+        pos += 1
+    c += ["};", "", "const uint8_t module_offset[MODULE_COUNT] PROGMEM = {"]
+    for k in range(0, len(starts), 8):
+        c.append("    " + " ".join("0x%02X," % (s % STORE_PAGE) for s in starts[k:k + 8]))
+    c += ["};", ""]
+
+    pages = ["    if (n >= %d) off += %d;" % (next(n for n, s in enumerate(starts) if s >= pg), STORE_PAGE)
+             for pg in range(STORE_PAGE, pos, STORE_PAGE) if any(s >= pg for s in starts)]
+    guard = "%s_H" % os.path.basename(base).upper()
+    h = ["/*", " * %s.h - Built-in Bytecode Modules (generated)" % base] + note[:-1] + [" */",
+         "#ifndef %s" % guard, "#define %s" % guard, "",
+         "#include <avr/pgmspace.h>", "#include <stdint.h>", "",
+         "#ifdef __cplusplus", 'extern "C" {', "#endif", "",
+         "#define MODULE_COUNT %d" % len(mods),
+         "#define MODULE_STORE_SIZE %d" % pos, "",
+         "extern const uint8_t module_store[];",
+         "extern const uint8_t module_offset[];", "",
+         "/* First instruction of module n (n < MODULE_COUNT) */",
+         "static inline const uint8_t *module_start(uint8_t n) {",
+         "    uint16_t off = pgm_read_byte(&module_offset[n]);"] + pages + [
+         "    return module_store + off;", "}", "",
+         "#ifdef __cplusplus", "}", "#endif", "", "#endif", ""]
+    return "\n".join(c), "\n".join(h)
+
+
+def disasm(path):
+    mods = load_modules(path)
+    for num in sorted(mods):
+        print("module %d" % num)
+        for kind, b in decode(mods[num]):
+            if kind == "set":
+                field = NAMES[b[0] & 0x3F]
+                prefix = "B." if b[0] & 0x40 else ""
+                if field == "apply_channel" and not prefix and b[1] in (1, 2, 3):
+                    print("    apply %s" % {1: "A", 2: "B", 3: "both"}[b[1]])
+                else:
+                    print("    %s%s = %s" % (prefix, field, format_value(field, b[1])))
+            elif kind == "copy" and (((b[0] & 3) << 8) | b[1]) & 0x3C0 in (0x080, 0x180):
+                addr = ((b[0] & 3) << 8) | b[1]
+                blk = "B." if addr & 0x100 else "A."
+                print("    copy %s%s %s" % (blk, NAMES[addr & 0x3F], " ".join("0x%02X" % v for v in b[2:])))
+            elif kind == "math":
+                addr = ((b[0] & 3) << 8) | b[1]
+                op = ["+=", "&=", "|=", "^="][(b[0] >> 2) & 3]
+                print("    %s%s %s 0x%02X" % ("B." if addr & 0x100 else "", NAMES[addr & 0x3F], op, b[2]))
+            elif kind == "memop":
+                addr = ((b[0] & 3) << 8) | b[1]
+                t = ("B." if addr & 0x100 else "") + NAMES[addr & 0x3F]
+                op = (b[0] >> 2) & 3
+                print("    " + ["%s = bank", "bank = %s", "%s /= 2", "%s = random"][op] % t)
+            elif kind == "load_ma":
+                print("    bank = ma")
+            else:
+                print("    raw " + " ".join("0x%02X" % v for v in b))
+        print("end\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("pattern", nargs="?", help="pattern file")
+    ap.add_argument("--c", metavar="FILE", help="write modules as PROGMEM arrays")
+    ap.add_argument("--eeprom", metavar="IMAGE", help="write user slots into a 512-byte image")
+    ap.add_argument("--ma", type=int, default=128, help="MA knob reading 0-255 for costs (default 128)")
+    ap.add_argument("--budget", type=float, help="fail above this many cycles per engine tick")
+    ap.add_argument("--no-pack", action="store_true", help="keep one instruction per statement")
+    ap.add_argument("--modules", default=os.path.join(FW, "mode_programs.c"),
+                    help="built-in modules for numbers not in the pattern file")
+    ap.add_argument("--disasm", metavar="FILE", help="print modules of a mode_programs.c in pattern form")
+    ap.add_argument("--store", metavar="FILE", help="write the module store (FILE and its .h)")
+    ap.add_argument("--check", action="store_true", help="with --store: compare instead of writing")
+    args = ap.parse_args()
+
+    if args.disasm:
+        disasm(args.disasm)
+        return 0
+    if not args.pattern:
+        ap.error("a pattern file is required")
+
+    try:
+        progs, modes, warnings = parse_file(args.pattern, not args.no_pack)
+    except (PatternError, OSError) as e:
+        sys.exit(str(e))
+    for w in warnings:
+        sys.stderr.write("warning: %s\n" % w)
+
+    builtin = load_modules(args.modules) if os.path.exists(args.modules) else {}
+    code_of = dict(builtin)
+    code_of.update({p.number: p.code() for p in progs if p.kind == "module"})
+
+    def module_cost(m):
+        if m not in code_of:
+            return 0
+        return run_program(code_of[m], State(args.ma))
+
+    def mode_state(numbers, user=None):
+        st = State(args.ma)
+        cyc = run_program(code_of[1], st) if 1 in code_of else 0
+        for m in numbers:
+            if m not in code_of:
+                raise PatternError("module %d is not defined" % m)
+            cyc += run_program(code_of[m], st)
+        if user is not None:
+            cyc += run_program(user, st, user=True)
+        return st, cyc
+
+    over = 0
+    print("%-24s %6s %8s %10s %7s  %s" % ("pattern", "bytes", "interp", "tick", "cpu", "triggers/s"))
+    rows = [(p, None) for p in progs] + [(None, m) for m in modes]
+    for p, mode in rows:
+        try:
+            if p and p.kind == "module":
+                label = "module %d %s" % (p.number, p.name)
+                size = "%d" % len(p.code())
+                interp = run_program(p.code(), State(args.ma))
+                st, _ = mode_state([p.number])
+            elif p:
+                label = "user %d %s" % (p.number, p.name)
+                size = "%d/%d" % (len(p.code()) - 1, USER_SLOT_SIZE - 2)
+                interp = run_program(p.code(), State(args.ma), user=True)
+                st, _ = mode_state([], p.code())
+            else:
+                label = 'mode "%s"' % mode[0]
+                size = "%d" % sum(len(code_of.get(m, [])) for m in mode[1])
+                st, interp = mode_state(mode[1])
+        except PatternError as e:
+            sys.exit("%s: %s" % (mode[2] if mode else p.where, e))
+        tick, triggers = tick_cost(st, module_cost)
+        cpu = tick * ENGINE_TICK_HZ * 100.0 / F_CPU
+        trig = ", ".join("%d@%.3g" % (m, r * ENGINE_TICK_HZ) for m, r in sorted(triggers.items())) or "-"
+        flag = ""
+        if args.budget is not None and tick > args.budget:
+            flag = "  OVER BUDGET"
+            over += 1
+        print("%-24s %6s %8d %10.0f %6.2f%%  %s%s" % (label[:24], size, interp, tick, cpu, trig, flag))
+
+    if args.c:
+        with open(args.c, "w") as f:
+            f.write("".join(c_array(p) + "\n" for p in progs if p.kind == "module"))
+    if args.store:
+        try:
+            rel = os.path.relpath(os.path.abspath(args.pattern), ROOT)
+            texts = store_files(progs, os.path.basename(args.store), rel)
+        except PatternError as e:
+            sys.exit(str(e))
+        stale = 0
+        for path, text in zip((args.store, os.path.splitext(args.store)[0] + ".h"), texts):
+            old = open(path).read() if os.path.exists(path) else None
+            if args.check:
+                if old != text:
+                    sys.stderr.write("out of date: %s\n" % path)
+                    stale += 1
+            elif old != text:
+                with open(path, "w") as f:
+                    f.write(text)
+        if stale:
+            return 1
+    if args.eeprom:
+        image = bytearray(b"\xff" * 512)
+        if os.path.exists(args.eeprom):
+            with open(args.eeprom, "rb") as f:
+                image = bytearray(f.read())
+            if len(image) != 512:
+                sys.exit("%s: not a 512-byte EEPROM image" % args.eeprom)
+        for p in progs:
+            if p.kind != "user":
+                continue
+            slot = [USER_PROG_MAGIC] + p.code()
+            slot += [0x00] * (USER_SLOT_SIZE - len(slot))
+            base = USER_SLOT_BASE + p.number * USER_SLOT_SIZE
+            image[base:base + USER_SLOT_SIZE] = bytes(slot)
+        with open(args.eeprom, "wb") as f:
+            f.write(image)
+    return 1 if over else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+session_decode.py - Decode a live session recording
+
+Reads the session area (EEPROM 0x100-0x1FF, see MK312BT/session_rec.h)
+from either a 512-byte EEPROM image (e.g. mk312bt-sim --eeprom-out) or a
+hex text dump of the 256 bytes at serial address 0x8100-0x81FF, checks
+the header and prints the recording's size, length and compression ratio.
+
+    python3 Host/tools/session_decode.py session.eep
+    python3 Host/tools/session_decode.py dump.txt --csv > session.csv
+
+--csv writes one line per frame: frame, intensity/freq/width A, same for B.
+"""
+
+import argparse
+import sys
+
+SESSION_BASE = 0x100
+HEADER = 4
+MAGIC = 0xE5
+FRAME_VALUES = 6
+ENGINE_TICK_HZ = 244          # Nominal param engine rate (4.1 ms loop slot)
+
+
+def load_area(path):
+    with open(path, "rb") as f:
+        raw = f.read()
+    if len(raw) == 512:
+        return raw[SESSION_BASE:]
+    try:
+        data = bytes(int(t, 16) for t in raw.decode().replace(",", " ").split())
+    except ValueError:
+        sys.exit("%s: neither a 512-byte image nor a hex dump" % path)
+    if len(data) != 256:
+        sys.exit("%s: expected 256 bytes of hex, got %d" % (path, len(data)))
+    return data
+
+
+def decode(stream):
+    """Yield each frame (list of 6 values) of one pass through the stream."""
+    frame = [0] * FRAME_VALUES
+    pos = 0
+    while pos < len(stream):
+        tok = stream[pos]
+        pos += 1
+        if tok < 0x80:
+            for _ in range(tok + 1):
+                yield list(frame)
+            continue
+        absolute = (tok & 0xC0) == 0xC0
+        nibbles = []
+        for i in range(FRAME_VALUES):
+            if not tok & (1 << i):
+                continue
+            if absolute:
+                frame[i] = stream[pos]
+                pos += 1
+            else:
+                if not nibbles:
+                    b = stream[pos]
+                    pos += 1
+                    nibbles = [b & 0x0F, b >> 4]
+                d = nibbles.pop(0)
+                d = d - 16 if d & 0x08 else d
+                frame[i] = (frame[i] + d) & 0xFF
+        yield list(frame)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("input", help="512-byte EEPROM image or hex dump of 0x8100-0x81FF")
+    ap.add_argument("--csv", action="store_true", help="print every frame")
+    args = ap.parse_args()
+
+    area = load_area(args.input)
+    magic, div, length, checksum = area[:HEADER]
+    if magic != MAGIC:
+        sys.exit("no valid session (magic %02x)" % magic)
+    stream = area[HEADER:HEADER + length]
+    for b in stream:
+        checksum ^= b
+    if div == 0 or checksum != 0:
+        sys.exit("session header or checksum invalid")
+
+    frames = list(decode(stream))
+    if args.csv:
+        print("frame,int_a,freq_a,width_a,int_b,freq_b,width_b")
+        for n, f in enumerate(frames):
+            print("%d,%s" % (n, ",".join(str(v) for v in f)))
+        return
+
+    raw = len(frames) * FRAME_VALUES
+    seconds = len(frames) * div / float(ENGINE_TICK_HZ)
+    print("frames         %d every %d ticks, ~%.1f s at %d Hz"
+          % (len(frames), div, seconds, ENGINE_TICK_HZ))
+    print("stored         %d of %d bytes" % (length, 256 - HEADER))
+    print("uncompressed   %d bytes, ratio %.2f:1" % (raw, raw / float(length or 1)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+tick_sync.py - Lock the engine ticks of several boxes to the host clock
+
+Runs sync rounds against one or more boxes (serial ports or emulated boxes
+on pseudo terminals) through the SYNC registers at 0x43A0 (see
+MK312BT/tick_sync.h and Documentation/SERIAL_PROTOCOL.md). Host time is
+the monotonic clock since the tool started, in the boxes' unit of 1/256
+engine tick at 250 Hz.
+
+Each round writes, in one frame, the host time of the previous latch and
+SYNC_CTRL = APPLY | LATCH. The box latches its own sync time as it
+executes the frame; the host takes the arrival of the 0x06 reply, less
+one byte time and --latency-us, as the same instant. A round whose round
+trip is far off the recent median only latches, so a bad timestamp is
+never applied. The box steps on the first round and then slews its tick
+period. The SYNC_ERROR register read back after each round is the box's
+error against the host in ticks.
+
+Usage:
+    python3 Host/tools/tick_sync.py /dev/ttyUSB0 /dev/ttyUSB1 [--rounds N]
+    python3 Host/tools/tick_sync.py --sim 0,+150,-300 [--rounds 60]
+
+--sim starts one Host/sim/build/mk312bt-sim per value with --pty and
+--skew-ppm set to it (crystal error in ppm), then syncs them. Output is
+one line per round with each box's error (ticks) and trim (ppm), and the
+spread between boxes; --csv writes the same as CSV.
+"""
+
+import argparse
+import collections
+import sys
+import time
+
+from mk312link import BYTE_S, Link, start_sims, stop_sims
+
+TICK_HZ = 250
+PERIOD_US = 4000
+RTT_SLACK_S = 0.0015        # Rounds this far off the median round trip are not applied
+RTT_HISTORY = 16
+
+SYNC_REF0 = 0x43A0
+SYNC_CTRL = 0x43A4
+SYNC_ERROR_LO = 0x43A9
+SYNC_TRIM_LO = 0x43AB
+SYNC_STEPS = 0x43AD
+
+CTRL_APPLY = 0x01
+CTRL_LATCH = 0x02
+CTRL_RESET = 0x80
+
+
+class Box(Link):
+    """One link plus the round-trip history of its sync rounds."""
+
+    def __init__(self, path):
+        Link.__init__(self, path)
+        self.last_ref = None
+        self.rtts = collections.deque(maxlen=RTT_HISTORY)
+        self.suspect = False
+        self.history = []
+
+
+def host_time(t, epoch):
+    return int((t - epoch) * TICK_HZ * 256) & 0xFFFFFFFF
+
+
+def sync_round(box, epoch, latency_s, first):
+    """One round; returns (error ticks, trim ppm, steps) or None."""
+    ref = box.last_ref if box.last_ref is not None else 0
+    if first:
+        ctrl = CTRL_RESET | CTRL_LATCH
+    elif box.suspect:
+        ctrl = CTRL_LATCH           # Previous latch time is unreliable
+    else:
+        ctrl = CTRL_APPLY | CTRL_LATCH
+    t_send = time.monotonic()
+    t_ack = box.write(SYNC_REF0, list(ref.to_bytes(4, "little")) + [ctrl])
+    rtt = t_ack - t_send
+    box.rtts.append(rtt)
+    box.suspect = abs(rtt - sorted(box.rtts)[len(box.rtts) // 2]) > RTT_SLACK_S
+    box.last_ref = host_time(t_ack - BYTE_S - latency_s, epoch)
+    if not ctrl & CTRL_APPLY:
+        return None
+    error = box.read16(SYNC_ERROR_LO) / 256.0
+    trim = box.read16(SYNC_TRIM_LO) / 256.0 / PERIOD_US * 1e6
+    return error, trim, box.read(SYNC_STEPS)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("ports", nargs="*", help="serial ports or pty paths")
+    ap.add_argument("--sim", metavar="PPM[,PPM...]", help="start emulated boxes with these skews")
+    ap.add_argument("--rounds", type=int, default=30, help="sync rounds (0 = until ^C, default 30)")
+    ap.add_argument("--interval", type=float, default=1.0, help="seconds between rounds (default 1)")
+    ap.add_argument("--latency-us", type=float, default=0.0, help="link latency to subtract from replies")
+    ap.add_argument("--csv", metavar="FILE", help="write round, box, error, trim rows")
+    args = ap.parse_args()
+
+    procs, tmp = [], None
+    ports = list(args.ports)
+    if args.sim:
+        procs, links, tmp = start_sims([["--skew-ppm", s] for s in args.sim.split(",")])
+        ports += links
+    if not ports:
+        ap.error("no ports given")
+
+    csv = open(args.csv, "w") if args.csv else None
+    if csv:
+        csv.write("round,box,error_ticks,trim_ppm,steps\n")
+    status = 0
+    boxes = []
+    try:
+        boxes = [Box(p) for p in ports]
+        for b in boxes:
+            b.handshake()
+        epoch = time.monotonic()
+        n = 0
+        while args.rounds == 0 or n <= args.rounds:
+            start = time.monotonic()
+            results = [sync_round(b, epoch, args.latency_us * 1e-6, n == 0) for b in boxes]
+            if n > 0:
+                errors = [r[0] for r in results if r]
+                cols = "  ".join("%+7.2f %+7.1fppm" % r[:2] if r else "  (latch only)  "
+                                 for r in results)
+                print("%4d  %s  spread %.2f" % (n, cols, max(errors) - min(errors) if errors else 0))
+                for i, r in enumerate(results):
+                    if not r:
+                        continue
+                    boxes[i].history.append((n, r[0]))
+                    if csv:
+                        csv.write("%d,%d,%.3f,%.2f,%d\n" % (n, i, r[0], r[1], r[2]))
+            n += 1
+            time.sleep(max(0.0, args.interval - (time.monotonic() - start)))
+    except KeyboardInterrupt:
+        pass
+    except (IOError, OSError) as e:
+        sys.stderr.write("%s\n" % e)
+        status = 1
+    finally:
+        if csv:
+            csv.close()
+        stop_sims(procs)
+
+    if status == 0 and any(b.history for b in boxes):
+        half = max(r for b in boxes for r, _ in b.history) // 2
+        rounds = {}
+        for b in boxes:
+            for r, e in b.history:
+                if r > half:
+                    rounds.setdefault(r, []).append(e)
+        worst = max(abs(e) for es in rounds.values() for e in es)
+        spread = max(max(es) - min(es) for es in rounds.values())
+        print("second half: worst error %.2f ticks, worst spread %.2f ticks" % (worst, spread))
+    if tmp:
+        print("simulator logs in %s" % tmp)
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+trace_to_replay.py - Convert an on-device input trace into a replay log
+
+Firmware built with INPUT_TRACE_ENABLE keeps the most recent inputs in a
+RAM ring (see MK312BT/input_trace.h). Read the 129 bytes at virtual
+addresses 0x4300-0x4380 over serial (the ring, then the head counter) and
+save them as hex text, any layout:
+
+    3a 00 05 02  3b 00 01 53  ...  17
+
+This script turns the dump into a tick-keyed session log for the
+Linux-native build:
+
+    python3 Host/tools/trace_to_replay.py dump.txt -o field.log
+    Host/sim/build/mk312bt-sim -r field.log -t 30
+
+The ring holds only INPUT_TRACE_DEPTH entries, so the log reproduces the
+lead-up to a fault, not the whole session: inputs older than the ring start
+from the simulator's defaults, and knob values carry the 8-bit resolution
+and hysteresis of the on-device logger.
+"""
+
+import argparse
+import sys
+
+DEPTH = 32
+ENTRY = 4
+
+RX, LEVEL_A, LEVEL_B, MA, BUTTONS, SEED_LO, SEED_HI = range(1, 8)
+KNOB_CHANNEL = {LEVEL_A: 4, LEVEL_B: 5, MA: 1}   # ADC channel in the sim
+
+# prng_init() is fed TCNT0 ^ (TCNT1L << 8) ^ 0x5A3C; undo the mix so the
+# simulator's power-on timer values reproduce the logged seed.
+SEED_MIX = (0x3C, 0x5A)
+
+
+def parse_dump(text):
+    data = bytes(int(tok, 16) for tok in text.replace(",", " ").split())
+    if len(data) != DEPTH * ENTRY + 1:
+        raise ValueError("expected %d bytes (ring + head), got %d"
+                         % (DEPTH * ENTRY + 1, len(data)))
+    return data[:-1], data[-1]
+
+
+def entries(ring, head):
+    """Yield (tick16, kind, value) oldest first."""
+    if head < DEPTH:
+        order = range(head)
+    else:
+        start = head % DEPTH
+        order = [(start + i) % DEPTH for i in range(DEPTH)]
+    for i in order:
+        lo, hi, kind, value = ring[i * ENTRY:(i + 1) * ENTRY]
+        yield lo | (hi << 8), kind, value
+
+
+def convert(ring, head):
+    lines = ["cfg autostart 1"]
+    tick = prev = None
+    for tick16, kind, value in entries(ring, head):
+        # Unwrap the 16-bit stamps; entries are in time order. A wrapped
+        # ring has lost the early entries and with them absolute time, so
+        # its oldest surviving entry starts at tick 0.
+        if prev is None:
+            tick = tick16 if head < DEPTH else 0
+        else:
+            tick += (tick16 - prev) & 0xFFFF
+        prev = tick16
+        if kind == RX:
+            event = "rx %u" % value
+        elif kind in KNOB_CHANNEL:
+            event = "adc %u %u" % (KNOB_CHANNEL[kind], value << 2)
+        elif kind == BUTTONS:
+            event = "buttons %u" % value
+        elif kind in (SEED_LO, SEED_HI):
+            which = kind - SEED_LO
+            event = "seed %u %u" % (which, value ^ SEED_MIX[which])
+        else:
+            sys.stderr.write("skipping unknown entry kind %u\n" % kind)
+            continue
+        lines.append("- %u %s" % (tick, event))
+    return lines
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("dump", help="hex dump of 0x4300-0x4380")
+    ap.add_argument("-o", "--output", help="replay log (default: stdout)")
+    args = ap.parse_args()
+
+    with open(args.dump) as f:
+        try:
+            ring, head = parse_dump(f.read())
+        except ValueError as e:
+            sys.exit("%s: %s" % (args.dump, e))
+
+    text = "\n".join(convert(ring, head)) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
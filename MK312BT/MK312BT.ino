@@ -15,10 +15,11 @@
  *     1. Reset watchdog timer
  *     2. Handle button input (mode selection, menu navigation)
  *     3. Read level pots and MA knob via ADC, update DAC intensity
- *     4. Run mode dispatcher (parameter engine or bytecode)
+ *     4. Run mode dispatcher (parameter engine or bytecode), or a sub-tick
+ *        of the engine's glides between its ticks (ENGINE_RATE)
  *     5. For audio modes, process audio inputs to modulate intensity
  *     6. Convert channel_a/channel_b register values to pulse generator parameters
- *     7. Update LCD display periodically
+ *     7. Update LCD display periodically, send pending host LCD text
  *
  * All live channel state (gate, freq, width, intensity, ramp) is read
  * directly from channel_a / channel_b (ChannelBlock). g_mk312bt_state
@@ -34,6 +35,7 @@
 #include "MK312BT_Utils.h"
 #include "mode_programs.h"
 #include "mode_dispatcher.h"
+#include "param_engine.h"
 #include "channel_mem.h"
 #include "config.h"
 #include "audio_processor.h"
@@ -45,13 +47,15 @@
 #include "pulse_gen.h"
 #include "prng.h"
 #include "user_programs.h"
+#include "session_rec.h"
+#include "input_trace.h"
+#include "tick_sync.h"
+#include "lcd_fb.h"
 
 volatile MK312BTState g_mk312bt_state;
-eeprom_config_t g_menu_config;
 
 unsigned long last_menu_update = 0;
 unsigned long last_ramp_update = 0;
-unsigned long last_mode_update = 0;
 unsigned long last_button_poll = 0;
 
 uint8_t CurrentModeIX = 0;
@@ -65,7 +69,7 @@ uint16_t ChannelBModulationBase;
 static uint8_t last_power_level = 0xFF;
 
 static void applyPowerLevel(void) {
-  uint8_t pl = g_menu_config.power_level;
+  uint8_t pl = config_get()->power_level;
   if (pl == last_power_level) return;
   last_power_level = pl;
   switch (pl) {
@@ -99,7 +103,7 @@ void initializeHardware() {
 
   DDRB = 0xFF;
   DDRC = 0xFF;
-  DDRD = 0xFF;
+  DDRD = DDRD_INIT_STATE;
 
   PORTB = 0x00;
   PORTC = 0x00;
@@ -116,8 +120,9 @@ void initializeHardware() {
 
   SPCR = SPI_MASTER_MODE | SPI_CLOCK_DIV_16;
 
-  GICR  = 0x00;
   MCUCR = (1 << ISC01) | (1 << ISC11);
+  GIFR  = (1 << INTF0) | (1 << INTF1);
+  GICR  = (1 << INT0) | (1 << INT1);
 
   sei();
 }
@@ -138,6 +143,9 @@ void handleUserInput() {
 
   lcd_disable_buttons();
 
+  input_trace_buttons((down_reading << 0) | (ok_reading << 1) |
+                      (up_reading << 2) | (menu_reading << 3));
+
   unsigned long now = millis();
   bool debounce_ok = (now - last_event_ms) >= 150;
 
@@ -164,9 +172,10 @@ void handleUserInput() {
   if (event != BUTTON_NONE) {
     last_event_ms = now;
     *POT_LOCKOUT_FLAGS = 0x00;
+    lcd_fb_release();
     menuHandleButton(event);
-    if (CurrentModeIX != g_menu_config.top_mode) {
-      CurrentModeIX = g_menu_config.top_mode;
+    if (CurrentModeIX != config_get()->current_mode) {
+      CurrentModeIX = config_get()->current_mode;
       mode_dispatcher_select_mode(CurrentModeIX);
     }
   }
@@ -193,12 +202,14 @@ uint8_t readAndUpdateChannel(uint8_t c) {
 
   if (c == 0) {
     uint16_t v = analogRead(ADC_CHANNEL_LEVEL_A_PIN);
+    input_trace_knob(INPUT_TRACE_LEVEL_A, v);
     uint8_t bv = min(99, max(0, (uint8_t)(v >> 3)));
 uint16_t dac_val = ChannelAPwrBase +
   ((uint32_t)ChannelAModulationBase * (uint32_t)(DAC_MAX_VALUE - v)) / 1024;
     if (dac_val > DAC_MAX_VALUE) dac_val = DAC_MAX_VALUE;
 
     uint8_t intensity = ramp_scale_intensity(channel_a.intensity_value, channel_a.ramp_value);
+    intensity = mode_dispatcher_xfade(0, intensity);
     intensity = (uint8_t)(((uint16_t)intensity * menu_ramp) / 100);
     dac_val = DAC_MAX_VALUE - (uint16_t)(((uint32_t)(DAC_MAX_VALUE - dac_val) * intensity) >> 8);
 
@@ -206,12 +217,14 @@ uint16_t dac_val = ChannelAPwrBase +
     return bv;
   } else {
     uint16_t v = analogRead(ADC_CHANNEL_LEVEL_B_PIN);
+    input_trace_knob(INPUT_TRACE_LEVEL_B, v);
     uint8_t bv = min(99, max(0, (uint8_t)(v / 8)));
     uint16_t dac_val = ChannelBPwrBase +
       ((uint32_t)ChannelBModulationBase * (uint32_t)(DAC_MAX_VALUE - v)) / 1024;
     if (dac_val > DAC_MAX_VALUE) dac_val = DAC_MAX_VALUE;
 
     uint8_t intensity = ramp_scale_intensity(channel_b.intensity_value, channel_b.ramp_value);
+    intensity = mode_dispatcher_xfade(1, intensity);
     intensity = (uint8_t)(((uint16_t)intensity * menu_ramp) / 100);
     dac_val = DAC_MAX_VALUE - (uint16_t)(((uint32_t)(DAC_MAX_VALUE - dac_val) * intensity) >> 8);
 
@@ -232,8 +245,8 @@ void runningLine1() {
     //*MULTI_ADJUST = channel_get_reg_ptr(0x08086); // MA MIN
     // system_config_t* sys_config = config_get();
     // sys_config->multi_adjust = (uint8_t)(ma_read_level(); >> 2);
-    // Multi Adjust 0-255 Scaled 
-  *MULTI_ADJUST = map_ma(map(min(75, max(0, (uint8_t)(ma_read_level() >> 2))), 0, 75, 0, 255), ((uint8_t*)&channel_a)[7], ((uint8_t*)&channel_a)[6]);   
+    // Multi Adjust 0-255, scaled per channel by the parameter engine
+  param_engine_set_ma_knob(map(min(75, max(0, (uint8_t)(ma_read_level() >> 2))), 0, 75, 0, 255));
   }
 }
 
@@ -245,6 +258,7 @@ void setup() {
   WDTCR = 0x00;
   initializeHardware();
   initialize_lcd();
+  lcd_fb_init();
   lcd_backlight_on();
   serial_init();
 
@@ -258,16 +272,20 @@ void setup() {
   config_load_from_eeprom();
   config_apply_to_memory();
 
-  if (!eeprom_load_config(&g_menu_config)) {
-    eeprom_init_defaults(&g_menu_config);
-  }
-  if (g_menu_config.top_mode >= MODE_COUNT) {
-    g_menu_config.top_mode = 0;
-  }
-  if (g_menu_config.top_mode >= MODE_USER1 && g_menu_config.top_mode < MODE_SPLIT) {
-    if (!user_prog_is_valid(g_menu_config.top_mode - MODE_USER1)) {
-      g_menu_config.top_mode = 0;
+  {
+    uint8_t top_mode = config_get()->current_mode;
+    if (top_mode >= MODE_COUNT) {
+      top_mode = 0;
     }
+    if (top_mode >= MODE_USER1 && top_mode < MODE_SPLIT) {
+      if (!user_prog_is_valid(top_mode - MODE_USER1)) {
+        top_mode = 0;
+      }
+    }
+    if (top_mode == MODE_SESSION && !session_rec_is_valid()) {
+      top_mode = 0;
+    }
+    config_set(CONFIG_FIELD(current_mode), top_mode);
   }
 
   static const char chk_hw[] PROGMEM = "Check hardware";
@@ -337,7 +355,7 @@ void setup() {
 
   last_button_poll = millis();
 
-  CurrentModeIX = g_menu_config.top_mode;
+  CurrentModeIX = config_get()->current_mode;
   mode_dispatcher_select_mode(CurrentModeIX);
 
   sei();
@@ -348,7 +366,7 @@ void setup() {
 
   last_menu_update = millis();
   last_ramp_update = millis();
-  last_mode_update = millis();
+  tick_sync_init();
 }
 
 void loop() {
@@ -363,8 +381,7 @@ void loop() {
         menuStartOutput();
       } else if (deferred_result == 1) {
         CurrentModeIX = mode_dispatcher_get_mode();
-        config_get()->current_mode = CurrentModeIX;
-        g_menu_config.top_mode = CurrentModeIX;
+        config_set(CONFIG_FIELD(current_mode), CurrentModeIX);
         menuStartOutput();
       }
     }
@@ -376,12 +393,14 @@ void loop() {
   }
 
   applyPowerLevel();
-  //config_sync_from_eeprom_config(&g_menu_config);
   runningLine1();
 
-  if (millis() - last_mode_update >= 4) {
-    last_mode_update = millis();
+  uint8_t due = tick_sync_due();
+  if (due == TICK_SYNC_SUB) {
+    mode_dispatcher_subtick();
+  } else if (due) {
     mode_dispatcher_update();
+    audio_freq_tick();
 
     // --- Audio processing for audio modes ---
     uint8_t cur_mode = mode_dispatcher_get_mode();
@@ -389,6 +408,9 @@ void loop() {
         audio_process_channel_a();
         audio_process_channel_b();
     }
+
+    config_commit_step();
+    session_rec_tick();
   }
 
   uint8_t gate_a  = channel_a.gate_value & GATE_ON_BIT;
@@ -399,8 +421,9 @@ void loop() {
   uint8_t freq_b  = channel_b.freq_value;
   uint8_t width_b = channel_b.width_value;
 
-  uint16_t period_a_us = (freq_a < 2) ? 65000 : (uint16_t)((uint32_t)freq_a * 256UL);
-  uint16_t period_b_us = (freq_b < 2) ? 65000 : (uint16_t)((uint32_t)freq_b * 256UL);
+  // freq_value:freq_frac is the period in us (8.8); freq_frac = 0 gives the legacy freq_value * 256
+  uint16_t period_a_us = (freq_a < 2) ? 65000 : (uint16_t)(((uint16_t)freq_a << 8) | channel_a.freq_frac);
+  uint16_t period_b_us = (freq_b < 2) ? 65000 : (uint16_t)(((uint16_t)freq_b << 8) | channel_b.freq_frac);
 
   uint8_t width_a_us = (uint8_t)(70 + ((uint16_t)width_a * 180) >> 8);
   uint8_t width_b_us = (uint8_t)(70 + ((uint16_t)width_b * 180) >> 8);
@@ -409,6 +432,10 @@ void loop() {
   pulse_set_width_b(width_b_us);
   pulse_set_frequency_a(period_a_us);
   pulse_set_frequency_b(period_b_us);
+  pulse_set_burst_a(channel_a.burst_pulses_on, channel_a.burst_pulses_off);
+  pulse_set_burst_b(channel_b.burst_pulses_on, channel_b.burst_pulses_off);
+  pulse_set_polarity_a(channel_a.gate_value);
+  pulse_set_polarity_b(channel_b.gate_value);
 
   bool output_on = menuIsOutputEnabled();
   uint8_t pulse_a_on = (output_on && gate_a && freq_a >= 2) ? PULSE_ON : PULSE_OFF;
@@ -442,7 +469,7 @@ else
   if (millis() - last_menu_update >= 200) {
     last_menu_update = millis();
     if (menu_state.current_menu == MENU_MAIN) {
-      menuShowMode(g_menu_config.top_mode);
+      menuShowMode(config_get()->current_mode);
     }
   }
 
@@ -450,5 +477,7 @@ else
     last_ramp_update = millis();
     menuHandleRampUp();
   }
+
+  lcd_fb_flush();
   
 }
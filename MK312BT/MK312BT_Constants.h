@@ -106,6 +106,8 @@
 #define PORTD_BIT_LED_A           6   /* PD6: Channel A activity LED */
 #define PORTD_BIT_LED_B           5   /* PD5: Channel B activity LED */
 #define PORTD_BIT_DAC_CS          4   /* PD4: LTC1661 DAC chip select (active low) */
+#define PORTD_BIT_EDGE_A          3   /* PD3/INT1: Line In R digital input (input) */
+#define PORTD_BIT_EDGE_B          2   /* PD2/INT0: Line In L / Mic digital input (input) */
 
 /* DAC chip select (directly driven, active low) */
 #define DAC_CS_LD                 PORTD_BIT_DAC_CS
@@ -183,7 +185,47 @@
 #define LCD_INIT_8BIT      0x30  /* 8-bit mode init command */
 #define LCD_INIT_4BIT      0x20  /* Switch to 4-bit mode command */
 
-/* PORTD initial state: PD7-PD2 high, PD1-PD0 low */
+/* HD44780 write pacing: 1 = poll the busy flag (DB7, RW on PC1) before
+ * each byte, 0 = fixed worst-case delays only. */
+#ifndef LCD_USE_BUSY_FLAG
+#define LCD_USE_BUSY_FLAG       1
+#endif
+#define LCD_BUSY_TIMEOUT_POLLS  600   /* ~4.9 ms of polling (~8 us each), > Clear/Home */
+
+/* On-device input trace (input_trace.c): 1 = log serial bytes, knob and
+ * button changes and the PRNG seed into a RAM ring readable at
+ * VIRT_RAM_TRACE_BASE. Off by default; costs 4 bytes of RAM per entry,
+ * which at depth 32 leaves no room for the worst-case stack (bench
+ * builds only, ARCHITECTURE.md "SRAM Budget"). */
+#ifndef INPUT_TRACE_ENABLE
+#define INPUT_TRACE_ENABLE      0
+#endif
+#define INPUT_TRACE_DEPTH       32    /* Entries, power of two */
+
+/* Output dose meter (pulse_gen.h): 1 = count pulses, on-time and energy
+ * per channel in the pulse ISRs, readable at 0x43AF-0x43FF. Off by
+ * default; costs 73 bytes of static RAM and 6 bytes of Timer1 ISR stack
+ * (ARCHITECTURE.md, "SRAM Budget"). */
+#ifndef DOSE_METER_ENABLE
+#define DOSE_METER_ENABLE       0
+#endif
+
+/* Live session recorder (session_rec.c) */
+#define SESSION_REC_TICKS_PER_FRAME  32   /* Engine ticks per sample, ~7 Hz */
+#define SESSION_REC_QUEUE            8    /* Encoded bytes waiting for EEPROM, > one frame */
+
+/* Deferred box command queue (mode_dispatcher.c) */
+#define DEFERRED_QUEUE_DEPTH    4     /* Commands, power of two */
+
+/* Audio edge frequency tracker (audio_processor.c) */
+#define AUDIO_EDGE_BURST_MAX    32    /* Edges per engine tick (8 kHz) before the input is cut off */
+#define AUDIO_EDGE_TIMEOUT      16    /* Ticks without an edge before the period reads 0 */
+#define AUDIO_EDGE_PERIOD_MIN   512   /* Shortest pulse period the follow mode sets (us) */
+
+/* PORTD direction: all outputs except the INT0/INT1 edge inputs */
+#define DDRD_INIT_STATE    ((uint8_t)~((1<<PORTD_BIT_EDGE_A)|(1<<PORTD_BIT_EDGE_B)))
+
+/* PORTD initial state: PD7-PD2 high (pull-ups on PD3-PD2), PD1-PD0 low */
 #define PORTD_INIT_STATE   ((1<<PORTD_BIT_BACKLIGHT)|(1<<PORTD_BIT_LED_A)|(1<<PORTD_BIT_LED_B)|(1<<PORTD_BIT_DAC_CS)|(1<<3)|(1<<2))
 
 #endif
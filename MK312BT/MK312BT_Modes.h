@@ -1,11 +1,12 @@
 /*
  * MK312BT_Modes.h - Mode Enumeration
  *
- * Defines the MK312BTMode enum with all 25 operating modes:
+ * Defines the MK312BTMode enum with all 26 operating modes:
  *   Modes 0-16  (Waves through Phase3): Built-in modes using the parameter engine
  *   Modes 17-23 (User1 through User7):  User-programmable modes using bytecode interpreter
  *   Mode 24     (Split):                 Independent channel control via bytecode
- *   MODE_COUNT  (25):                    Total number of modes
+ *   Mode 25     (Session):               Playback of the live session recording
+ *   MODE_COUNT  (26):                    Total number of modes
  *
  * Built-in modes (0-16) are configured via the PROGMEM table in mode_behavior.c.
  * User modes (17-24) execute bytecode programs from mode_programs.c.
@@ -45,8 +46,9 @@ typedef enum {
   MODE_USER6,       /* User program slot 6 */
   MODE_USER7,       /* User program slot 7 */
   MODE_SPLIT,       /* Independent channel control */
+  MODE_SESSION,     /* Recorded live session (session_rec.c) */
 
-  MODE_COUNT        /* Total number of modes (25) */
+  MODE_COUNT        /* Total number of modes (26) */
 } MK312BTMode;
 
 #endif
@@ -16,6 +16,7 @@
 #include "adc.h"
 #include "MK312BT_Constants.h"
 #include "avr_registers.h"
+#include "input_trace.h"
 
 
 uint16_t adc_read_level_a(void) {
@@ -39,7 +40,9 @@ uint16_t adc_read_battery(void) {
 }
 
 uint16_t ma_read_level(void) {
-    return fastAnalogRead(ADC_MULTI_ADJ_VR3G1);
+    uint16_t v = fastAnalogRead(ADC_MULTI_ADJ_VR3G1);
+    input_trace_knob(INPUT_TRACE_MA, v);
+    return v;
 }
 
 
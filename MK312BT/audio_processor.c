@@ -1,5 +1,5 @@
 /*
- * audio_processor.c - Audio Input Envelope Follower
+ * audio_processor.c - Audio Input Envelope Follower and Frequency Tracker
  *
  * Processes audio input from the line-in jacks to modulate channel intensity.
  * Used by Audio1/Audio2/Audio3 modes for sound-reactive output.
@@ -9,6 +9,17 @@
  *   - Divide by two
  *   - If LSB was 1, subtract 0x53
  *   - Clamp to 0-255, write to intensity_value
+ *
+ * Frequency tracking is reciprocal counting: the INT ISRs only count
+ * falling edges and stamp the latest one, and audio_freq_tick() divides
+ * the time between the latest edge of this update and that of the
+ * previous one by the edges in between. Every edge period in the span is
+ * averaged, so the timestamp resolution and ISR latency only enter once
+ * per span. The result goes through a 1/4 IIR; a sample more than 25% off
+ * (a new note) is taken as is. Each ISR disarms its own INT while it runs
+ * with interrupts on, so the pulse timers can preempt it, and stays
+ * disarmed after AUDIO_EDGE_BURST_MAX edges in one tick, so a noisy input
+ * cannot starve the main loop; the next tick re-arms it and restarts.
  */
 
 #include "audio_processor.h"
@@ -16,8 +27,116 @@
 #include "channel_mem.h"
 #include "config.h"
 #include "adc.h"
+#include "avr_registers.h"
+#include <avr/interrupt.h>
 #include <stdint.h>
 
+extern unsigned long micros(void);
+
+#define AUDIO_EDGE_TIMEOUT_US  40000UL  /* No edge this long: no input (< 16-bit stamp range) */
+
+audio_freq_t audio_freq;
+
+/* Written by the INT ISRs */
+typedef struct {
+    volatile uint8_t  count;        /* Edges seen, wraps */
+    volatile uint16_t stamp;        /* micros() of the latest edge, low 16 bits */
+    volatile uint8_t  burst;        /* Edges since the last audio_freq_tick() */
+} audio_edge_t;
+
+/* Main loop side */
+typedef struct {
+    uint8_t  count;                 /* Edge count at the reference edge */
+    uint16_t stamp;                 /* Its timestamp */
+    uint8_t  have_ref;
+    uint16_t seen_us;               /* micros() when an edge was last seen, low 16 bits */
+    uint32_t smooth;                /* Period in 1/16 us, 0 = no input */
+} audio_track_t;
+
+static audio_edge_t edge_a, edge_b;
+static audio_track_t track_a, track_b;
+
+ISR(INT1_vect)
+{
+    GICR &= ~(1 << INT1);
+    sei();
+    edge_a.stamp = (uint16_t)micros();
+    edge_a.count++;
+    cli();
+    if (++edge_a.burst < AUDIO_EDGE_BURST_MAX) GICR |= (1 << INT1);
+}
+
+ISR(INT0_vect)
+{
+    GICR &= ~(1 << INT0);
+    sei();
+    edge_b.stamp = (uint16_t)micros();
+    edge_b.count++;
+    cli();
+    if (++edge_b.burst < AUDIO_EDGE_BURST_MAX) GICR |= (1 << INT0);
+}
+
+static void put_period(uint8_t *p, uint32_t smooth) {
+    uint32_t us = (smooth + 8) >> 4;
+    if (us > 0xFFFF) us = 0xFFFF;
+    p[0] = (uint8_t)us;
+    p[1] = (uint8_t)(us >> 8);
+}
+
+static void track(audio_track_t *t, audio_edge_t *e, uint8_t int_bit, uint8_t *period) {
+    cli();
+    uint8_t count = e->count;
+    uint16_t stamp = e->stamp;
+    uint8_t burst = e->burst;
+    e->burst = 0;
+    if (burst >= AUDIO_EDGE_BURST_MAX) {
+        GIFR = (1 << int_bit);      /* INTFn has the same bit as INTn */
+        GICR |= (1 << int_bit);
+    }
+    sei();
+
+    if (burst >= AUDIO_EDGE_BURST_MAX) {
+        /* Edges were missed while disarmed: no period across the gap */
+        if (audio_freq.overloads != 0xFF) audio_freq.overloads++;
+        t->have_ref = 0;
+        t->smooth = 0;
+    } else if (count == t->count) {
+        if ((uint16_t)((uint16_t)micros() - t->seen_us) > AUDIO_EDGE_TIMEOUT_US) {
+            t->have_ref = 0;
+            t->smooth = 0;
+        }
+    } else {
+        if (t->have_ref) {
+            uint32_t sample = ((uint32_t)(uint16_t)(stamp - t->stamp) << 4) / (uint8_t)(count - t->count);
+            uint32_t slack = t->smooth >> 2;
+            if (sample > t->smooth + slack || sample < t->smooth - slack) {
+                t->smooth = sample;
+            } else {
+                t->smooth += ((int32_t)sample - (int32_t)t->smooth) >> 2;
+            }
+        }
+        t->count = count;
+        t->stamp = stamp;
+        t->have_ref = 1;
+        t->seen_us = (uint16_t)micros();
+    }
+    put_period(period, t->smooth);
+}
+
+void audio_freq_tick(void) {
+    track(&track_a, &edge_a, INT1, audio_freq.period_a);
+    track(&track_b, &edge_b, INT0, audio_freq.period_b);
+}
+
+/* Pulse period = input period, when there is an input */
+static void follow(ChannelBlock *ch, const uint8_t *period) {
+    uint16_t us = (uint16_t)period[0] | ((uint16_t)period[1] << 8);
+    if (us == 0) return;
+    if (us < AUDIO_EDGE_PERIOD_MIN) us = AUDIO_EDGE_PERIOD_MIN;
+    ch->freq_value = (uint8_t)(us >> 8);
+    ch->freq_frac = (uint8_t)us;
+}
+
 void audio_init(void) {
 }
 
@@ -31,6 +150,7 @@ void audio_process_channel_a(void) {
     }
     if (half > 255) half = 255;
     channel_a.intensity_value = (uint8_t)half;
+    if (audio_freq.ctrl & AUDIO_FREQ_FOLLOW_A) follow(&channel_a, audio_freq.period_a);
 }
 
 void audio_process_channel_b(void) {
@@ -43,4 +163,5 @@ void audio_process_channel_b(void) {
     }
     if (half > 255) half = 255;
     channel_b.intensity_value = (uint8_t)half;
-}
\ No newline at end of file
+    if (audio_freq.ctrl & AUDIO_FREQ_FOLLOW_B) follow(&channel_b, audio_freq.period_b);
+}
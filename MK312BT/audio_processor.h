@@ -1,8 +1,14 @@
 /*
- * audio_processor.h - Audio Input Envelope Follower
+ * audio_processor.h - Audio Input Envelope Follower and Frequency Tracker
  *
  * Rectifies and scales audio line-in signals to modulate
  * channel intensity for Audio1/Audio2/Audio3 modes.
+ *
+ * The digital audio inputs (INT1 on PD3 for channel A, INT0 on PD2 for
+ * channel B, falling edges) are timestamped by their ISRs; once per engine
+ * tick audio_freq_tick() turns edge count and last timestamp into the mean
+ * period since the previous update and smooths it. With AUDIO_FREQ_FOLLOW_x
+ * set, the audio modes also take the pulse period from that channel's input.
  */
 
 #ifndef AUDIO_PROCESSOR_H
@@ -14,9 +20,25 @@
 extern "C" {
 #endif
 
+/* audio_freq.ctrl bits */
+#define AUDIO_FREQ_FOLLOW_A  0x01   /* Audio modes: channel A period = input A period */
+#define AUDIO_FREQ_FOLLOW_B  0x02
+
+/* Serial 0x43E0-0x43E5, bytecode 0x3E0-0x3E5. Periods are little-endian
+ * microseconds, 0 = no input; 1000000 / period is the input frequency in Hz. */
+typedef struct {
+    uint8_t period_a[2];    /* Smoothed input period, channel A */
+    uint8_t period_b[2];    /* Smoothed input period, channel B */
+    uint8_t ctrl;           /* AUDIO_FREQ_FOLLOW_*, cleared on mode change */
+    uint8_t overloads;      /* Edge bursts cut off at AUDIO_EDGE_BURST_MAX (saturates) */
+} audio_freq_t;
+
+extern audio_freq_t audio_freq;
+
 void audio_init(void);               /* Initialize gain to default (128 = unity) */
 void audio_process_channel_a(void);  /* Process right line-in -> Ch A intensity */
 void audio_process_channel_b(void);  /* Process left line-in/mic -> Ch B intensity */
+void audio_freq_tick(void);          /* Update the periods, once per engine tick */
 
 #ifdef __cplusplus
 }
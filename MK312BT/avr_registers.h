@@ -3,7 +3,8 @@
  *
  * Memory-mapped I/O register addresses and bit positions for the ATmega16
  * microcontroller. Used as a compatibility shim for non-AVR-GCC compilation
- * environments (e.g., Arduino IDE, simulation).
+ * environments (e.g., Arduino IDE, simulation). With MK312BT_HOST_BUILD the
+ * same names resolve to the Host/sim register file instead.
  *
  * Register groups:
  *   GPIO Ports   - PORTB (H-bridge FETs, SPI), PORTC (LCD/buttons), PORTD (LEDs, DAC CS, USART)
@@ -14,7 +15,7 @@
  *   ADC          - ADMUX channel select, ADCSRA control, ADCL/ADCH result
  *   SPI          - SPCR/SPSR/SPDR for LTC1661 DAC communication
  *   EEPROM       - EEARL/H address, EEDR data, EECR control
- *   Interrupts   - MCUCR, GICR for external interrupt config
+ *   Interrupts   - MCUCR, GICR, GIFR for external interrupt config
  *
  * Pin assignments are documented in MK312BT_Constants.h.
  */
@@ -24,25 +25,35 @@
 
 #include <stdint.h>
 
+#ifdef MK312BT_HOST_BUILD
+/* Linux-native build (Host/sim): every access goes through the simulator's
+ * register file so the peripheral models see each read and write. */
+#include "host_io.h"
+#define AVR_REG8(addr) (*host_io_reg(addr))
+#else
+#define AVR_REG8(addr) (*(volatile uint8_t*)(addr))
+#endif
+
 /* GPIO Port B: H-bridge FET gates (PB0-PB3), SPI bus (PB5-PB7) */
-#define PORTB (*(volatile uint8_t*)0x38)
-#define DDRB  (*(volatile uint8_t*)0x37)
+#define PORTB AVR_REG8(0x38)
+#define DDRB  AVR_REG8(0x37)
 
 /* GPIO Port C: LCD data bus (PC4-PC7), LCD control (PC1-PC3), button activate (PC0) */
-#define PORTC (*(volatile uint8_t*)0x35)
-#define DDRC  (*(volatile uint8_t*)0x34)
+#define PORTC AVR_REG8(0x35)
+#define DDRC  AVR_REG8(0x34)
+#define PINC  AVR_REG8(0x33)  /* Pin input: buttons / LCD busy flag */
 
 /* GPIO Port D: LEDs (PD5-PD6), DAC chip select (PD4), USART (PD0-PD1), LCD backlight (PD7) */
-#define PORTD (*(volatile uint8_t*)0x32)
-#define DDRD  (*(volatile uint8_t*)0x31)
+#define PORTD AVR_REG8(0x32)
+#define DDRD  AVR_REG8(0x31)
 
 /* USART registers - 19200 baud serial link via MAX232 level shifter */
-#define UDR    (*(volatile uint8_t*)0x2C)  /* Data register (TX/RX) */
-#define UCSRA  (*(volatile uint8_t*)0x2B)  /* Status: RXC (bit 7), UDRE (bit 5) */
-#define UCSRB  (*(volatile uint8_t*)0x2A)  /* Control: enable TX/RX, interrupts */
-#define UCSRC  (*(volatile uint8_t*)0x40)  /* Frame format: 8N1 */
-#define UBRRL  (*(volatile uint8_t*)0x29)  /* Baud rate low byte */
-#define UBRRH  (*(volatile uint8_t*)0x40)  /* Baud rate high byte (shares addr with UCSRC) */
+#define UDR    AVR_REG8(0x2C)  /* Data register (TX/RX) */
+#define UCSRA  AVR_REG8(0x2B)  /* Status: RXC (bit 7), UDRE (bit 5) */
+#define UCSRB  AVR_REG8(0x2A)  /* Control: enable TX/RX, interrupts */
+#define UCSRC  AVR_REG8(0x40)  /* Frame format: 8N1 */
+#define UBRRL  AVR_REG8(0x29)  /* Baud rate low byte */
+#define UBRRH  AVR_REG8(0x40)  /* Baud rate high byte (shares addr with UCSRC) */
 
 #define RXC   7   /* UCSRA: Receive Complete flag */
 #define UDRE  5   /* UCSRA: Data Register Empty (ready to transmit) */
@@ -59,37 +70,37 @@
 #define UCSZ0 1   /* Character Size bit 0 */
 
 /* Timer1 - 16-bit, CTC mode, /8 prescaler: Channel A biphasic pulse generation */
-#define TCNT1L (*(volatile uint8_t*)0x4C)  /* Counter low byte */
-#define TCNT1H (*(volatile uint8_t*)0x4D)  /* Counter high byte */
-#define OCR1AL (*(volatile uint8_t*)0x4A)  /* Output Compare A low byte (pulse timing) */
-#define OCR1AH (*(volatile uint8_t*)0x4B)  /* Output Compare A high byte */
-#define TCCR1A (*(volatile uint8_t*)0x4F)  /* Control A (WGM bits) */
-#define TCCR1B (*(volatile uint8_t*)0x4E)  /* Control B (WGM12, CS11 for CTC /8) */
+#define TCNT1L AVR_REG8(0x4C)  /* Counter low byte */
+#define TCNT1H AVR_REG8(0x4D)  /* Counter high byte */
+#define OCR1AL AVR_REG8(0x4A)  /* Output Compare A low byte (pulse timing) */
+#define OCR1AH AVR_REG8(0x4B)  /* Output Compare A high byte */
+#define TCCR1A AVR_REG8(0x4F)  /* Control A (WGM bits) */
+#define TCCR1B AVR_REG8(0x4E)  /* Control B (WGM12, CS11 for CTC /8) */
 
 /* Timer2 - 8-bit, CTC mode, /8 prescaler: Channel B biphasic pulse generation */
-#define TCNT2  (*(volatile uint8_t*)0x44)  /* Counter value */
-#define TCCR2  (*(volatile uint8_t*)0x45)  /* Control (WGM21, CS21 for CTC /8) */
-#define OCR2   (*(volatile uint8_t*)0x43)  /* Output Compare (pulse timing, 8-bit limit) */
+#define TCNT2  AVR_REG8(0x44)  /* Counter value */
+#define TCCR2  AVR_REG8(0x45)  /* Control (WGM21, CS21 for CTC /8) */
+#define OCR2   AVR_REG8(0x43)  /* Output Compare (pulse timing, 8-bit limit) */
 
 /* Timer Interrupt Mask - enables compare match interrupts for pulse ISRs */
-#define TIMSK  (*(volatile uint8_t*)0x59)
+#define TIMSK  AVR_REG8(0x59)
 
 /* ADC - 10-bit successive approximation, 6 channels on Port A */
-#define ADMUX  (*(volatile uint8_t*)0x27)  /* Channel select + voltage reference */
-#define ADCSRA (*(volatile uint8_t*)0x26)  /* Control: ADSC start, prescaler, enable */
-#define ADCL   (*(volatile uint8_t*)0x24)  /* Result low byte (must read first) */
-#define ADCH   (*(volatile uint8_t*)0x25)  /* Result high byte */
+#define ADMUX  AVR_REG8(0x27)  /* Channel select + voltage reference */
+#define ADCSRA AVR_REG8(0x26)  /* Control: ADSC start, prescaler, enable */
+#define ADCL   AVR_REG8(0x24)  /* Result low byte (must read first) */
+#define ADCH   AVR_REG8(0x25)  /* Result high byte */
 
 /* SPI - Master mode for LTC1661 DAC communication */
-#define SPDR   (*(volatile uint8_t*)0x2F)  /* Data register (shift in/out) */
-#define SPSR   (*(volatile uint8_t*)0x2E)  /* Status: SPIF transfer complete flag */
-#define SPCR   (*(volatile uint8_t*)0x2D)  /* Control: SPE enable, MSTR master, clock rate */
+#define SPDR   AVR_REG8(0x2F)  /* Data register (shift in/out) */
+#define SPSR   AVR_REG8(0x2E)  /* Status: SPIF transfer complete flag */
+#define SPCR   AVR_REG8(0x2D)  /* Control: SPE enable, MSTR master, clock rate */
 
 /* EEPROM - persistent storage for user config and calibration */
-#define EEARL  (*(volatile uint8_t*)0x3E)  /* Address low byte */
-#define EEARH  (*(volatile uint8_t*)0x3F)  /* Address high byte */
-#define EEDR   (*(volatile uint8_t*)0x3D)  /* Data register */
-#define EECR   (*(volatile uint8_t*)0x3C)  /* Control: EERE read, EEWE write, EEMWE master write */
+#define EEARL  AVR_REG8(0x3E)  /* Address low byte */
+#define EEARH  AVR_REG8(0x3F)  /* Address high byte */
+#define EEDR   AVR_REG8(0x3D)  /* Data register */
+#define EECR   AVR_REG8(0x3C)  /* Control: EERE read, EEWE write, EEMWE master write */
 
 /* EECR bit positions */
 #define EERE   0   /* Read enable - triggers read from EEPROM */
@@ -97,21 +108,28 @@
 #define EEMWE  2   /* Master write enable - must set before EEWE */
 
 /* Watchdog Timer */
-#define WDTCR  (*(volatile uint8_t*)0x41)  /* Watchdog Timer Control Register */
+#define WDTCR  AVR_REG8(0x41)  /* Watchdog Timer Control Register */
 #define WDTOE  4   /* Watchdog Turn-off Enable */
 #define WDE    3   /* Watchdog Enable */
 
 /* Timer0 - 8-bit (used for entropy seeding) */
-#define TCNT0  (*(volatile uint8_t*)0x52)  /* Timer0 counter value */
+#define TCNT0  AVR_REG8(0x52)  /* Timer0 counter value */
 
 /* External interrupt control */
-#define MCUCR  (*(volatile uint8_t*)0x55)  /* MCU control (INT0/INT1 sense control) */
-#define GICR   (*(volatile uint8_t*)0x5B)  /* General interrupt control (INT0/INT1 enable) */
+#define MCUCR  AVR_REG8(0x55)  /* MCU control (INT0/INT1 sense control) */
+#define GICR   AVR_REG8(0x5B)  /* General interrupt control (INT0/INT1 enable) */
+#define GIFR   AVR_REG8(0x5A)  /* General interrupt flags (write 1 to clear) */
 
 /* Interrupt sense control bits (MCUCR) */
 #define ISC01  1   /* INT0 sense control bit 1 */
 #define ISC11  3   /* INT1 sense control bit 1 */
 
+/* External interrupt enable (GICR) and flag (GIFR) bits */
+#define INT0   6   /* GICR: INT0 (PD2) enable */
+#define INT1   7   /* GICR: INT1 (PD3) enable */
+#define INTF0  6   /* GIFR: INT0 flag */
+#define INTF1  7   /* GIFR: INT1 flag */
+
 /* Timer interrupt enable bits (TIMSK register) */
 #define OCIE1A 4   /* Timer1 Compare Match A interrupt enable */
 #define OCIE2  7   /* Timer2 Compare Match interrupt enable */
@@ -138,10 +156,15 @@
 #define ADPS0  0   /* ADCSRA: Prescaler bit 0 */
 
 /* Status register (save/restore for atomic sections) */
-#define SREG   (*(volatile uint8_t*)0x5F)
+#define SREG   AVR_REG8(0x5F)
 
 /* Global interrupt control */
+#ifdef MK312BT_HOST_BUILD
+#define sei() host_io_sei()
+#define cli() host_io_cli()
+#else
 #define sei() __asm__ __volatile__ ("sei" ::: "memory")
 #define cli() __asm__ __volatile__ ("cli" ::: "memory")
+#endif
 
 #endif
@@ -1,4 +1,5 @@
 #include "channel_mem.h"
+#include "register_map.h"
 #include <avr/pgmspace.h>
 #include <string.h>
 
@@ -6,8 +7,8 @@ ChannelBlock channel_a;
 ChannelBlock channel_b;
 
 static const uint8_t channel_defaults[CHAN_BLOCK_SIZE] PROGMEM = {
-    0x00,       // +00  0x80  unused
-    0x00,       // +01  0x81  unused
+    0x00,       // +00  0x80  freq_frac = 0 (period = freq_value * 256 us)
+    0x00,       // +01  0x81  burst_pulses_on = 0 (pulse-count gating off)
     0x02,       // +02  0x82  retry_count
     0x00,       // +03  0x83  output_control_flags
     0x00,       // +04  0x84  cond_module
@@ -25,7 +26,7 @@ static const uint8_t channel_defaults[CHAN_BLOCK_SIZE] PROGMEM = {
     0x07,       // +10  0x90  gate_value = 0x07 (biphasic, gate ON)
     0x00,       // +11  0x91  gate_want_a
     0x00,       // +12  0x92  gate_want_b
-    0x00,       // +13  0x93  unused
+    0x00,       // +13  0x93  burst_pulses_off
     0x00,       // +14  0x94  next_module_timer_cur
     0xFF,       // +15  0x95  next_module_timer_max = 255
     0x00,       // +16  0x96  next_module_select
@@ -83,20 +84,15 @@ void channel_mem_init(void) {
 
 static uint8_t scratch_byte;
 
+/* Bytecode register access. The address decode is the generated
+ * register map, so only blocks marked +BC in register_map.def (the two
+ * channel blocks) are reachable; anything else hits a zeroed scratch byte. */
 uint8_t* channel_get_reg_ptr(uint16_t addr) {
-    uint8_t offset;
-    ChannelBlock *ch;
+    uint8_t *reg = regmap_bytecode_ptr(addr);
 
-    if (addr >= CHAN_BASE_B && addr < CHAN_BASE_B + CHAN_BLOCK_SIZE) {
-        ch = &channel_b;
-        offset = addr - CHAN_BASE_B;
-    } else if (addr >= CHAN_BASE_A && addr < CHAN_BASE_A + CHAN_BLOCK_SIZE) {
-        ch = &channel_a;
-        offset = addr - CHAN_BASE_A;
-    } else {
+    if (!reg) {
         scratch_byte = 0;
         return &scratch_byte;
     }
-
-    return ((uint8_t*)ch) + offset;
+    return reg;
 }
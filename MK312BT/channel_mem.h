@@ -8,14 +8,14 @@ extern "C" {
 #endif
 
 typedef struct {
-    uint8_t unused_80;
-    uint8_t unused_81;
+    uint8_t freq_frac;              // 0x80  Fraction of freq_value in 1/256: period = freq_value:freq_frac us
+    uint8_t burst_pulses_on;        // 0x81  Pulses per burst, counted in the pulse ISR (0 = off)
     uint8_t retry_count;            // 0x82
     uint8_t output_control_flags;   // 0x83
     uint8_t cond_module;            // 0x84
     uint8_t apply_channel;          // 0x85: 1=A, 2=B, 3=both
-    uint8_t ma_range_high;          // 0x86  MA_RANGE_HIGH: output value when MA knob is at maximum
-    uint8_t ma_range_low;           // 0x87  MA_RANGE_LOW:  output value when MA knob is at minimum
+    uint8_t ma_at_knob_min;         // 0x86  Scaled MA output with the knob at minimum
+    uint8_t ma_at_knob_max;         // 0x87  Scaled MA output with the knob at maximum
     uint8_t routine_timer_lo;       // 0x88
     uint8_t routine_timer_mid;      // 0x89
     uint8_t routine_timer_hi;       // 0x8A
@@ -27,7 +27,7 @@ typedef struct {
     uint8_t gate_value;             // 0x90
     uint8_t gate_want_a;            // 0x91
     uint8_t gate_want_b;            // 0x92
-    uint8_t unused_93;
+    uint8_t burst_pulses_off;       // 0x93  Silent pulse periods between bursts
     uint8_t next_module_timer_cur;  // 0x94
     uint8_t next_module_timer_max;  // 0x95
     uint8_t next_module_select;     // 0x96
@@ -3,11 +3,18 @@
  *
  * Manages the system_config_t singleton that holds all runtime parameters:
  * current mode, power level, per-channel intensity/frequency/width,
- * Multi-Adjust knob value, audio gain, and all 8 advanced settings.
+ * Multi-Adjust knob value, audio gain, all 8 advanced settings and the
+ * split mode selectors.
  *
- * Configuration can be loaded from EEPROM (persistent) or reset to
- * factory defaults. config_apply_to_memory() pushes current values
- * into the MK312BTState struct where the mode engine reads them.
+ * There is no separate EEPROM image in RAM. config_load_from_eeprom()
+ * reads the stored block straight into system_config; config_set() keeps
+ * one dirty bit per field and config_save() writes only those bytes, then
+ * the checksum (and the magic byte if the block was not valid yet).
+ * config_commit() queues one field for config_commit_step(), which the
+ * main loop calls every tick and which starts at most one non-blocking
+ * EEPROM write, so a serial write to an EEPROM register neither stalls
+ * the loop nor saves other fields that are still being edited.
+ * config_apply_to_memory() pushes the base values into the channel blocks.
  */
 
 #include "config.h"
@@ -18,6 +25,31 @@
 #include <string.h>
 
 static system_config_t system_config;  /* The one runtime config instance */
+static uint32_t dirty;                  /* Bit n: field n differs from EEPROM */
+static uint8_t stored_valid;            /* EEPROM block has magic + checksum */
+static uint8_t stored_sum;              /* Checksum of the bytes EEPROM holds */
+static uint32_t commit;                 /* Bit n: config_commit() queued field n */
+static uint8_t sum_pending;             /* stored_sum still to be written */
+static uint8_t magic_pending;           /* Then the magic byte (block was invalid) */
+
+#define CONFIG_CHECKSUM_ADDR    (EEPROM_CONFIG_BASE + 1 + CONFIG_PERSIST_COUNT)
+#define CONFIG_PERSIST_MASK     (((uint32_t)1 << CONFIG_PERSIST_COUNT) - 1)
+
+/* EEPROM address of a config field */
+static uint16_t field_address(uint8_t field) {
+    if (field < CONFIG_PERSIST_COUNT) return EEPROM_CONFIG_BASE + 1 + field;
+    return EEPROM_SPLIT_A_MODE + (field - CONFIG_PERSIST_COUNT);
+}
+
+/* XOR of the magic byte and all checksummed fields, as stored in EEPROM */
+static uint8_t config_checksum(void) {
+    const uint8_t *p = (const uint8_t *)&system_config;
+    uint8_t sum = EEPROM_MAGIC_BYTE;
+    for (uint8_t i = 0; i < CONFIG_PERSIST_COUNT; i++) {
+        sum ^= p[i];
+    }
+    return sum;
+}
 
 /* Initialize config with factory defaults */
 void config_init(void) {
@@ -48,56 +80,119 @@ void config_set_defaults(void) {
     system_config.adv_width = 130;       /* Advanced: width override */
     system_config.adv_pace = 50;         /* Advanced: width cycle speed */
     system_config.favorite_mode = MODE_WAVES;
+    dirty = ((uint32_t)1 << CONFIG_FIELD_COUNT) - 1;
 }
 
 /* Load configuration from EEPROM. Falls back to defaults if EEPROM
  * is blank (no magic byte) or checksum doesn't match. */
 void config_load_from_eeprom(void) {
-    eeprom_config_t eeprom_cfg;
-
-    if (eeprom_load_config(&eeprom_cfg)) {
-        system_config.current_mode = eeprom_cfg.top_mode;
-        system_config.power_level = eeprom_cfg.power_level;
-        system_config.split_mode = eeprom_cfg.split_mode;
-        eeprom_load_split_modes(&system_config.split_a_mode, &system_config.split_b_mode);
-        system_config.intensity_a = eeprom_cfg.intensity_a;
-        system_config.intensity_b = eeprom_cfg.intensity_b;
-        system_config.frequency_a = eeprom_cfg.frequency_a;
-        system_config.frequency_b = eeprom_cfg.frequency_b;
-        system_config.width_a = eeprom_cfg.width_a;
-        system_config.width_b = eeprom_cfg.width_b;
-        system_config.multi_adjust = eeprom_cfg.multi_adjust;
-        system_config.audio_gain = eeprom_cfg.audio_gain;
-        system_config.adv_ramp_level = eeprom_cfg.adv_ramp_level;
-        system_config.adv_ramp_time = eeprom_cfg.adv_ramp_time;
-        system_config.adv_depth = eeprom_cfg.adv_depth;
-        system_config.adv_tempo = eeprom_cfg.adv_tempo;
-        system_config.adv_frequency = eeprom_cfg.adv_frequency;
-        system_config.adv_effect = eeprom_cfg.adv_effect;
-        system_config.adv_width = eeprom_cfg.adv_width;
-        system_config.adv_pace = eeprom_cfg.adv_pace;
-        system_config.favorite_mode = eeprom_cfg.favorite_mode;
-    } else {
+    uint8_t *p = (uint8_t *)&system_config;
+
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        p[i] = mk312bt_eeprom_read_byte(field_address(i));
+    }
+    stored_sum = config_checksum();
+    stored_valid = mk312bt_eeprom_read_byte(EEPROM_CONFIG_BASE) == EEPROM_MAGIC_BYTE &&
+                   mk312bt_eeprom_read_byte(CONFIG_CHECKSUM_ADDR) == stored_sum;
+
+    if (!stored_valid) {
         config_set_defaults();  /* EEPROM invalid - use factory defaults */
+        return;
     }
+    dirty = 0;
+    if (system_config.split_a_mode >= MODE_SPLIT) system_config.split_a_mode = MODE_WAVES;
+    if (system_config.split_b_mode >= MODE_SPLIT) system_config.split_b_mode = MODE_WAVES;
 }
 
-/* Return pointer to the runtime config singleton */
+/* Return pointer to the runtime config singleton. Writers use config_set(). */
 system_config_t* config_get(void) {
     return &system_config;
 }
 
-void config_sync_from_eeprom_config(const eeprom_config_t* ecfg) {
-    system_config.power_level = ecfg->power_level;
-    system_config.audio_gain = ecfg->audio_gain;
-    system_config.adv_ramp_level = ecfg->adv_ramp_level;
-    system_config.adv_ramp_time = ecfg->adv_ramp_time;
-    system_config.adv_depth = ecfg->adv_depth;
-    system_config.adv_tempo = ecfg->adv_tempo;
-    system_config.adv_frequency = ecfg->adv_frequency;
-    system_config.adv_effect = ecfg->adv_effect;
-    system_config.adv_width = ecfg->adv_width;
-    system_config.adv_pace = ecfg->adv_pace;
+void config_set(uint8_t field, uint8_t value) {
+    uint8_t *p = (uint8_t *)&system_config;
+
+    if (field >= CONFIG_FIELD_COUNT || p[field] == value) return;
+    p[field] = value;
+    dirty |= (uint32_t)1 << field;
+}
+
+uint8_t config_is_dirty(void) {
+    return dirty != 0;
+}
+
+/* Write the dirty fields, then the checksum, then the magic byte if the
+ * stored block was invalid. Bytes EEPROM already holds are skipped. */
+void config_save(void) {
+    const uint8_t *p = (const uint8_t *)&system_config;
+    uint8_t block = !stored_valid;
+
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (!(dirty & ((uint32_t)1 << i))) continue;
+        uint16_t addr = field_address(i);
+        if (mk312bt_eeprom_read_byte(addr) != p[i]) {
+            mk312bt_eeprom_write_byte(addr, p[i]);
+        }
+        if (i < CONFIG_PERSIST_COUNT) block = 1;
+    }
+    dirty = 0;
+    commit = 0;
+    if (!block) return;
+
+    stored_sum = config_checksum();
+    sum_pending = 0;
+    magic_pending = 0;
+    mk312bt_eeprom_write_byte(CONFIG_CHECKSUM_ADDR, stored_sum);
+    if (!stored_valid) {
+        mk312bt_eeprom_write_byte(EEPROM_CONFIG_BASE, EEPROM_MAGIC_BYTE);
+        stored_valid = 1;
+    }
+}
+
+/* An invalid block only becomes valid once every checksummed field is
+ * stored, so a commit then queues all of them and the magic byte */
+void config_commit(uint8_t field) {
+    if (field >= CONFIG_FIELD_COUNT) return;
+    commit |= (uint32_t)1 << field;
+    if (!stored_valid && field < CONFIG_PERSIST_COUNT) {
+        commit |= CONFIG_PERSIST_MASK;
+        sum_pending = 1;
+        magic_pending = 1;
+    }
+}
+
+/* Queued fields first, then the checksum, then the magic byte. stored_sum
+ * follows every field written, so the checksum matches what EEPROM holds
+ * even when other fields have unsaved edits in RAM. */
+void config_commit_step(void) {
+    const uint8_t *p = (const uint8_t *)&system_config;
+
+    if (!commit && !sum_pending && !magic_pending) return;
+    if (mk312bt_eeprom_busy()) return;
+
+    if (commit) {
+        uint8_t i = 0;
+        while (!(commit & ((uint32_t)1 << i))) i++;
+        commit &= ~((uint32_t)1 << i);
+        dirty &= ~((uint32_t)1 << i);
+
+        uint16_t addr = field_address(i);
+        uint8_t old = mk312bt_eeprom_read_byte(addr);
+        if (old != p[i]) {
+            mk312bt_eeprom_write_byte_nb(addr, p[i]);
+            if (i < CONFIG_PERSIST_COUNT) {
+                stored_sum ^= old ^ p[i];
+                sum_pending = 1;
+            }
+        }
+    } else if (sum_pending) {
+        mk312bt_eeprom_write_byte_nb(CONFIG_CHECKSUM_ADDR, stored_sum);
+        sum_pending = 0;
+    } else {
+        mk312bt_eeprom_write_byte_nb(EEPROM_CONFIG_BASE, EEPROM_MAGIC_BYTE);
+        magic_pending = 0;
+        stored_valid = 1;
+    }
 }
 
 void config_apply_to_memory(void) {
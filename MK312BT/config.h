@@ -1,15 +1,23 @@
 /*
  * config.h - Runtime Configuration Manager
  *
- * Holds the system_config_t struct with all runtime parameters.
- * Loaded from EEPROM at startup, modified by menus and knobs,
- * and pushed to hardware via config_apply_to_memory().
+ * Holds the system_config_t struct with all user settings. This is the
+ * only copy in RAM: the menu, the serial registers and the mode engine all
+ * read it directly, and every change goes through config_set(), which
+ * marks the field dirty. config_save() writes just the dirty fields back
+ * to EEPROM. config_commit() saves one field in the background instead,
+ * one EEPROM byte per config_commit_step().
+ *
+ * The first CONFIG_PERSIST_COUNT fields are stored in the order of the
+ * checksummed EEPROM block (EEPROM_CONFIG_BASE + 1 ...); the split mode
+ * selectors follow at EEPROM_SPLIT_A_MODE / EEPROM_SPLIT_B_MODE.
  */
 
 #ifndef CONFIG_H
 #define CONFIG_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "eeprom.h"
 
 #ifdef __cplusplus
@@ -19,10 +27,8 @@ extern "C" {
 /* Runtime configuration - all values 0-255 unless noted */
 typedef struct {
     uint8_t current_mode;       /* Active mode (MK312BTMode enum value) */
+    uint8_t favorite_mode;      /* Favourite mode (MK312BTMode enum value) */
     uint8_t power_level;        /* 0=Low, 1=Normal, 2=High */
-    uint8_t split_mode;         /* 0=linked channels, 1=independent */
-    uint8_t split_a_mode;       /* Built-in mode for split channel A (0-16) */
-    uint8_t split_b_mode;       /* Built-in mode for split channel B (0-16) */
     uint8_t intensity_a;        /* Channel A base intensity */
     uint8_t intensity_b;        /* Channel B base intensity */
     uint8_t frequency_a;        /* Channel A base frequency index */
@@ -31,6 +37,7 @@ typedef struct {
     uint8_t width_b;            /* Channel B base pulse width index */
     uint8_t multi_adjust;       /* MA knob position (0-255) */
     uint8_t audio_gain;         /* Audio input gain/sensitivity */
+    uint8_t split_mode;         /* 0=linked channels, 1=independent */
     uint8_t adv_ramp_level;     /* Advanced: ramp target level */
     uint8_t adv_ramp_time;      /* Advanced: ramp duration */
     uint8_t adv_depth;          /* Advanced: intensity depth */
@@ -39,14 +46,24 @@ typedef struct {
     uint8_t adv_effect;         /* Advanced: effect intensity */
     uint8_t adv_width;          /* Advanced: width override */
     uint8_t adv_pace;           /* Advanced: width cycle speed */
-    uint8_t favorite_mode;      /* Favourite mode (protocol mode number) */
+    uint8_t split_a_mode;       /* Built-in mode for split channel A (0-16) */
+    uint8_t split_b_mode;       /* Built-in mode for split channel B (0-16) */
 } system_config_t;
 
+/* Field index (byte offset) for config_set() and the dirty mask */
+#define CONFIG_FIELD(name)      ((uint8_t)offsetof(system_config_t, name))
+#define CONFIG_FIELD_COUNT      ((uint8_t)sizeof(system_config_t))
+#define CONFIG_PERSIST_COUNT    CONFIG_FIELD(split_a_mode)  /* Checksummed block */
+
 void config_init(void);                /* Initialize with factory defaults */
 void config_load_from_eeprom(void);    /* Load from EEPROM (fallback to defaults) */
-void config_set_defaults(void);        /* Reset to factory defaults */
-system_config_t* config_get(void);     /* Get pointer to runtime config */
-void config_sync_from_eeprom_config(const eeprom_config_t* ecfg);
+void config_set_defaults(void);        /* Reset to factory defaults (all dirty) */
+system_config_t* config_get(void);     /* Get pointer to runtime config (read) */
+void config_set(uint8_t field, uint8_t value);  /* Store and mark dirty */
+uint8_t config_is_dirty(void);         /* Any field not yet saved */
+void config_save(void);                /* Write dirty fields to EEPROM */
+void config_commit(uint8_t field);     /* Queue one field for saving */
+void config_commit_step(void);         /* Start the next queued EEPROM write */
 void config_apply_to_memory(void);
 
 #ifdef __cplusplus
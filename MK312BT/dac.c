@@ -27,8 +27,14 @@
 #include "dac.h"
 #include "avr_registers.h"
 #include "MK312BT_Constants.h"
+#include "pulse_gen.h"
 #include <util/delay.h>
 
+#if DOSE_METER_ENABLE
+static uint16_t loaded_a = DAC_MAX_VALUE;   /* Loaded, not yet updated */
+static uint16_t loaded_b = DAC_MAX_VALUE;
+#endif
+
 static inline void dac_cs_low(void) {
     PORTD &= ~(1 << DAC_CS_LD);
 }
@@ -72,25 +78,35 @@ void dac_init(void) {
  * swapped here so that logical channel A maps to physical output A. */
 void dac_write_channel_a(uint16_t value) {
     dac_send_word(DAC_CMD_LOUPB, value);
+    pulse_set_drive_a(value);
 }
 
 void dac_write_channel_b(uint16_t value) {
     dac_send_word(DAC_CMD_LOUPA, value);
+    pulse_set_drive_b(value);
 }
 
 /* Load without updating (for simultaneous update of both channels).
  * DAC-A/B are swapped to match PCB wiring (see dac_write_channel_a). */
 void dac_load_a(uint16_t value) {
     dac_send_word(DAC_CMD_LOAD_B, value);
+#if DOSE_METER_ENABLE
+    loaded_a = value;
+#endif
 }
 
 void dac_load_b(uint16_t value) {
     dac_send_word(DAC_CMD_LOAD_A, value);
+#if DOSE_METER_ENABLE
+    loaded_b = value;
+#endif
 }
 
 /* Update both DAC outputs simultaneously from previously loaded values */
 void dac_update(void) {
     dac_send_word(DAC_CMD_UPDATE, 0);
+    pulse_set_drive_a(loaded_a);
+    pulse_set_drive_b(loaded_b);
 }
 
 /* Atomic update of both channels: load A, load B, then update together */
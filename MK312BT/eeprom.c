@@ -1,12 +1,9 @@
 /*
  * eeprom.c - EEPROM Persistent Storage Driver
  *
- * Low-level EEPROM read/write for the ATmega16's internal 512-byte EEPROM,
- * plus a structured config save/load with magic byte validation and
- * XOR checksum integrity checking.
- *
- * EEPROM layout: eeprom_config_t struct stored at EEPROM_CONFIG_BASE (0x00).
- * First byte is magic (0xA5), last byte is XOR checksum of all preceding bytes.
+ * Low-level EEPROM read/write for the ATmega16's internal 512-byte EEPROM
+ * and the user program slot storage. The settings block at
+ * EEPROM_CONFIG_BASE is read and written field by field by config.c.
  *
  * EEPROM register bits used:
  *   EECR bit 0 (EERE): Read enable - set to trigger read
@@ -15,10 +12,8 @@
  */
 
 #include "eeprom.h"
-#include "MK312BT_Modes.h"
 #include "avr_registers.h"
 #include <avr/wdt.h>
-#include <string.h>
 
 /* Write one byte to EEPROM at the given address.
  * Waits for any previous write to complete, then triggers a new write.
@@ -39,6 +34,29 @@ void mk312bt_eeprom_write_byte(uint16_t address, uint8_t data) {
     while (EECR & (1 << EEWE)) { wdt_reset(); }
 }
 
+/* Start a write without waiting. Returns 0 (nothing done) while the
+ * previous write is still in progress, 1 once the new write has started.
+ * Lets the session recorder stream bytes from the main loop without the
+ * ~8.5 ms stall of mk312bt_eeprom_write_byte(). */
+uint8_t mk312bt_eeprom_write_byte_nb(uint16_t address, uint8_t data) {
+    if (EECR & (1 << EEWE)) return 0;
+
+    EEARL = (uint8_t)(address & 0xFF);
+    EEARH = (uint8_t)(address >> 8);
+    EEDR = data;
+
+    uint8_t sreg = SREG;
+    cli();
+    EECR = (1 << EEMWE);
+    EECR = (1 << EEMWE) | (1 << EEWE);
+    SREG = sreg;
+    return 1;
+}
+
+uint8_t mk312bt_eeprom_busy(void) {
+    return (EECR & (1 << EEWE)) != 0;
+}
+
 /* Read one byte from EEPROM at the given address.
  * Waits for any previous write to complete before reading. */
 uint8_t mk312bt_eeprom_read_byte(uint16_t address) {
@@ -52,94 +70,6 @@ uint8_t mk312bt_eeprom_read_byte(uint16_t address) {
     return EEDR;
 }
 
-/* XOR checksum of all bytes except the last (checksum field itself).
- * Simple integrity check to detect corrupted EEPROM data. */
-static uint8_t eeprom_calculate_checksum(eeprom_config_t *config) {
-    uint8_t checksum = 0;
-    uint8_t *ptr = (uint8_t*)config;
-    uint16_t len = sizeof(eeprom_config_t);
-
-    if (len < 2) return 0;
-    for (uint16_t i = 0; i < len - 1; i++) {
-        checksum ^= ptr[i];
-    }
-
-    return checksum;
-}
-
-/* Save config to EEPROM: set magic byte, compute checksum, write all bytes */
-void eeprom_save_config(eeprom_config_t *config) {
-    config->magic = EEPROM_MAGIC_BYTE;
-    config->checksum = eeprom_calculate_checksum(config);
-
-    uint8_t *ptr = (uint8_t*)config;
-    for (uint16_t i = 0; i < sizeof(eeprom_config_t); i++) {
-        wdt_reset();
-        mk312bt_eeprom_write_byte(EEPROM_CONFIG_BASE + i, ptr[i]);
-    }
-}
-
-/* Load config from EEPROM. Returns 1 on success, 0 if:
- *   - Magic byte doesn't match (EEPROM is blank/uninitialized)
- *   - Checksum doesn't match (EEPROM data is corrupted) */
-uint8_t eeprom_load_config(eeprom_config_t *config) {
-    uint8_t *ptr = (uint8_t*)config;
-
-    for (uint16_t i = 0; i < sizeof(eeprom_config_t); i++) {
-        ptr[i] = mk312bt_eeprom_read_byte(EEPROM_CONFIG_BASE + i);
-    }
-
-    if (config->magic != EEPROM_MAGIC_BYTE) {
-        return 0;  /* Not initialized */
-    }
-
-    uint8_t calculated_checksum = eeprom_calculate_checksum(config);
-    if (calculated_checksum != config->checksum) {
-        return 0;  /* Corrupted */
-    }
-
-    return 1;
-}
-
-/* Initialize config struct with factory default values. */
-void eeprom_init_defaults(eeprom_config_t *config) {
-    memset(config, 0, sizeof(eeprom_config_t));
-
-    config->magic = EEPROM_MAGIC_BYTE;
-    config->top_mode = 0;
-    config->favorite_mode = 0;
-    config->power_level = 1;
-    config->intensity_a = 128;
-    config->intensity_b = 128;
-    config->frequency_a = 5;
-    config->frequency_b = 5;
-    config->width_a = 25;
-    config->width_b = 25;
-    config->multi_adjust = 128;
-    config->audio_gain = 128;
-    config->split_mode = 0;
-    config->adv_ramp_level = 128;
-    config->adv_ramp_time = 0;
-    config->adv_depth = 50;
-    config->adv_tempo = 50;
-    config->adv_frequency = 107;
-    config->adv_effect = 128;
-    config->adv_width = 130;
-    config->adv_pace = 50;
-}
-
-void eeprom_save_split_modes(uint8_t mode_a, uint8_t mode_b) {
-    mk312bt_eeprom_write_byte(EEPROM_SPLIT_A_MODE, mode_a);
-    mk312bt_eeprom_write_byte(EEPROM_SPLIT_B_MODE, mode_b);
-}
-
-void eeprom_load_split_modes(uint8_t *mode_a, uint8_t *mode_b) {
-    uint8_t a = mk312bt_eeprom_read_byte(EEPROM_SPLIT_A_MODE);
-    uint8_t b = mk312bt_eeprom_read_byte(EEPROM_SPLIT_B_MODE);
-    *mode_a = (a < MODE_SPLIT) ? a : 0;
-    *mode_b = (b < MODE_SPLIT) ? b : 0;
-}
-
 static uint16_t user_prog_addr(uint8_t slot) {
     return EEPROM_USER_PROG_BASE + (uint16_t)slot * USER_PROG_SLOT_SIZE;
 }
@@ -1,15 +1,17 @@
 /*
  * eeprom.h - EEPROM Persistent Storage
  *
- * ATmega16 internal EEPROM driver with structured config storage.
- * Uses magic byte (0xA5) and XOR checksum for data integrity.
+ * ATmega16 internal EEPROM driver and storage layout. The settings block
+ * uses a magic byte (0xA6) and XOR checksum for data integrity.
  *
  * EEPROM Memory Layout (512 bytes total):
- *   0x000–0x015  (22B)  eeprom_config_t  - main settings (magic + checksum)
+ *   0x000–0x015  (22B)  settings block   - magic, 20 fields, checksum (config.c)
  *   0x016        (1B)   split_a_mode     - mode number for split channel A
  *   0x017        (1B)   split_b_mode     - mode number for split channel B
  *   0x018–0x01F  (8B)   reserved
  *   0x020–0x0FF  (224B) user programs    - 7 slots × 32 bytes (USER_PROG_SLOT_SIZE)
+ *   0x100–0x103  (4B)   session header   - see session_rec.h
+ *   0x104–0x1FF  (252B) session data     - delta/RLE token stream
  */
 
 #ifndef EEPROM_H
@@ -29,44 +31,23 @@ extern "C" {
 #define USER_PROG_SLOT_SIZE     32
 #define USER_PROG_SLOT_COUNT    7
 
+#define EEPROM_SESSION_BASE     0x100
+#define EEPROM_SESSION_DATA     0x104
+#define EEPROM_SESSION_END      0x200
+
 /* Slot validity marker stored as first byte of each user program slot */
 #define USER_PROG_MAGIC         0xE3
 
-/* Persistent configuration stored in EEPROM. */
-typedef struct {
-    uint8_t magic;
-    uint8_t top_mode;
-    uint8_t favorite_mode;
-    uint8_t power_level;
-    uint8_t intensity_a;
-    uint8_t intensity_b;
-    uint8_t frequency_a;
-    uint8_t frequency_b;
-    uint8_t width_a;
-    uint8_t width_b;
-    uint8_t multi_adjust;
-    uint8_t audio_gain;
-    uint8_t split_mode;
-    uint8_t adv_ramp_level;
-    uint8_t adv_ramp_time;
-    uint8_t adv_depth;
-    uint8_t adv_tempo;
-    uint8_t adv_frequency;
-    uint8_t adv_effect;
-    uint8_t adv_width;
-    uint8_t adv_pace;
-    uint8_t checksum;
-} eeprom_config_t;
+/* Settings block (owned by config.c):
+ *   [0] EEPROM_MAGIC_BYTE, [1..20] system_config_t fields current_mode
+ *   ... adv_pace in struct order, [21] XOR of bytes 0..20.
+ * The split mode selectors at 0x016/0x017 are outside the checksum. */
+#define EEPROM_CONFIG_END       0x018
 
 void    mk312bt_eeprom_write_byte(uint16_t address, uint8_t data);
 uint8_t mk312bt_eeprom_read_byte(uint16_t address);
-void    eeprom_save_config(eeprom_config_t *config);
-uint8_t eeprom_load_config(eeprom_config_t *config);
-void    eeprom_init_defaults(eeprom_config_t *config);
-
-/* Split mode channel selectors */
-void    eeprom_save_split_modes(uint8_t mode_a, uint8_t mode_b);
-void    eeprom_load_split_modes(uint8_t *mode_a, uint8_t *mode_b);
+uint8_t mk312bt_eeprom_write_byte_nb(uint16_t address, uint8_t data);  /* 0 = busy */
+uint8_t mk312bt_eeprom_busy(void);     /* A write is still in progress */
 
 /* User program slot API.
  * slot: 0–6 (USER_PROG_SLOT_COUNT-1)
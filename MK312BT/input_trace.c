@@ -0,0 +1,61 @@
+/*
+ * input_trace.c - On-Device Input Trace
+ *
+ * See input_trace.h. The whole module is compiled out unless
+ * INPUT_TRACE_ENABLE is set in MK312BT_Constants.h.
+ *
+ * The ring is read back through the virtual register map
+ * (VIRT_RAM_TRACE_BASE, VIRT_RAM_TRACE_HEAD) and converted to a replay
+ * log by Host/tools/trace_to_replay.py.
+ */
+
+#include "input_trace.h"
+
+#if INPUT_TRACE_ENABLE
+
+#include "param_engine.h"
+#include "avr_registers.h"
+
+input_trace_entry_t input_trace_ring[INPUT_TRACE_DEPTH];
+uint8_t input_trace_head;
+
+/* Last logged 8-bit value per knob kind (LEVEL_A, LEVEL_B, MA) */
+static uint8_t knob_last[3];
+static uint8_t knob_seen;      /* Bit n set once knob n has been logged */
+static uint8_t buttons_last;
+
+/* Called from the USART RX ISR as well as the main loop */
+void input_trace_log(uint8_t kind, uint8_t value) {
+    uint8_t sreg = SREG;
+    cli();
+    input_trace_entry_t *e = &input_trace_ring[input_trace_head & (INPUT_TRACE_DEPTH - 1)];
+    e->tick  = (uint16_t)param_engine_get_tick_total();
+    e->kind  = kind;
+    e->value = value;
+    input_trace_head++;
+    SREG = sreg;
+}
+
+void input_trace_knob(uint8_t kind, uint16_t adc) {
+    uint8_t n = kind - INPUT_TRACE_LEVEL_A;
+    uint8_t v = (uint8_t)(adc >> 2);
+    uint8_t diff = (v > knob_last[n]) ? v - knob_last[n] : knob_last[n] - v;
+    if ((knob_seen & (1 << n)) && diff < INPUT_TRACE_KNOB_HYST) return;
+    knob_seen |= (1 << n);
+    knob_last[n] = v;
+    input_trace_log(kind, v);
+}
+
+void input_trace_buttons(uint8_t mask) {
+    if (mask == buttons_last) return;
+    buttons_last = mask;
+    input_trace_log(INPUT_TRACE_BUTTONS, mask);
+}
+
+void input_trace_clear(void) {
+    input_trace_head = 0;
+    knob_seen = 0;
+    buttons_last = 0;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * input_trace.h - On-Device Input Trace
+ *
+ * Optional RAM ring of external inputs stamped with the engine tick, so a
+ * session seen in the field can be dumped over serial and replayed in the
+ * Linux-native build (Host/sim). Compiled in only with INPUT_TRACE_ENABLE;
+ * otherwise the hooks expand to nothing.
+ *
+ * Entry layout (4 bytes, little-endian tick):
+ *   [tick_lo][tick_hi][kind][value]
+ *
+ * Knob values are logged as 8-bit (ADC >> 2) with a small hysteresis so
+ * pot noise does not flood the ring. Audio samples change every read and
+ * are left to the host recorder.
+ */
+
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <stdint.h>
+#include "MK312BT_Constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entry kinds */
+#define INPUT_TRACE_RX        0x01  /* Serial byte received */
+#define INPUT_TRACE_LEVEL_A   0x02  /* Level pot A (ADC >> 2) */
+#define INPUT_TRACE_LEVEL_B   0x03  /* Level pot B (ADC >> 2) */
+#define INPUT_TRACE_MA        0x04  /* Multi-Adjust knob (ADC >> 2) */
+#define INPUT_TRACE_BUTTONS   0x05  /* Pressed-button mask, bit n = PC(4+n) */
+#define INPUT_TRACE_SEED_LO   0x06  /* PRNG seed low byte */
+#define INPUT_TRACE_SEED_HI   0x07  /* PRNG seed high byte */
+
+#define INPUT_TRACE_KNOB_HYST 2     /* Minimum 8-bit change worth logging */
+
+#if INPUT_TRACE_ENABLE
+
+typedef struct {
+    uint16_t tick;    /* param_engine_get_tick_total(), low 16 bits */
+    uint8_t  kind;
+    uint8_t  value;
+} input_trace_entry_t;
+
+extern input_trace_entry_t input_trace_ring[INPUT_TRACE_DEPTH];
+extern uint8_t input_trace_head;   /* Entries written since clear (wraps) */
+
+void input_trace_log(uint8_t kind, uint8_t value);   /* ISR-safe */
+void input_trace_knob(uint8_t kind, uint16_t adc);  /* Logs on change */
+void input_trace_buttons(uint8_t mask);             /* Logs on change */
+void input_trace_clear(void);
+
+#else
+
+#define input_trace_log(kind, value)  ((void)0)
+#define input_trace_knob(kind, adc)   ((void)0)
+#define input_trace_buttons(mask)     ((void)0)
+#define input_trace_clear()           ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,12 +6,47 @@
  *
  * Each timer ISR implements a 5-phase state machine:
  *   GAP -> POSITIVE -> DEADTIME1 -> NEGATIVE -> DEADTIME2 -> GAP
+ * or, for a monophasic pulse:
+ *   GAP -> POSITIVE -> GAP
  *
  * Dead time (4 us) between polarity transitions prevents H-bridge
  * shoot-through (both FETs conducting simultaneously).
  *
  * Timer1 is 16-bit so full period fits in one OCR1A load.
  * Timer2 is 8-bit so long gaps (>250 us) use gap_remaining counter.
+ *
+ * In CTC mode a compare match comes OCR + 1 ticks after the previous one
+ * (the counter clears on the tick after the match), so every phase loads
+ * its duration minus one. The phases then add up to exactly period_ticks.
+ *
+ * Pulse-count gating is decided once per period at the start of PH_GAP:
+ * a silent period keeps the bridge off for period_ticks and stays in
+ * PH_GAP, so burst timing follows the pulse train exactly.
+ *
+ * The per-pulse width is fixed when a pulse starts (pulse_mod_width) and
+ * used for both half-cycles and the gap. The lookup has no loop and at
+ * most two clamps: 48 cycles (6 us) from the edge to the OCR load (figures
+ * below), less when the table is off.
+ * It runs after the FET turns on, so the pulse edge does not move.
+ *
+ * Polarity (pulse_polarity) is also decided per pulse in PH_GAP, before
+ * the edge: about 15 cycles, the same for every pulse, so the period does
+ * not jitter. PULSE_POL_ALT flips on every pulse in the ISR itself. A
+ * monophasic pulse loads the gap at the end of PH_POSITIVE, skipping the
+ * dead times and the second half-cycle; the gap grows by their length so
+ * the period stays period_ticks.
+ *
+ * The dose meter (pulse_dose, DOSE_METER_ENABLE builds) books each pulse
+ * once, with its scheduled on-time, as its gap starts: at the end of
+ * PH_DEADTIME2, or PH_POSITIVE for a monophasic pulse, after the gap is
+ * loaded. Nothing is booked on the way to the edge or inside the
+ * half-cycles.
+ *
+ * Longest PH_GAP pass, cycles from ISR entry (clang AVR -Os listing,
+ * ATmega16 timings, +7 for the response and vector jump):
+ *   A: edge 178, OCR1A load 226, RETI 272 (395 with the booking here)
+ *   B: edge 201, OCR2 load 262, RETI 308 (490 with the booking here)
+ * The gap-start pass that now books the pulse is 252 cycles on A.
  */
 
 #include <avr/interrupt.h>
@@ -43,12 +78,147 @@ static inline void ch_b_negative(void) {
     PORTB = (PORTB & ~(1 << HBRIDGE_CH_B_POS)) | (1 << HBRIDGE_CH_B_NEG);
 }
 
-/* Set 16-bit OCR1A (must write high byte first on ATmega16) */
-static inline void set_ocr1a(uint16_t val) {
+static inline void ch_a_drive(uint8_t neg) {
+    if (neg) ch_a_negative();
+    else     ch_a_positive();
+}
+
+static inline void ch_b_drive(uint8_t neg) {
+    if (neg) ch_b_negative();
+    else     ch_b_positive();
+}
+
+/* Set the next Timer1 phase length in ticks (16-bit OCR1A, high byte
+ * first on ATmega16) */
+static inline void set_ocr1a(uint16_t ticks) {
+    uint16_t val = ticks - 1;
     OCR1AH = (uint8_t)(val >> 8);
     OCR1AL = (uint8_t)(val & 0xFF);
 }
 
+/* Set the next Timer2 phase length in ticks (1-256) */
+static inline void set_ocr2(uint16_t ticks) {
+    OCR2 = (uint8_t)(ticks - 1);
+}
+
+/* Load a Timer2 gap, split into 250 us chunks via gap_remaining */
+static inline void set_gap_b(uint16_t gap) {
+    if (gap <= 250) {
+        set_ocr2(gap);
+        pulse_ch_b.gap_remaining = 0;
+    } else {
+        set_ocr2(250);
+        pulse_ch_b.gap_remaining = gap - 250;
+    }
+}
+
+/* Gap that completes the period after `used` ticks of pulse and dead time */
+static inline uint16_t pulse_gap(volatile ChannelPulseState *ch, uint16_t used) {
+    if (ch->period_ticks > used)
+        return ch->period_ticks - used;
+    return DEAD_TIME_TICKS;
+}
+
+/* Polarity of the pulse that is starting: pulse_neg = first half-cycle on
+ * Gate-, pulse_mono = no second half-cycle */
+static inline void pulse_polarity(volatile ChannelPulseState *ch) {
+    uint8_t pol = ch->polarity;
+    uint8_t neg = (pol & PULSE_POL_INV) ? 1 : 0;
+
+    if (pol & PULSE_POL_ALT) {
+        neg ^= ch->alt_flip;
+        ch->alt_flip ^= 1;
+    }
+    switch (pol & (PULSE_POL_NEG | PULSE_POL_POS)) {
+        case PULSE_POL_NEG:
+            neg ^= 1;
+            /* fall through */
+        case PULSE_POL_POS:
+            ch->pulse_mono = 1;
+            break;
+        default:
+            ch->pulse_mono = 0;
+            break;
+    }
+    ch->pulse_neg = neg;
+}
+
+/* One pulse period is starting with the gate on: returns 1 if it falls in
+ * the silent part of a burst. New counts are only taken when a burst
+ * starts, so a burst in progress keeps its length. */
+static inline uint8_t burst_silent(volatile ChannelPulseState *ch) {
+    if (ch->burst_left == 0) {
+        if (!ch->burst_idle && ch->burst_on && ch->burst_off) {
+            ch->burst_idle = 1;
+            ch->burst_left = ch->burst_off;
+        } else {
+            ch->burst_on = ch->pending_burst_on;
+            ch->burst_off = ch->pending_burst_off;
+            ch->burst_idle = 0;
+            ch->burst_left = ch->burst_on;
+            if (ch->burst_left == 0) return 0;      // No pulse-count gating
+            ch->mod_index = 0;                      // Each burst replays the table
+        }
+    }
+    ch->burst_left--;
+    return ch->burst_idle;
+}
+
+#if DOSE_METER_ENABLE
+/* Book the pulse that has just ended, as its gap starts: count, on-time
+ * per polarity and on-time times drive. mono is a constant at each call
+ * site. energy_frac carries the part below 1 us at full scale from pulse
+ * to pulse; pulse_dose_seq tells the main loop's reader a pulse landed. */
+static inline void pulse_dose(volatile ChannelPulseState *ch, volatile pulse_dose_t *d,
+                              uint8_t mono) {
+    uint8_t w = ch->pulse_width;
+    uint16_t half = (uint16_t)w * ch->drive;
+    uint16_t e = ch->energy_frac + half;
+    uint16_t add = e >> 8;
+
+    d->pulses++;
+    if (mono) {
+        if (ch->pulse_neg) d->on_neg_us += w;
+        else               d->on_pos_us += w;
+    } else {
+        d->on_pos_us += w;
+        d->on_neg_us += w;
+        e = (uint8_t)e + half;
+        add += e >> 8;
+    }
+    ch->energy_frac = (uint8_t)e;
+    d->energy += add;
+    pulse_dose_seq++;
+}
+#else
+#define pulse_dose(ch, d, mono)  ((void)0)
+#endif
+
+/* Gate off: the next gate-on starts a full burst */
+static inline void burst_restart(volatile ChannelPulseState *ch) {
+    ch->burst_left = 0;
+    ch->burst_idle = 1;
+    ch->mod_index = 0;
+}
+
+/* Width of the pulse that is starting: width_ticks plus the next table
+ * offset, clamped to PULSE_WIDTH_MIN..255 */
+static inline uint8_t pulse_mod_width(volatile ChannelPulseState *ch,
+                                      volatile pulse_mod_t *m) {
+    uint8_t len = m->len;
+    if (len == 0) return ch->width_ticks;
+    if (len > PULSE_MOD_STEPS) len = PULSE_MOD_STEPS;
+
+    uint8_t i = ch->mod_index;
+    if (i >= len) i = 0;
+    ch->mod_index = i + 1;
+
+    int16_t w = (int16_t)ch->width_ticks + m->step[i];
+    if (w < PULSE_WIDTH_MIN) return PULSE_WIDTH_MIN;
+    if (w > 255) return 255;
+    return (uint8_t)w;
+}
+
 /*
  * Timer1 Compare Match A - Channel A Biphasic Pulse Generator
  *
@@ -61,27 +231,41 @@ ISR(TIMER1_COMPA_vect) {
             if (pulse_ch_a.params_dirty) {
                 pulse_ch_a.width_ticks = pulse_ch_a.pending_width;
                 pulse_ch_a.period_ticks = pulse_ch_a.pending_period;
+                pulse_ch_a.polarity = pulse_ch_a.pending_polarity;
                 pulse_ch_a.params_dirty = 0;
             }
             if (!pulse_ch_a.gate) {
                 ch_a_all_off();
                 set_ocr1a(250);
+                burst_restart(&pulse_ch_a);
+                return;
+            }
+            if (burst_silent(&pulse_ch_a)) {
+                set_ocr1a(pulse_ch_a.period_ticks);
                 return;
             }
-            ch_a_positive();
-            set_ocr1a(pulse_ch_a.width_ticks);
+            pulse_polarity(&pulse_ch_a);
+            ch_a_drive(pulse_ch_a.pulse_neg);
+            pulse_ch_a.pulse_width = pulse_mod_width(&pulse_ch_a, &pulse_mod_a);
+            set_ocr1a(pulse_ch_a.pulse_width);
             pulse_ch_a.phase = PH_POSITIVE;
             break;
 
         case PH_POSITIVE:
-            ch_a_all_off();               // End positive, start dead time
+            ch_a_all_off();               // End first half-cycle
+            if (pulse_ch_a.pulse_mono) {
+                set_ocr1a(pulse_gap(&pulse_ch_a, pulse_ch_a.pulse_width));
+                pulse_ch_a.phase = PH_GAP;
+                pulse_dose(&pulse_ch_a, &pulse_dose_a, 1);
+                break;
+            }
             set_ocr1a(DEAD_TIME_TICKS);
             pulse_ch_a.phase = PH_DEADTIME1;
             break;
 
         case PH_DEADTIME1:
-            ch_a_negative();              // Start negative half-cycle
-            set_ocr1a(pulse_ch_a.width_ticks);
+            ch_a_drive(!pulse_ch_a.pulse_neg);  // Start second half-cycle
+            set_ocr1a(pulse_ch_a.pulse_width);
             pulse_ch_a.phase = PH_NEGATIVE;
             break;
 
@@ -91,21 +275,13 @@ ISR(TIMER1_COMPA_vect) {
             pulse_ch_a.phase = PH_DEADTIME2;
             break;
 
-        case PH_DEADTIME2: {
-            /* Calculate remaining gap time:
-             * gap = period - 2*width - 2*dead_time */
-            uint16_t used = (uint16_t)pulse_ch_a.width_ticks * 2 +
-                            DEAD_TIME_TICKS * 2;
-            uint16_t gap;
-            if (pulse_ch_a.period_ticks > used)
-                gap = pulse_ch_a.period_ticks - used;
-            else
-                gap = DEAD_TIME_TICKS;
-
-            set_ocr1a(gap);
+        case PH_DEADTIME2:
+            /* Remaining gap: period - 2*width - 2*dead_time */
+            set_ocr1a(pulse_gap(&pulse_ch_a, (uint16_t)pulse_ch_a.pulse_width * 2 +
+                                             DEAD_TIME_TICKS * 2));
             pulse_ch_a.phase = PH_GAP;
+            pulse_dose(&pulse_ch_a, &pulse_dose_a, 0);
             break;
-        }
     }
 }
 
@@ -122,63 +298,67 @@ ISR(TIMER2_COMP_vect) {
             if (pulse_ch_b.gap_remaining > 0) {
                 uint16_t chunk = pulse_ch_b.gap_remaining;
                 if (chunk > 250) chunk = 250;
-                OCR2 = (uint8_t)chunk;
+                set_ocr2(chunk);
                 pulse_ch_b.gap_remaining -= chunk;
                 return;
             }
             if (pulse_ch_b.params_dirty) {
                 pulse_ch_b.width_ticks = pulse_ch_b.pending_width;
                 pulse_ch_b.period_ticks = pulse_ch_b.pending_period;
+                pulse_ch_b.polarity = pulse_ch_b.pending_polarity;
                 pulse_ch_b.params_dirty = 0;
             }
             if (!pulse_ch_b.gate) {
                 ch_b_all_off();
-                OCR2 = 250;
+                set_ocr2(250);
+                burst_restart(&pulse_ch_b);
                 return;
             }
-            ch_b_positive();
-            OCR2 = pulse_ch_b.width_ticks;
+            if (burst_silent(&pulse_ch_b)) {
+                uint16_t chunk = pulse_ch_b.period_ticks;
+                if (chunk > 250) chunk = 250;
+                set_ocr2(chunk);
+                pulse_ch_b.gap_remaining = pulse_ch_b.period_ticks - chunk;
+                return;
+            }
+            pulse_polarity(&pulse_ch_b);
+            ch_b_drive(pulse_ch_b.pulse_neg);
+            pulse_ch_b.pulse_width = pulse_mod_width(&pulse_ch_b, &pulse_mod_b);
+            set_ocr2(pulse_ch_b.pulse_width);
             pulse_ch_b.phase = PH_POSITIVE;
             break;
 
         case PH_POSITIVE:
             ch_b_all_off();
-            OCR2 = DEAD_TIME_TICKS;
+            if (pulse_ch_b.pulse_mono) {
+                set_gap_b(pulse_gap(&pulse_ch_b, pulse_ch_b.pulse_width));
+                pulse_ch_b.phase = PH_GAP;
+                pulse_dose(&pulse_ch_b, &pulse_dose_b, 1);
+                break;
+            }
+            set_ocr2(DEAD_TIME_TICKS);
             pulse_ch_b.phase = PH_DEADTIME1;
             break;
 
         case PH_DEADTIME1:
-            ch_b_negative();
-            OCR2 = pulse_ch_b.width_ticks;
+            ch_b_drive(!pulse_ch_b.pulse_neg);
+            set_ocr2(pulse_ch_b.pulse_width);
             pulse_ch_b.phase = PH_NEGATIVE;
             break;
 
         case PH_NEGATIVE:
             ch_b_all_off();
-            OCR2 = DEAD_TIME_TICKS;
+            set_ocr2(DEAD_TIME_TICKS);
             pulse_ch_b.phase = PH_DEADTIME2;
             break;
 
-        case PH_DEADTIME2: {
+        case PH_DEADTIME2:
             /* Calculate gap, split into 250 us chunks if needed */
-            uint16_t used = (uint16_t)pulse_ch_b.width_ticks * 2 +
-                            DEAD_TIME_TICKS * 2;
-            uint16_t gap;
-            if (pulse_ch_b.period_ticks > used)
-                gap = pulse_ch_b.period_ticks - used;
-            else
-                gap = DEAD_TIME_TICKS;
-
-            if (gap <= 250) {
-                OCR2 = (uint8_t)gap;
-                pulse_ch_b.gap_remaining = 0;
-            } else {
-                OCR2 = 250;
-                pulse_ch_b.gap_remaining = gap - 250;
-            }
+            set_gap_b(pulse_gap(&pulse_ch_b, (uint16_t)pulse_ch_b.pulse_width * 2 +
+                                             DEAD_TIME_TICKS * 2));
             pulse_ch_b.phase = PH_GAP;
+            pulse_dose(&pulse_ch_b, &pulse_dose_b, 0);
             break;
-        }
     }
 }
 
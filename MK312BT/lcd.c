@@ -10,13 +10,35 @@
  *   PC7-PC4: LCD_DB7-DB4 (shared with Menu/Up/OK/Down buttons)
  *   PC3:     LCD_RS (Register Select: 0=command, 1=data)
  *   PC2:     LCD_E  (Enable strobe)
- *   PC1:     LCD_RW (Read/Write: always 0 for write-only)
+ *   PC1:     LCD_RW (Read/Write: 0=write, 1=busy-flag read)
  *   PC0:     Button activate (active-high enables button pull-ups)
  *
  * Backlight: PD7 (LCD_BACKLIGHT_BIT)
  *
  * The 4-bit init sequence follows the HD44780 datasheet:
  * three 0x30 commands at specific intervals, then 0x20 to enter 4-bit mode.
+ *
+ * Write pacing (LCD_USE_BUSY_FLAG in MK312BT_Constants.h):
+ *   0: fixed datasheet worst case, 100 us after every nibble and 2 ms
+ *      after Clear/Home.
+ *   1: before each byte the busy flag (DB7) is polled with RW=1, so a
+ *      byte costs roughly the controller's real execution time instead of
+ *      the worst case. The read only happens while PC0 is low, i.e.
+ *      inside the lcd_disable_buttons() bracket, so the buttons cannot
+ *      drive PC4-PC7 while the LCD does. If the flag never clears within
+ *      LCD_BUSY_TIMEOUT_POLLS the panel is treated as write-only for the
+ *      rest of the session and the fixed delays are used instead.
+ *
+ * Measured in the host sim (smoke.scn trace, time between LCD data bytes;
+ * the sim charges the _delay_us() calls but not the port I/O around them):
+ *   LCD_USE_BUSY_FLAG=1      46 us per character (41 us data write + one
+ *                            3 us poll of slack + 2 us of nibble strobes)
+ *   LCD_USE_BUSY_FLAG=0     202 us per character
+ *   1, --lcd-stuck         one 3.8 ms stall (600 polls x 3 us + 2 ms) at
+ *                            the first byte, then 202 us per character
+ * On the target a poll also costs ~41 cycles of port I/O (clang AVR
+ * listing of lcd_send_byte), about 8 us per poll in total, so the timeout
+ * takes ~4.9 ms + 2 ms once. Clear/Home (1.52 ms) finishes in 190 polls.
  */
 
 #include "lcd.h"
@@ -25,11 +47,23 @@
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 
+#if LCD_USE_BUSY_FLAG
+/* Set once the controller is in 4-bit mode and the busy flag can be read.
+ * Cleared for good if a poll ever times out (RW not wired, no panel). */
+static uint8_t lcd_busy_flag_ok = 0;
+#endif
+
 /* Strobe the Enable pin to latch data on the LCD */
 static void lcd_pulse_enable(void) {
     PORTC |= (1 << LCD_E_BIT);
     _delay_us(1);
     PORTC &= ~(1 << LCD_E_BIT);
+#if LCD_USE_BUSY_FLAG
+    if (lcd_busy_flag_ok) {
+        _delay_us(1);               /* E cycle time >= 1 us, BF covers the rest */
+        return;
+    }
+#endif
     _delay_us(100);
 }
 
@@ -39,9 +73,54 @@ static void lcd_write_nibble(uint8_t nibble) {
     lcd_pulse_enable();
 }
 
+#if LCD_USE_BUSY_FLAG
+/* Read the busy flag (DB7 of the high nibble) with RW=1, RS=0.
+ * Called with PC0 low, so the button matrix is disconnected and only
+ * the LCD drives PC4-PC7. The pull-ups stay on: an absent or write-only
+ * panel reads as permanently busy and trips the timeout. Both nibbles
+ * are clocked out to keep the controller's 4-bit read phase aligned. */
+static uint8_t lcd_read_busy(void) {
+    uint8_t busy;
+
+    PORTC &= ~((1 << LCD_RS_BIT) | (1 << BUTTON_ACTIVATE_BIT));
+    DDRC &= ~LCD_DATA_MASK;
+    PORTC |= LCD_DATA_MASK;
+    PORTC |= (1 << LCD_RW_BIT);
+
+    PORTC |= (1 << LCD_E_BIT);
+    _delay_us(1);
+    busy = PINC & (1 << LCD_DB7_BIT);
+    PORTC &= ~(1 << LCD_E_BIT);
+    _delay_us(1);
+    PORTC |= (1 << LCD_E_BIT);
+    _delay_us(1);
+    PORTC &= ~(1 << LCD_E_BIT);
+
+    PORTC &= ~(1 << LCD_RW_BIT);
+    PORTC &= ~LCD_DATA_MASK;
+    DDRC |= LCD_DATA_MASK;
+    return busy;
+}
+
+/* Poll until the controller is idle. On timeout fall back to the fixed
+ * worst-case delay once and stop polling for the rest of the session. */
+static void lcd_wait_ready(void) {
+    if (!lcd_busy_flag_ok) return;
+
+    for (uint16_t polls = 0; polls < LCD_BUSY_TIMEOUT_POLLS; polls++) {
+        if (!lcd_read_busy()) return;
+    }
+    lcd_busy_flag_ok = 0;
+    _delay_ms(2);
+}
+#endif
+
 /* Send a full byte to the LCD as two nibbles.
  * rs=0 for command, rs=1 for data. High nibble sent first. */
 static void lcd_send_byte(uint8_t value, uint8_t rs) {
+#if LCD_USE_BUSY_FLAG
+    lcd_wait_ready();
+#endif
     if (rs) {
         PORTC |= (1 << LCD_RS_BIT);      /* RS=1: data register */
     } else {
@@ -53,9 +132,13 @@ static void lcd_send_byte(uint8_t value, uint8_t rs) {
     lcd_write_nibble((value << 4) & 0xF0); /* Low nibble second */
 }
 
-/* Send a command byte (RS=0). Clear and Home commands need extra delay. */
+/* Send a command byte (RS=0). Clear and Home commands need extra delay,
+ * unless the busy flag is being polled before the next byte. */
 static void lcd_command(uint8_t cmd) {
     lcd_send_byte(cmd, 0);
+#if LCD_USE_BUSY_FLAG
+    if (lcd_busy_flag_ok) return;
+#endif
     if (cmd == LCD_CLEAR || cmd == LCD_RETURN_HOME) {
         _delay_ms(2);
     }
@@ -89,7 +172,7 @@ void lcd_enable_buttons(void) {
 void initialize_lcd(void) {
     DDRC |= (1 << BUTTON_ACTIVATE_BIT);
     DDRC |= (1 << LCD_RW_BIT);
-    PORTC &= ~(1 << LCD_RW_BIT);  /* RW always low (write-only) */
+    PORTC &= ~(1 << LCD_RW_BIT);  /* RW low except during busy-flag reads */
 
     lcd_disable_buttons();
 
@@ -112,6 +195,10 @@ void initialize_lcd(void) {
 
     _delay_us(150);
 
+#if LCD_USE_BUSY_FLAG
+    lcd_busy_flag_ok = 1;         /* 4-bit interface is up: BF reads are valid */
+#endif
+
     lcd_command(LCD_4BIT_MODE);   /* 4-bit, 2-line, 5x8 font (0x28) */
     lcd_command(LCD_DISPLAY_ON);  /* Display on, cursor off (0x0C) */
     lcd_command(LCD_CLEAR);       /* Clear display (0x01) */
@@ -163,6 +250,10 @@ void lcd_write_string_raw(const char *str) {
     }
 }
 
+void lcd_write_char_raw(uint8_t c) {
+    lcd_data(c);
+}
+
 void lcd_write_custom_char_raw(uint8_t location) {
     lcd_data(location & 0x07);
 }
@@ -27,6 +27,7 @@ void lcd_disable_buttons(void);                               /* Switch PORTC to
 void lcd_backlight_on(void);                                  /* PD7 high */
 void lcd_command_raw(uint8_t cmd);
 void lcd_write_string_raw(const char *str);
+void lcd_write_char_raw(uint8_t c);
 void lcd_write_custom_char_raw(uint8_t location);
 void lcd_set_cursor_raw(uint8_t col, uint8_t row);
 
@@ -0,0 +1,121 @@
+/*
+ * lcd_fb.c - Host Text Framebuffer for the LCD
+ *
+ * One range [dirty_lo, dirty_hi) covers the characters the panel does
+ * not show yet; characters inside it that did not change are sent again,
+ * which costs less than a bit per position. The flush sends the range in
+ * order and sets the DDRAM address only at the start of a pass and where
+ * it crosses into row 1, so a full row costs 16 data and 4 address writes
+ * over four loop passes. The range is only touched from the main loop
+ * (serial_process() and the flush), so no interrupt masking is needed.
+ */
+
+#include "lcd_fb.h"
+#include "lcd.h"
+#include <string.h>
+
+lcd_fb_t lcd_fb;
+
+static uint8_t dirty_lo;            /* First position not on the panel yet */
+static uint8_t dirty_hi;            /* One past the last, == dirty_lo: none */
+static uint8_t owned;               /* Host owns the panel */
+
+/* Take the panel on the first host write. The menu's lines are in the
+ * buffer, so it starts blank and everything is redrawn. */
+static void take(void) {
+    if (owned) return;
+    owned = 1;
+    memset(lcd_fb.text, ' ', LCD_FB_SIZE);
+    dirty_lo = 0;
+    dirty_hi = LCD_FB_SIZE;
+}
+
+static void store(uint8_t pos, uint8_t c) {
+    pos &= LCD_FB_SIZE - 1;
+    if (lcd_fb.text[pos] != c) {
+        lcd_fb.text[pos] = c;
+        if (dirty_lo == dirty_hi) {
+            dirty_lo = pos;
+            dirty_hi = pos + 1;
+        } else if (pos < dirty_lo) {
+            dirty_lo = pos;
+        } else if (pos >= dirty_hi) {
+            dirty_hi = pos + 1;
+        }
+    }
+}
+
+void lcd_fb_init(void) {
+    memset(lcd_fb.text, ' ', LCD_FB_SIZE);
+    lcd_fb.pos = 0;
+    lcd_fb.arg = 0;
+    dirty_lo = dirty_hi = 0;
+    owned = 0;
+}
+
+void lcd_fb_write(uint8_t pos, const uint8_t *text, uint8_t len) {
+    take();
+    while (len--) {
+        store(pos++, *text++);
+    }
+}
+
+void lcd_fb_put(uint8_t c) {
+    take();
+    store(lcd_fb.pos, c);
+    lcd_fb.pos = (lcd_fb.pos + 1) & (LCD_FB_SIZE - 1);
+}
+
+void lcd_fb_put_number(uint8_t value) {
+    lcd_fb_put(value >= 100 ? '0' + value / 100 : ' ');
+    lcd_fb_put(value >= 10 ? '0' + (value / 10) % 10 : ' ');
+    lcd_fb_put('0' + value % 10);
+}
+
+void lcd_fb_control(uint8_t ctrl) {
+    if (ctrl & LCD_FB_CTRL_CLEAR) {
+        for (uint8_t i = 0; i < LCD_FB_SIZE; i++) store(i, ' ');
+        lcd_fb.pos = 0;
+    }
+    if (ctrl & LCD_FB_CTRL_HOST) {
+        take();
+    } else if (ctrl == 0) {
+        lcd_fb_release();           /* CLEAR alone keeps the owner */
+    }
+}
+
+uint8_t lcd_fb_owned(void) {
+    return owned;
+}
+
+uint8_t lcd_fb_pending(void) {
+    return dirty_hi - dirty_lo;
+}
+
+/* The menu redraws its main screen from a cleared panel within 200 ms,
+ * formatting its lines over the host text. */
+void lcd_fb_release(void) {
+    if (!owned) return;
+    owned = 0;
+    dirty_lo = dirty_hi = 0;
+    lcd_clear();
+}
+
+void lcd_fb_flush(void) {
+    if (!owned || dirty_lo == dirty_hi) return;
+
+    uint8_t i = dirty_lo;
+    uint8_t end = dirty_lo + LCD_FB_FLUSH_CHARS;
+    if (end > dirty_hi) end = dirty_hi;
+
+    lcd_disable_buttons();
+    lcd_set_cursor_raw(i % LCD_FB_COLS, i / LCD_FB_COLS);
+    for (; i < end; i++) {
+        if (i == LCD_FB_COLS && i != dirty_lo) lcd_set_cursor_raw(0, 1);  /* Row 1 is not contiguous */
+        lcd_write_char_raw(lcd_fb.text[i]);
+    }
+    lcd_enable_buttons();
+
+    dirty_lo = end;
+    if (dirty_lo == dirty_hi) dirty_lo = dirty_hi = 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * lcd_fb.h - Host Text Framebuffer for the LCD
+ *
+ * Text from the host lands in a 32-character framebuffer (row 0 at
+ * positions 0-15, row 1 at 16-31), never on the panel directly. Each
+ * write marks the characters it changed, and lcd_fb_flush(), called
+ * every main loop pass, sends at most LCD_FB_FLUSH_CHARS of them to the
+ * HD44780. A whole screen therefore reaches the panel over a few loop
+ * passes, and serial_process() never waits on the LCD bus.
+ *
+ * The first write takes the panel from the menu: the main screen stops
+ * refreshing and the framebuffer, blanked to spaces, is shown. A button
+ * press, the EXIT_MENU / MAIN_MENU box commands or LCD_CTRL = 0 hand it
+ * back. The menu formats its two lines in the same 34 bytes (it only
+ * draws while it owns the panel), so the host text does not survive the
+ * hand-back and the framebuffer registers read the menu's scratch lines
+ * while the menu owns the panel.
+ *
+ * Serial access (register_map.def, SERIAL_PROTOCOL.md "LCD Text"):
+ *   0x4220-0x423F  framebuffer (read-only, writes must mark the panel)
+ *   0x4240         LCD_POS: cursor of the box commands, 0-31
+ *   0x4241         LCD_ARG: argument of the box commands
+ *   0x4242         LCD_CTRL: LCD_FB_CTRL_* bits
+ *   0x4243         LCD_PENDING: characters not yet on the panel
+ *   box commands   WRITE_CHAR, WRITE_NUM, WRITE_STR, SET_POS
+ *   LCD_WRITE frame (serial.h) writes up to 16 characters at once
+ */
+
+#ifndef LCD_FB_H
+#define LCD_FB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_FB_COLS         16
+#define LCD_FB_SIZE         32     /* Two rows */
+#define LCD_FB_FLUSH_CHARS  4      /* Panel bytes per loop pass (~50 us each) */
+
+/* LCD_CTRL bits: write to control, read back HOST */
+#define LCD_FB_CTRL_HOST    0x01   /* Host owns the panel (0x00 hands it back) */
+#define LCD_FB_CTRL_CLEAR   0x80   /* Fill the framebuffer with spaces */
+
+typedef struct {
+    union {
+        uint8_t text[LCD_FB_SIZE]; /* What the host wants on the panel */
+        char line[2][LCD_FB_COLS + 1];  /* menu.c line_buffer, line_buffer2 */
+    };
+    uint8_t pos;                   /* Cursor of the box commands */
+    uint8_t arg;                   /* Character, number or mode for them */
+} lcd_fb_t;
+
+extern lcd_fb_t lcd_fb;
+
+void lcd_fb_init(void);                                         /* Spaces, menu owns the panel */
+void lcd_fb_write(uint8_t pos, const uint8_t *text, uint8_t len); /* Span, wraps at 32 */
+void lcd_fb_put(uint8_t c);                                     /* One character at the cursor */
+void lcd_fb_put_number(uint8_t value);                          /* Three digits, right-aligned */
+void lcd_fb_control(uint8_t ctrl);                              /* LCD_CTRL write */
+uint8_t lcd_fb_owned(void);                                     /* 1 while the host owns the panel */
+uint8_t lcd_fb_pending(void);                                   /* Marked characters left to send */
+void lcd_fb_release(void);                                      /* Hand the panel back to the menu */
+void lcd_fb_flush(void);                                        /* Send a few marked characters (call every loop) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
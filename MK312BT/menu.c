@@ -16,6 +16,7 @@
  *     3: Adjust Advanced  - enter advanced settings submenu
  *     4: Save Settings    - persist all settings to EEPROM
  *     5: Reset Settings   - restore factory defaults
+ *     7: Record Session   - start/stop the live session recorder
  *
  *   MENU_POWER_LEVEL: Low/Normal/High power selection
  *
@@ -32,9 +33,11 @@
 #include "eeprom.h"
 #include "mode_dispatcher.h"
 #include "user_programs.h"
+#include "session_rec.h"
 #include "adc.h"
 #include "config.h"
 #include "MK312BT_Modes.h"
+#include "lcd_fb.h"
 #include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <stdbool.h>
@@ -47,11 +50,14 @@ const char mode_names[] PROGMEM =
     "Rhythm\0Audio1\0Audio2\0Audio3\0Random1\0"
     "Random2\0Toggle\0Orgasm\0Torment\0Phase1\0"
     "Phase2\0Phase3\0User1\0User2\0User3\0"
-    "User4\0User5\0User6\0User7\0Split\0";
+    "User4\0User5\0User6\0User7\0Split\0Session\0";
 
 const char option_names[] PROGMEM =
     "Start Ramp Up?  \0Config Split?   \0Set As Favorite?\0Set Pwr Level?  \0"
-    "Adjust Advanced?\0Save Settings?  \0Reset Settings? \0";
+    "Adjust Advanced?\0Save Settings?  \0Reset Settings? \0Record Session? \0";
+
+#define OPTION_RECORD  7
+const char option_stop_rec[] PROGMEM = "Stop Recording? ";
 
 const char power_level_names[] PROGMEM =
     "Pwr Lev: Low    \0Pwr Lev: Normal \0Pwr Lev: High   \0";
@@ -69,10 +75,10 @@ const char nav_hint[] PROGMEM = "Press <- or OK >";
 /* ---- State Variables ---- */
 
 MenuState menu_state;
-char line_buffer[17];           /* LCD line formatting buffer (16 chars + null) */
-char line_buffer2[17];          /* Second line buffer for mode name display */
-
-extern eeprom_config_t g_menu_config;  /* Shared EEPROM config from main */
+/* LCD line formatting buffers (16 chars + null), in the host text
+ * framebuffer: the menu only draws while it owns the panel (lcd_fb.h) */
+#define line_buffer  (lcd_fb.line[0])
+#define line_buffer2 (lcd_fb.line[1])
 
 static bool ramp_up_active = false;     /* True while intensity ramp is running */
 static uint8_t ramp_counter = 0;        /* Ramp progress 0-100% */
@@ -94,6 +100,7 @@ static uint8_t cycle_mode(uint8_t current, bool forward);
 static bool mode_is_available(uint8_t mode);
 static void display_split_channel(void);
 static void display_generic_menu(const char* text);
+static void display_option(uint8_t index);
 static uint8_t get_battery_percent(void);
 static void return_to_main(void);
 
@@ -146,9 +153,11 @@ static uint8_t cycle_index(uint8_t current, uint8_t max_val, bool forward) {
 
 /* Returns true if a mode should be shown in the mode cycle.
  * User modes (17-23) are only shown if data is loaded in that slot.
- * Split mode (24) is configured via the Options menu, not mode cycle. */
+ * Split mode (24) is configured via the Options menu, not mode cycle.
+ * Session mode (25) is shown once a recording has been saved. */
 static bool mode_is_available(uint8_t mode) {
     if (mode == MODE_SPLIT) return false;
+    if (mode == MODE_SESSION) return session_rec_is_valid() != 0;
     if (mode >= MODE_USER1 && mode < MODE_SPLIT) {
         return user_prog_is_valid(mode - MODE_USER1) != 0;
     }
@@ -201,11 +210,21 @@ static void display_generic_menu(const char* text) {
     lcd_enable_buttons();
 }
 
+/* Options menu item; the recorder entry reads as a stop while recording */
+static void display_option(uint8_t index) {
+    if (index == OPTION_RECORD && session_rec_status() == SESSION_REC_RUNNING) {
+        strcpy_P(line_buffer, option_stop_rec);
+    } else {
+        copy_progmem_string(line_buffer, option_names, index);
+    }
+    display_generic_menu(line_buffer);
+}
+
 static void return_to_main(void) {
     mode_dispatcher_resume();
     menu_state.current_menu = MENU_MAIN;
     menu_needs_clear = true;
-    menuShowMode(g_menu_config.top_mode);
+    menuShowMode(config_get()->current_mode);
 }
 
 /* Convert raw battery ADC reading to 0-100%.
@@ -274,6 +293,7 @@ void menuShowStartup(void) {
  * Row 1: "A## B## ModeName"
  * Row 2: ramp progress or navigation hint */
 void menuShowMode(uint8_t mode_index) {
+    if (lcd_fb_owned()) return;         /* Host text is on the panel */
     if (mode_index >= MODE_COUNT) mode_index = 0;
 
     lcd_disable_buttons();
@@ -324,7 +344,17 @@ void menuShowMode(uint8_t mode_index) {
         else if (batt_pct >= 40) batt_icon = 2;
         else if (batt_pct >= 20) batt_icon = 1;
         else                     batt_icon = 0;
-        lcd_write_string_raw("<> Select Mode");
+        if (session_rec_status() == SESSION_REC_RUNNING) {
+            char* _p = line_buffer;
+            _p[0]='R'; _p[1]='e'; _p[2]='c'; _p[3]=' '; _p += 4;
+            _p = fmt_u8_3(_p, session_rec_bytes_used());
+            *_p++ = '/';
+            _p = fmt_u8_3(_p, SESSION_DATA_SIZE);
+            _p[0]=' '; _p[1]=' '; _p[2]=' '; _p[3]='\0';   /* 14 chars, as the hint */
+            lcd_write_string_raw(line_buffer);
+        } else {
+            lcd_write_string_raw("<> Select Mode");
+        }
         lcd_set_cursor_raw(15, 1);
         lcd_write_custom_char_raw(batt_icon);
     }
@@ -332,6 +362,10 @@ void menuShowMode(uint8_t mode_index) {
     lcd_enable_buttons();
 }
 
+void menuGetModeName(char* dest, uint8_t mode_index) {
+    copy_progmem_string(dest, mode_names, mode_index);
+}
+
 /* Advance ramp counter. Called periodically from main loop.
  * adv_ramp_time (0-255) controls speed: lower = faster.
  * At 0 the ramp completes instantly; at 255 it takes ~8x longer than default. */
@@ -353,7 +387,7 @@ void menuHandleRampUp(void) {
         ramp_up_active = false;
         if (menu_state.current_menu == MENU_MAIN) {
             menu_needs_clear = true;
-            menuShowMode(g_menu_config.top_mode);
+            menuShowMode(config_get()->current_mode);
         }
     }
 }
@@ -363,7 +397,7 @@ void menuStartRamp(void) {
     ramp_up_active = true;
     ramp_counter = 0;
     menu_needs_clear = true;
-    menuShowMode(g_menu_config.top_mode);
+    menuShowMode(config_get()->current_mode);
 }
 
 bool menuIsOutputEnabled(void) {
@@ -395,15 +429,15 @@ void menuStopOutput(void) {
 static void menu_handle_main(ButtonEvent event) {
     switch (event) {
         case BUTTON_UP:
-            g_menu_config.top_mode = cycle_mode(g_menu_config.top_mode, true);
+            config_set(CONFIG_FIELD(current_mode), cycle_mode(config_get()->current_mode, true));
             menuStartOutput();
-            menuShowMode(g_menu_config.top_mode);
+            menuShowMode(config_get()->current_mode);
             break;
 
         case BUTTON_DOWN:
-            g_menu_config.top_mode = cycle_mode(g_menu_config.top_mode, false);
+            config_set(CONFIG_FIELD(current_mode), cycle_mode(config_get()->current_mode, false));
             menuStartOutput();
-            menuShowMode(g_menu_config.top_mode);
+            menuShowMode(config_get()->current_mode);
             break;
 
         case BUTTON_OK:
@@ -414,8 +448,7 @@ static void menu_handle_main(ButtonEvent event) {
             mode_dispatcher_pause();
             menu_state.current_menu = MENU_OPTIONS;
             menu_state.menu_position = 0;
-            copy_progmem_string(line_buffer, option_names, 0);
-            display_generic_menu(line_buffer);
+            display_option(0);
             break;
 
         default:
@@ -428,14 +461,12 @@ static void menu_handle_options(ButtonEvent event) {
     switch (event) {
         case BUTTON_UP:
             menu_state.menu_position = cycle_index(menu_state.menu_position, OPTION_COUNT, true);
-            copy_progmem_string(line_buffer, option_names, menu_state.menu_position);
-            display_generic_menu(line_buffer);
+            display_option(menu_state.menu_position);
             break;
 
         case BUTTON_DOWN:
             menu_state.menu_position = cycle_index(menu_state.menu_position, OPTION_COUNT, false);
-            copy_progmem_string(line_buffer, option_names, menu_state.menu_position);
-            display_generic_menu(line_buffer);
+            display_option(menu_state.menu_position);
             break;
 
         case BUTTON_OK:
@@ -446,7 +477,7 @@ static void menu_handle_options(ButtonEvent event) {
                     break;
 
                 case 1:  /* Config Split */
-                    split_prev_mode = g_menu_config.top_mode;
+                    split_prev_mode = config_get()->current_mode;
                     split_edit_channel = 0;
                     split_mode_a_sel = mode_dispatcher_get_split_mode_a();
                     split_mode_b_sel = mode_dispatcher_get_split_mode_b();
@@ -455,8 +486,8 @@ static void menu_handle_options(ButtonEvent event) {
                     break;
 
                 case 2:  /* Set As Favorite */
-                    g_menu_config.favorite_mode = g_menu_config.top_mode;
-                    eeprom_save_config(&g_menu_config);
+                    config_set(CONFIG_FIELD(favorite_mode), config_get()->current_mode);
+                    config_save();
                     lcd_clear();
                     lcd_write_string_P(PSTR("Favorite Saved!"));
                     _delay_ms(1000);
@@ -465,9 +496,9 @@ static void menu_handle_options(ButtonEvent event) {
 
                 case 3:  /* Set Power Level */
                     menu_state.current_menu = MENU_POWER_LEVEL;
-                    if (g_menu_config.power_level > 2) g_menu_config.power_level = 1;
-                    menu_state.menu_position = g_menu_config.power_level;
-                    copy_progmem_string(line_buffer, power_level_names, g_menu_config.power_level);
+                    if (config_get()->power_level > 2) config_set(CONFIG_FIELD(power_level), 1);
+                    menu_state.menu_position = config_get()->power_level;
+                    copy_progmem_string(line_buffer, power_level_names, config_get()->power_level);
                     display_generic_menu(line_buffer);
                     break;
 
@@ -479,7 +510,7 @@ static void menu_handle_options(ButtonEvent event) {
                     break;
 
                 case 5:  /* Save Settings */
-                    eeprom_save_config(&g_menu_config);
+                    config_save();
                     lcd_clear();
                     lcd_write_string_P(PSTR("Settings Saved!"));
                     _delay_ms(1000);
@@ -487,13 +518,29 @@ static void menu_handle_options(ButtonEvent event) {
                     break;
 
                 case 6:  /* Reset Settings */
-                    eeprom_init_defaults(&g_menu_config);
-                    eeprom_save_config(&g_menu_config);
+                    config_set_defaults();
+                    config_save();
                     lcd_clear();
                     lcd_write_string_P(PSTR("Settings Reset!"));
                     _delay_ms(1000);
                     return_to_main();
                     break;
+
+                case OPTION_RECORD:  /* Record Session / Stop Recording */
+                    lcd_clear();
+                    if (session_rec_status() == SESSION_REC_RUNNING) {
+                        session_rec_stop();
+                        lcd_write_string_P(session_rec_is_valid() ? PSTR("Session Saved!")
+                                                                  : PSTR("Nothing Recorded"));
+                    } else if (config_get()->current_mode == MODE_SESSION) {
+                        lcd_write_string_P(PSTR("Session Playing"));
+                    } else {
+                        session_rec_start();
+                        lcd_write_string_P(PSTR("Recording..."));
+                    }
+                    _delay_ms(1000);
+                    return_to_main();
+                    break;
             }
             break;
 
@@ -510,17 +557,17 @@ static void menu_handle_options(ButtonEvent event) {
 static void menu_handle_power_level(ButtonEvent event) {
     switch (event) {
         case BUTTON_UP:
-            if (g_menu_config.power_level < 2) {
-                g_menu_config.power_level++;
-                copy_progmem_string(line_buffer, power_level_names, g_menu_config.power_level);
+            if (config_get()->power_level < 2) {
+                config_set(CONFIG_FIELD(power_level), config_get()->power_level + 1);
+                copy_progmem_string(line_buffer, power_level_names, config_get()->power_level);
                 display_generic_menu(line_buffer);
             }
             break;
 
         case BUTTON_DOWN:
-            if (g_menu_config.power_level > 0) {
-                g_menu_config.power_level--;
-                copy_progmem_string(line_buffer, power_level_names, g_menu_config.power_level);
+            if (config_get()->power_level > 0) {
+                config_set(CONFIG_FIELD(power_level), config_get()->power_level - 1);
+                copy_progmem_string(line_buffer, power_level_names, config_get()->power_level);
                 display_generic_menu(line_buffer);
             }
             break;
@@ -562,17 +609,8 @@ static void menu_handle_advanced(ButtonEvent event) {
             lcd_write_string_raw(line_buffer);
             lcd_set_cursor_raw(0, 1);
 
-            uint8_t value = 0;
-            switch (menu_state.menu_position) {
-                case 0: value = g_menu_config.adv_ramp_level; break;
-                case 1: value = g_menu_config.adv_ramp_time; break;
-                case 2: value = g_menu_config.adv_depth; break;
-                case 3: value = g_menu_config.adv_tempo; break;
-                case 4: value = g_menu_config.adv_frequency; break;
-                case 5: value = g_menu_config.adv_effect; break;
-                case 6: value = g_menu_config.adv_width; break;
-                case 7: value = g_menu_config.adv_pace; break;
-            }
+            /* The 8 advanced fields are contiguous, in menu order */
+            uint8_t value = ((uint8_t*)config_get())[CONFIG_FIELD(adv_ramp_level) + menu_state.menu_position];
             {
                 char* _p = line_buffer;
                 _p[0]='V'; _p[1]='a'; _p[2]='l'; _p[3]='u'; _p[4]='e'; _p[5]=':'; _p[6]=' '; _p += 7;
@@ -599,26 +637,15 @@ static void menu_handle_advanced(ButtonEvent event) {
 /* Advanced value edit mode: Up/Down increment/decrement value (0-255),
  * OK or Menu exits edit mode and returns to parameter selection */
 static void menu_handle_advanced_edit(ButtonEvent event) {
-    uint8_t* value_ptr = NULL;
-
     /* Map menu position to the config field being edited */
-    switch (menu_state.menu_position) {
-        case 0: value_ptr = &g_menu_config.adv_ramp_level; break;
-        case 1: value_ptr = &g_menu_config.adv_ramp_time; break;
-        case 2: value_ptr = &g_menu_config.adv_depth; break;
-        case 3: value_ptr = &g_menu_config.adv_tempo; break;
-        case 4: value_ptr = &g_menu_config.adv_frequency; break;
-        case 5: value_ptr = &g_menu_config.adv_effect; break;
-        case 6: value_ptr = &g_menu_config.adv_width; break;
-        case 7: value_ptr = &g_menu_config.adv_pace; break;
-    }
-
-    if (value_ptr == NULL) return;
+    if (menu_state.menu_position > 7) return;
+    uint8_t field = CONFIG_FIELD(adv_ramp_level) + menu_state.menu_position;
+    const uint8_t* value_ptr = (const uint8_t*)config_get() + field;
 
     switch (event) {
         case BUTTON_UP:
             if (*value_ptr < 255) {
-                (*value_ptr)++;
+                config_set(field, *value_ptr + 1);
                 lcd_disable_buttons();
                 lcd_set_cursor_raw(0, 1);
                 { char* _p = line_buffer; _p[0]='V'; _p[1]='a'; _p[2]='l'; _p[3]='u'; _p[4]='e'; _p[5]=':'; _p[6]=' '; _p += 7; _p = fmt_u8_3(_p, *value_ptr); _p[0]=' '; _p[1]=' '; _p[2]=' '; _p[3]=' '; _p[4]=' '; _p[5]=' '; _p[6]='\0'; }
@@ -629,7 +656,7 @@ static void menu_handle_advanced_edit(ButtonEvent event) {
 
         case BUTTON_DOWN:
             if (*value_ptr > 0) {
-                (*value_ptr)--;
+                config_set(field, *value_ptr - 1);
                 lcd_disable_buttons();
                 lcd_set_cursor_raw(0, 1);
                 { char* _p = line_buffer; _p[0]='V'; _p[1]='a'; _p[2]='l'; _p[3]='u'; _p[4]='e'; _p[5]=':'; _p[6]=' '; _p += 7; _p = fmt_u8_3(_p, *value_ptr); _p[0]=' '; _p[1]=' '; _p[2]=' '; _p[3]=' '; _p[4]=' '; _p[5]=' '; _p[6]='\0'; }
@@ -24,7 +24,7 @@ extern "C" {
 #define MENU_SPLIT        4   /* Split mode channel A/B selection */
 
 /* Item counts for each menu */
-#define OPTION_COUNT   7      /* Options menu items */
+#define OPTION_COUNT   8      /* Options menu items */
 #define ADVANCED_COUNT 8      /* Advanced settings (Ramp Level through Pace) */
 #define STATUS_COUNT   8      /* Status message strings */
 
@@ -49,6 +49,7 @@ extern MenuState menu_state;
 void menuInit(void);                          /* Init menu state + custom LCD chars */
 void menuShowStartup(void);                   /* Display splash screen with battery */
 void menuShowMode(uint8_t mode_index);        /* Refresh main mode display */
+void menuGetModeName(char* dest, uint8_t mode_index); /* Mode name, up to 8 chars + null */
 void menuHandleButton(ButtonEvent event);     /* Dispatch button to active screen */
 void menuHandleRampUp(void);                  /* Advance ramp counter (call from loop) */
 void menuStartRamp(void);                     /* Begin intensity ramp-up */
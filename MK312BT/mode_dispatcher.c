@@ -7,6 +7,7 @@
 #include "mode_dispatcher.h"
 #include "mode_programs.h"
 #include "user_programs.h"
+#include "session_rec.h"
 #include "channel_mem.h"
 #include "param_engine.h"
 #include "config.h"
@@ -15,45 +16,40 @@
 #include "eeprom.h"
 #include "prng.h"
 #include "pulse_gen.h"
-#include "dac.h"
+#include "audio_processor.h"
 #include "MK312BT_Constants.h"
 #include <avr/pgmspace.h>
-#include <util/delay.h>
 #include <string.h>
 
 static uint8_t current_mode;
-static uint8_t split_mode_a;
-static uint8_t split_mode_b;
 static uint8_t dispatcher_paused;
 
+mode_switch_t mode_switch;
+static uint8_t xfade_len;
+static uint8_t xfade_left;          /* Engine ticks left of the crossfade */
+static uint8_t xfade_from[2];       /* Intensity at the switch */
+static uint8_t xfade_level[2];      /* Last crossfade output */
+
 #define DEFERRED_NONE       0
 #define DEFERRED_SET_MODE   1
 #define DEFERRED_PAUSE      2
-#define DEFERRED_NEXT       3
-#define DEFERRED_PREV       4
+#define DEFERRED_NEXT       3   /* Also PREV: arg is a signed step count */
 #define DEFERRED_RELOAD     5
 #define DEFERRED_START_RAMP 6
 
-static volatile uint8_t deferred_cmd = DEFERRED_NONE;
-static volatile uint8_t deferred_mode = 0;
+typedef struct {
+    uint8_t cmd;
+    uint8_t arg;            /* SET_MODE: mode; NEXT: signed step count */
+} DeferredCmd;
 
-// Helper: map raw MA (0-255) to scaled value using channel's range registers
-uint8_t map_ma(uint8_t ma_raw, uint8_t ma_high, uint8_t ma_low) {
-    if (ma_high >= ma_low) {
-        return ma_low + (uint8_t)(((uint16_t)ma_raw * (ma_high - ma_low)) >> 8);
-    }
-    return ma_low - (uint8_t)(((uint16_t)ma_raw * (ma_low - ma_high)) >> 8);
-}
-
-static uint8_t get_ma_knob_value(void) {
-    return *MULTI_ADJUST; // map(min(75, max(0, (uint8_t)(ma_read_level() >> 2))), 0, 75, 0, 255); //config_get()->multi_adjust;
-}
+static DeferredCmd deferred_queue[DEFERRED_QUEUE_DEPTH];
+static uint8_t deferred_head;
+deferred_stats_t deferred_stats;
 
 static void execute_module(uint8_t module_index) {
     if (module_index >= MODULE_COUNT) return;
 
-    const uint8_t* program = (const uint8_t*)pgm_read_word(&module_table[module_index]);
-    const uint8_t* pc = program;
+    const uint8_t* pc = module_start(module_index);
 
     while (1) {
         uint8_t opcode = pgm_read_byte(pc);
@@ -179,15 +175,13 @@ static void execute_module(uint8_t module_index) {
         }
 
         if (opcode == 0x60) { // LOAD_MA – copy scaled MA knob value to bank registers
-            //uint8_t ma_raw = get_ma_knob_value();
             uint8_t ac = channel_a.apply_channel;
+            param_engine_refresh_ma();     // range bytes may have just been SET
             if (ac & 0x01) {
-                uint8_t scaled = *MULTI_ADJUST; 
-                *channel_get_reg_ptr(0x08C) = scaled;
+                *channel_get_reg_ptr(0x08C) = param_engine_get_ma(&channel_a);
             }
             if (ac & 0x02) {
-                uint8_t scaled = *MULTI_ADJUST; 
-                *channel_get_reg_ptr(0x18C) = scaled;
+                *channel_get_reg_ptr(0x18C) = param_engine_get_ma(&channel_b);
             }
             pc += 1;
             continue;
@@ -242,6 +236,11 @@ static const uint8_t mode_modules[17][2] PROGMEM = {
 };
 
 static void setup_mode_modules(uint8_t mode) {
+    if (mode == MODE_SESSION) {
+        session_play_start();
+        return;
+    }
+
     if (mode >= MODE_USER1 && mode < MODE_SPLIT) {
         user_prog_execute(mode - MODE_USER1);
         return;
@@ -316,7 +315,7 @@ static void init_split_mode(void) {
     apply_mode_init(&channel_b);
     channel_a.apply_channel = 0x01;
     execute_module(1);
-    setup_mode_modules(split_mode_a);
+    setup_mode_modules(config_get()->split_a_mode);
     memcpy(&saved_a, &channel_a, sizeof(ChannelBlock));
 
     channel_load_defaults(&channel_a);
@@ -325,7 +324,7 @@ static void init_split_mode(void) {
     apply_mode_init(&channel_b);
     channel_a.apply_channel = 0x02;
     execute_module(1);
-    setup_mode_modules(split_mode_b);
+    setup_mode_modules(config_get()->split_b_mode);
     memcpy(&saved_b, &channel_b, sizeof(ChannelBlock));
 
     memcpy(&channel_a, &saved_a, sizeof(ChannelBlock));
@@ -378,11 +377,8 @@ void mode_dispatcher_resume(void) {
 
 void mode_dispatcher_init(void) {
     current_mode = MODE_WAVES;
-    split_mode_a = MODE_WAVES;
-    split_mode_b = MODE_WAVES;
     dispatcher_paused = 0;
-    eeprom_load_split_modes(&split_mode_a, &split_mode_b);
-    user_programs_init();
+    session_rec_init();
     channel_mem_init();
     param_engine_init();
     random1_init();
@@ -391,18 +387,24 @@ void mode_dispatcher_init(void) {
 void mode_dispatcher_set_split_modes(uint8_t mode_a, uint8_t mode_b) {
     if (mode_a >= MODE_SPLIT) mode_a = MODE_WAVES;
     if (mode_b >= MODE_SPLIT) mode_b = MODE_WAVES;
-    split_mode_a = mode_a;
-    split_mode_b = mode_b;
-    eeprom_save_split_modes(mode_a, mode_b);
+    config_set(CONFIG_FIELD(split_a_mode), mode_a);
+    config_set(CONFIG_FIELD(split_b_mode), mode_b);
+    config_save();
 }
 
+/* No gate-off or DAC mute here: the rebuild below finishes before loop()
+ * passes anything to the pulse generator, which switches at a pulse gap. */
 void mode_dispatcher_select_mode(uint8_t mode_number) {
     if (mode_number >= MODE_COUNT) mode_number = 0;
 
-    dac_update_both_channels(DAC_MAX_VALUE, DAC_MAX_VALUE);
-    _delay_ms(2);
-    pulse_set_gate_a(PULSE_OFF);
-    pulse_set_gate_b(PULSE_OFF);
+    xfade_from[0] = xfade_level[0];
+    xfade_from[1] = xfade_level[1];
+    xfade_len = xfade_left = mode_switch.xfade_ticks;
+    if (mode_switch.switches != 0xFF) mode_switch.switches++;
+
+    pulse_mod_a.len = 0;
+    pulse_mod_b.len = 0;
+    audio_freq.ctrl = 0;
 
     current_mode = mode_number;
     param_engine_init();
@@ -421,7 +423,18 @@ void mode_dispatcher_select_mode(uint8_t mode_number) {
     update_output_flags();
 }
 
+uint8_t mode_dispatcher_xfade(uint8_t ch, uint8_t intensity) {
+    if (xfade_left) {
+        int16_t diff = (int16_t)intensity - xfade_from[ch];
+        intensity = (uint8_t)(xfade_from[ch] +
+                              (int32_t)diff * (xfade_len - xfade_left) / xfade_len);
+    }
+    xfade_level[ch] = intensity;
+    return intensity;
+}
+
 void mode_dispatcher_update(void) {
+    if (xfade_left) xfade_left--;
     if (dispatcher_paused) return;
 
     if (current_mode == MODE_RANDOM1) {
@@ -430,6 +443,10 @@ void mode_dispatcher_update(void) {
 
     param_engine_tick();
 
+    if (current_mode == MODE_SESSION) {
+        session_play_tick();
+    }
+
     uint8_t mod_a = param_engine_check_module_trigger(&channel_a);
     uint8_t mod_b = param_engine_check_module_trigger(&channel_b);
 
@@ -445,65 +462,127 @@ void mode_dispatcher_update(void) {
     update_output_flags();
 }
 
+void mode_dispatcher_subtick(void) {
+    if (dispatcher_paused) return;
+    param_engine_subtick();
+}
+
 uint8_t mode_dispatcher_get_mode(void) {
     return current_mode;
 }
 
 uint8_t mode_dispatcher_get_split_mode_a(void) {
-    return split_mode_a;
+    return config_get()->split_a_mode;
 }
 
 uint8_t mode_dispatcher_get_split_mode_b(void) {
-    return split_mode_b;
+    return config_get()->split_b_mode;
+}
+
+static uint8_t is_mode_change(uint8_t cmd) {
+    return cmd == DEFERRED_SET_MODE || cmd == DEFERRED_NEXT || cmd == DEFERRED_RELOAD;
+}
+
+static void count_coalesced(void) {
+    if (deferred_stats.coalesced != 0xFF) deferred_stats.coalesced++;
+}
+
+/* Queue a command, merging it into the newest queued one where the result
+ * is the same:
+ *   NEXT after NEXT, PREV after PREV  steps add up (clamping at the first
+ *                                  or last mode commutes within one sign)
+ *   SET_MODE after any mode change replaces it (the new mode wins)
+ *   RELOAD after any mode change   dropped (the mode was just loaded)
+ *   PAUSE / START_RAMP repeated    dropped
+ * Otherwise the command is appended, or counted as dropped when full. */
+static void deferred_push(uint8_t cmd, uint8_t arg) {
+    if (deferred_stats.depth) {
+        DeferredCmd *tail = &deferred_queue[(deferred_head + deferred_stats.depth - 1) & (DEFERRED_QUEUE_DEPTH - 1)];
+
+        /* Opposite steps stay apart: NEXT, PREV at the last mode must end
+         * one below it, not where it started */
+        if (cmd == DEFERRED_NEXT && tail->cmd == DEFERRED_NEXT &&
+            (int8_t)(tail->arg ^ arg) >= 0) {
+            int8_t steps = (int8_t)(tail->arg + arg);
+            count_coalesced();
+            if (steps > -MODE_COUNT && steps < MODE_COUNT) {
+                tail->arg = (uint8_t)steps;
+            }
+            return;
+        }
+        if ((cmd == DEFERRED_SET_MODE && is_mode_change(tail->cmd)) ||
+            (cmd == DEFERRED_RELOAD && is_mode_change(tail->cmd)) ||
+            ((cmd == DEFERRED_PAUSE || cmd == DEFERRED_START_RAMP) && cmd == tail->cmd)) {
+            if (cmd == DEFERRED_SET_MODE) {
+                tail->cmd = cmd;
+                tail->arg = arg;
+            }
+            count_coalesced();
+            return;
+        }
+    }
+
+    if (deferred_stats.depth == DEFERRED_QUEUE_DEPTH) {
+        if (deferred_stats.dropped != 0xFF) deferred_stats.dropped++;
+        return;
+    }
+    DeferredCmd *slot = &deferred_queue[(deferred_head + deferred_stats.depth) & (DEFERRED_QUEUE_DEPTH - 1)];
+    slot->cmd = cmd;
+    slot->arg = arg;
+    deferred_stats.depth++;
+    if (deferred_stats.depth > deferred_stats.peak) deferred_stats.peak = deferred_stats.depth;
 }
 
 void mode_dispatcher_request_mode(uint8_t mode_number) {
-    deferred_mode = mode_number;
-    deferred_cmd = DEFERRED_SET_MODE;
+    deferred_push(DEFERRED_SET_MODE, mode_number);
 }
 
 void mode_dispatcher_request_pause(void) {
-    deferred_cmd = DEFERRED_PAUSE;
+    deferred_push(DEFERRED_PAUSE, 0);
 }
 
 void mode_dispatcher_request_next_mode(void) {
-    deferred_cmd = DEFERRED_NEXT;
+    deferred_push(DEFERRED_NEXT, 1);
 }
 
 void mode_dispatcher_request_prev_mode(void) {
-    deferred_cmd = DEFERRED_PREV;
+    deferred_push(DEFERRED_NEXT, (uint8_t)-1);
 }
 
 void mode_dispatcher_request_reload(void) {
-    deferred_cmd = DEFERRED_RELOAD;
+    deferred_push(DEFERRED_RELOAD, 0);
 }
 
 void mode_dispatcher_request_start_ramp(void) {
-    deferred_cmd = DEFERRED_START_RAMP;
+    deferred_push(DEFERRED_START_RAMP, 0);
 }
 
+/* Run the oldest queued command. Returns 0 when idle, 1 after a mode
+ * change, 2 after a pause, 3 for start ramp (handled by the caller). */
 uint8_t mode_dispatcher_poll_deferred(void) {
-    uint8_t cmd = deferred_cmd;
-    if (cmd == DEFERRED_NONE) return 0;
-    deferred_cmd = DEFERRED_NONE;
+    if (!deferred_stats.depth) return 0;
 
-    switch (cmd) {
+    DeferredCmd c = deferred_queue[deferred_head];
+    deferred_head = (deferred_head + 1) & (DEFERRED_QUEUE_DEPTH - 1);
+    deferred_stats.depth--;
+
+    switch (c.cmd) {
         case DEFERRED_SET_MODE:
-            mode_dispatcher_select_mode(deferred_mode);
+            mode_dispatcher_select_mode(c.arg);
             return 1;
         case DEFERRED_PAUSE:
             mode_dispatcher_pause();
             return 2;
-        case DEFERRED_NEXT:
-            if (current_mode < MODE_COUNT - 1) {
-                mode_dispatcher_select_mode(current_mode + 1);
-            }
-            return 1;
-        case DEFERRED_PREV:
-            if (current_mode > 0) {
-                mode_dispatcher_select_mode(current_mode - 1);
+        case DEFERRED_NEXT: {
+            /* N steps, stopping at the first / last mode as single steps did */
+            int16_t target = (int16_t)current_mode + (int8_t)c.arg;
+            if (target < 0) target = 0;
+            if (target > MODE_COUNT - 1) target = MODE_COUNT - 1;
+            if (target != current_mode) {
+                mode_dispatcher_select_mode((uint8_t)target);
             }
             return 1;
+        }
         case DEFERRED_RELOAD:
             mode_dispatcher_select_mode(current_mode);
             return 1;
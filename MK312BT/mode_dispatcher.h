@@ -17,10 +17,10 @@
 extern "C" {
 #endif
 
-uint8_t map_ma(uint8_t ma_raw, uint8_t ma_high, uint8_t ma_low);
 void mode_dispatcher_init(void);
 void mode_dispatcher_select_mode(uint8_t mode_number);
 void mode_dispatcher_update(void);
+void mode_dispatcher_subtick(void);     /* Between engine ticks (ENGINE_RATE > 0) */
 uint8_t mode_dispatcher_get_mode(void);
 void mode_dispatcher_pause(void);
 void mode_dispatcher_resume(void);
@@ -29,13 +29,41 @@ void mode_dispatcher_set_split_modes(uint8_t mode_a, uint8_t mode_b);
 uint8_t mode_dispatcher_get_split_mode_a(void);
 uint8_t mode_dispatcher_get_split_mode_b(void);
 
+/* Mode switches rebuild channel_a / channel_b in place. The pulse generator
+ * never reads them directly: loop() hands the new values over and the
+ * timer ISRs take them at the next pulse gap, so output keeps running
+ * across a switch. With xfade_ticks set, each channel's intensity also
+ * blends from its level at the switch to the new mode's over that many
+ * engine ticks. */
+typedef struct {
+    uint8_t xfade_ticks;    /* Crossfade length, 0 = off (default) */
+    uint8_t switches;       /* Mode switches (saturates) */
+} mode_switch_t;
+
+extern mode_switch_t mode_switch;
+
+uint8_t mode_dispatcher_xfade(uint8_t ch, uint8_t intensity);  /* Per loop pass, ch 0 = A */
+
+/* Deferred commands from the serial link, run by mode_dispatcher_poll_deferred()
+ * from loop(). They queue in order; a command that repeats or overrides the
+ * newest queued one is merged into it (repeated NEXT or repeated PREV add
+ * up to one step of N; NEXT and PREV are never merged with each other). */
+typedef struct {
+    uint8_t depth;          /* Commands waiting */
+    uint8_t peak;           /* Highest depth seen */
+    uint8_t coalesced;      /* Requests merged into a queued command (saturates) */
+    uint8_t dropped;        /* Requests lost to a full queue (saturates) */
+} deferred_stats_t;
+
+extern deferred_stats_t deferred_stats;
+
 void mode_dispatcher_request_mode(uint8_t mode_number);
 void mode_dispatcher_request_pause(void);
 void mode_dispatcher_request_next_mode(void);
 void mode_dispatcher_request_prev_mode(void);
 void mode_dispatcher_request_reload(void);
 void mode_dispatcher_request_start_ramp(void);
-uint8_t mode_dispatcher_poll_deferred(void);
+uint8_t mode_dispatcher_poll_deferred(void);    /* Runs one queued command */
 
 #ifdef __cplusplus
 }
@@ -1,3 +1,10 @@
+/*
+ * mode_programs.h - Built-in Bytecode Modules (generated)
+ *
+ * GENERATED by Host/tools/pattern_compile.py --store from
+ * Host/tools/patterns/builtin.pat. Do not edit by hand: change the
+ * pattern file and regenerate.
+ */
 #ifndef MODE_PROGRAMS_H
 #define MODE_PROGRAMS_H
 
@@ -9,8 +16,17 @@ extern "C" {
 #endif
 
 #define MODULE_COUNT 36
+#define MODULE_STORE_SIZE 431
 
-extern const uint8_t* const module_table[];
+extern const uint8_t module_store[];
+extern const uint8_t module_offset[];
+
+/* First instruction of module n (n < MODULE_COUNT) */
+static inline const uint8_t *module_start(uint8_t n) {
+    uint16_t off = pgm_read_byte(&module_offset[n]);
+    if (n >= 24) off += 256;
+    return module_store + off;
+}
 
 #ifdef __cplusplus
 }
@@ -5,6 +5,15 @@
  * 
  * ADDED: master_timer (16-bit) counting at 1.91 Hz (every 128 ticks)
  * for Random 1 mode.
+ *
+ * ADDED: sub-tick glides. All timers count engine ticks at every
+ * ENGINE_RATE, so modes keep their wall-clock timing. Above rate 0 each
+ * step also starts a glide that moves the value in 1/256 units towards
+ * the next step's result over the sub-ticks until then (one division per
+ * step, one add per sub-tick), and the next step puts the unglided value
+ * back first. A value written by anything else cancels its glide. The
+ * ramp group has no glide: it steps at most a few times per second and
+ * only scales the output level.
  */
 
 #include "param_engine.h"
@@ -12,13 +21,17 @@
 #include "MK312BT_Memory.h"
 #include "config.h"
 #include "prng.h"
+#include "tick_sync.h"
 #include <stddef.h>
+#include <string.h>
 
 static uint8_t tick_counter;
 static uint8_t pending_module_a;
 static uint8_t pending_module_b;
 
 static uint16_t master_timer = 0;          // 1.91 Hz timer (every 128 ticks)
+static uint8_t master_sub = 0;             // ticks into the current master_timer step
+static uint32_t tick_total = 0;            // ticks since power-on, never reset
 
 #define DIR_UP   0
 #define DIR_DOWN 1
@@ -48,19 +61,75 @@ typedef struct {
     uint8_t select;
     uint8_t timer;
 } ParamGroup;
-/*
-static uint8_t map_ma(uint8_t ma_raw, uint8_t ma_high, uint8_t ma_low) {
-    if (ma_high >= ma_low) {
-        // Increasing range: result = ma_low + (ma_raw * (ma_high - ma_low)) / 256
-        uint16_t range = ma_high - ma_low;
-        return ma_low + (uint8_t)(((uint16_t)ma_raw * range) >> 8);
+
+// Glide of one group between two steps, inc 0 = idle. The position is
+// 8.8 and moves by inc per sub-tick, rounded up so that it reaches the
+// target by the next step and then holds. The frequency group also writes
+// the fraction to freq_frac (period = freq_value:freq_frac us) while
+// freq_frac is the engine's to use; it then equals the low byte of pos.
+typedef struct {
+    uint16_t pos;       // glided value, 8.8
+    uint16_t inc;       // 1/256 units per sub-tick
+    uint8_t base;       // value after the last step
+    uint8_t target;     // value the next step gives
+} Glide;
+
+#define GLIDE_COUNT 6
+#define GLIDE_NONE  0xFF                       // group index without a glide (ramp)
+
+static Glide glide[GLIDE_COUNT];               // A intensity/freq/width, then B
+static uint8_t glide_fine_mask;                // bit i: glide[i] writes freq_frac
+static uint32_t subtick_total = 0;             // sub-ticks since power-on
+
+// Map raw MA (0-255) onto the span at_min (knob minimum)..at_max (maximum)
+uint8_t map_ma(uint8_t ma_raw, uint8_t at_max, uint8_t at_min) {
+    if (at_max >= at_min) {
+        // Increasing range: result = at_min + (ma_raw * (at_max - at_min)) / 256
+        uint16_t range = at_max - at_min;
+        return at_min + (uint8_t)(((uint16_t)ma_raw * range) >> 8);
     } else {
-        // Decreasing range: result = ma_low - (ma_raw * (ma_low - ma_high)) / 256
-        uint16_t range = ma_low - ma_high;
-        return ma_low - (uint8_t)(((uint16_t)ma_raw * range) >> 8);
+        // Decreasing range: result = at_min - (ma_raw * (at_min - at_max)) / 256
+        uint16_t range = at_min - at_max;
+        return at_min - (uint8_t)(((uint16_t)ma_raw * range) >> 8);
     }
 }
-*/
+
+// Per-channel scaled MA. An entry is remapped only when the knob reading
+// or that channel's ma_range bytes differ from the ones it was built from.
+// The 0x86 byte is the output at knob minimum, 0x87 the output at maximum.
+typedef struct {
+    uint8_t scaled;
+    uint8_t range_86;
+    uint8_t range_87;
+} MaCache;
+
+static uint8_t ma_knob_raw;                // knob reading, 0-255
+static uint8_t ma_cache_raw;               // knob reading the cache was built from
+static MaCache ma_cache[2];
+
+static void ma_cache_update(MaCache *c, const ChannelBlock *ch, uint8_t force) {
+    if (!force && c->range_86 == ch->ma_at_knob_min && c->range_87 == ch->ma_at_knob_max) return;
+    c->range_86 = ch->ma_at_knob_min;
+    c->range_87 = ch->ma_at_knob_max;
+    c->scaled = map_ma(ma_knob_raw, ch->ma_at_knob_max, ch->ma_at_knob_min);
+}
+
+void param_engine_refresh_ma(void) {
+    uint8_t force = (ma_cache_raw != ma_knob_raw);
+    ma_cache_raw = ma_knob_raw;
+    ma_cache_update(&ma_cache[0], &channel_a, force);
+    ma_cache_update(&ma_cache[1], &channel_b, force);
+    *MULTI_ADJUST = ma_cache[0].scaled;    // 0x420D reports channel A
+}
+
+void param_engine_set_ma_knob(uint8_t ma_raw) {
+    ma_knob_raw = ma_raw;
+    param_engine_refresh_ma();
+}
+
+uint8_t param_engine_get_ma(const ChannelBlock *ch) {
+    return ma_cache[ch == &channel_b].scaled;
+}
 static uint8_t resolve_source(uint8_t index, uint8_t own_val,
                                uint8_t adv_val, uint8_t ma_scaled,
                                uint8_t other_val) {
@@ -126,7 +195,76 @@ static uint8_t do_action(uint8_t action, ParamGroup *g, ChannelBlock *ch,
     }
 }
 
-static uint8_t step_group(ParamGroup *g, ChannelBlock *ch, uint8_t ma_scaled,
+static uint8_t glide_value(const Glide *gl, uint8_t fine_on) {
+    return fine_on ? (uint8_t)(gl->pos >> 8) : (uint8_t)((gl->pos + 0x80) >> 8);
+}
+
+// Move glide i on by n sub-ticks' share of its step
+static void glide_advance(uint8_t i, ParamGroup *g, uint8_t *fine, uint8_t n) {
+    Glide *gl = &glide[i];
+    uint8_t bit = 1 << i;
+
+    if (gl->inc == 0) return;
+    if (g->value != glide_value(gl, glide_fine_mask & bit)) {   // written by a module or the host
+        gl->inc = 0;
+        return;
+    }
+    if ((glide_fine_mask & bit) && *fine != (uint8_t)gl->pos) glide_fine_mask &= ~bit;
+
+    uint16_t end = (uint16_t)gl->target << 8;
+    uint8_t up = gl->target > gl->base;
+    while (n-- && gl->pos != end) {
+        uint16_t left = up ? end - gl->pos : gl->pos - end;
+        uint16_t d = (gl->inc < left) ? gl->inc : left;
+        gl->pos += up ? d : -d;
+    }
+    g->value = glide_value(gl, glide_fine_mask & bit);
+    if (glide_fine_mask & bit) *fine = (uint8_t)gl->pos;
+}
+
+// Put back the value of the last step before the next one
+static void glide_settle(uint8_t i, ParamGroup *g, uint8_t *fine) {
+    Glide *gl = &glide[i];
+    uint8_t bit = 1 << i;
+
+    if (gl->inc) {
+        if (g->value == glide_value(gl, glide_fine_mask & bit)) g->value = gl->base;
+        if ((glide_fine_mask & bit) && *fine == (uint8_t)gl->pos) *fine = 0;
+    }
+    gl->inc = 0;
+    glide_fine_mask &= ~bit;
+}
+
+// Aim glide i at the result of the next step, rate * timer period ticks away
+static void glide_start(uint8_t i, const ParamGroup *g, const uint8_t *fine,
+                        uint8_t timer_sel, uint8_t effective_rate, uint8_t dir) {
+    Glide *gl = &glide[i];
+    uint32_t span = (uint32_t)effective_rate << tick_sync_shift();
+    if (timer_sel == SEL_TIMER_30HZ) span <<= 3;
+    else if (timer_sel == SEL_TIMER_1HZ) span <<= 8;
+    if (span > 0xFFFF || !(g->select & SEL_TIMER_MASK)) return;
+
+    uint8_t target;
+    if (dir == DIR_UP) {
+        uint16_t next = (uint16_t)g->value + g->step;
+        target = (next >= (uint16_t)g->max) ? g->max : (uint8_t)next;
+    } else {
+        int16_t next = (int16_t)g->value - g->step;
+        target = (next <= (int16_t)g->min) ? g->min : (uint8_t)next;
+    }
+    if (target == g->value) return;
+
+    uint16_t dist = (uint16_t)((target > g->value) ? target - g->value : g->value - target) << 8;
+    gl->pos = (uint16_t)g->value << 8;
+    gl->inc = dist / (uint16_t)span;
+    if (dist % (uint16_t)span) gl->inc++;
+    gl->base = g->value;
+    gl->target = target;
+    if (fine && *fine == 0) glide_fine_mask |= 1 << i;
+}
+
+static uint8_t step_group(ParamGroup *g, uint8_t gi, uint8_t *fine,
+                           ChannelBlock *ch, uint8_t ma_scaled,
                            uint8_t adv_min, uint8_t adv_rate,
                            uint8_t other_val, uint8_t *dir) {
     uint8_t sel = g->select;
@@ -149,6 +287,7 @@ static uint8_t step_group(ParamGroup *g, ChannelBlock *ch, uint8_t ma_scaled,
     g->timer++;
     if (g->timer < effective_rate) return 0xFF;
     g->timer = 0;
+    if (gi != GLIDE_NONE) glide_settle(gi, g, fine);
 
     uint8_t min_idx = (sel >> 2) & 0x07;
     if (min_idx != 0) {
@@ -158,22 +297,57 @@ static uint8_t step_group(ParamGroup *g, ChannelBlock *ch, uint8_t ma_scaled,
     uint8_t stp = g->step;
     if (stp == 0) return 0xFF;
 
+    uint8_t m = 0xFF;
     if (*dir == DIR_UP) {
         uint16_t next = (uint16_t)g->value + stp;
         if (next >= (uint16_t)g->max) {
             g->value = g->max;
-            return do_action(g->action_max, g, ch, dir);
+            m = do_action(g->action_max, g, ch, dir);
+        } else {
+            g->value = (uint8_t)next;
         }
-        g->value = (uint8_t)next;
     } else {
         int16_t next = (int16_t)g->value - stp;
         if (next <= (int16_t)g->min) {
             g->value = g->min;
-            return do_action(g->action_min, g, ch, dir);
+            m = do_action(g->action_min, g, ch, dir);
+        } else {
+            g->value = (uint8_t)next;
         }
-        g->value = (uint8_t)next;
     }
-    return 0xFF;
+    if (gi != GLIDE_NONE && tick_sync_shift()) glide_start(gi, g, fine, timer_sel, effective_rate, *dir);
+    return m;
+}
+
+#define OFF_RAMP      (offsetof(ChannelBlock, ramp_value))
+#define OFF_INTENSITY (offsetof(ChannelBlock, intensity_value))
+#define OFF_FREQ      (offsetof(ChannelBlock, freq_value))
+#define OFF_WIDTH     (offsetof(ChannelBlock, width_value))
+
+// Glide i belongs to the group (i % 3) after intensity; they are contiguous
+static ParamGroup *glide_group(uint8_t i) {
+    ChannelBlock *ch = &channel_a;
+    if (i >= 3) {
+        ch = &channel_b;
+        i -= 3;
+    }
+    return (ParamGroup *)(&((uint8_t *)ch)[OFF_INTENSITY + i * sizeof(ParamGroup)]);
+}
+
+static uint8_t *glide_fine(uint8_t i) {
+    if (i == 1) return &channel_a.freq_frac;
+    if (i == 4) return &channel_b.freq_frac;
+    return NULL;
+}
+
+static void glide_advance_all(void) {
+    uint8_t n = tick_sync_slots();
+    for (uint8_t i = 0; i < GLIDE_COUNT; i++) glide_advance(i, glide_group(i), glide_fine(i), n);
+}
+
+// Settle every glide, so a module sees the values of the last steps
+static void glide_settle_all(void) {
+    for (uint8_t i = 0; i < GLIDE_COUNT; i++) glide_settle(i, glide_group(i), glide_fine(i));
 }
 
 static uint8_t step_channel_group(ChannelBlock *ch, uint8_t offset,
@@ -181,14 +355,12 @@ static uint8_t step_channel_group(ChannelBlock *ch, uint8_t offset,
                                    uint8_t adv_rate, uint8_t other_val,
                                    uint8_t *dir) {
     ParamGroup *g = (ParamGroup *)(&((uint8_t *)ch)[offset]);
-    return step_group(g, ch, ma_scaled, adv_min, adv_rate, other_val, dir);
+    uint8_t gi = GLIDE_NONE;
+    if (offset != OFF_RAMP) gi = ((ch == &channel_b) ? 3 : 0) + (offset - OFF_INTENSITY) / sizeof(ParamGroup);
+    uint8_t *fine = (offset == OFF_FREQ) ? &ch->freq_frac : NULL;
+    return step_group(g, gi, fine, ch, ma_scaled, adv_min, adv_rate, other_val, dir);
 }
 
-#define OFF_RAMP      (offsetof(ChannelBlock, ramp_value))
-#define OFF_INTENSITY (offsetof(ChannelBlock, intensity_value))
-#define OFF_FREQ      (offsetof(ChannelBlock, freq_value))
-#define OFF_WIDTH     (offsetof(ChannelBlock, width_value))
-
 static uint8_t* get_dir_flags(ChannelBlock *ch) {
     return (ch == &channel_a) ? &dir_flags_a : &dir_flags_b;
 }
@@ -201,8 +373,7 @@ static void update_gate_timer(ChannelBlock *ch, uint8_t *gt, uint8_t *gp) {
     if (!timer_fires(timer_sel)) return;
 
     system_config_t *cfg = config_get();
-    //uint8_t ma_raw = *MULTI_ADJUST; 
-    uint8_t ma_scaled = *MULTI_ADJUST;  //map_ma(ma_raw, ch->ma_range_high, ch->ma_range_low);
+    uint8_t ma_scaled = param_engine_get_ma(ch);
 
     uint8_t ontime = ch->gate_ontime;
     if (sel & GATE_ON_FROM_MA)          ontime = ma_scaled;
@@ -233,9 +404,8 @@ static void update_gate_timer(ChannelBlock *ch, uint8_t *gt, uint8_t *gp) {
 }
 
 static void step_channel(ChannelBlock *ch, ChannelBlock *other,
-                          uint8_t ma_raw, uint8_t *trigger) {
+                          uint8_t ma_scaled, uint8_t *trigger) {
     system_config_t *cfg = config_get();
-    uint8_t ma_scaled = *MULTI_ADJUST; //   map_ma(ma_raw, ch->ma_range_high, ch->ma_range_low);
     uint8_t *flags = get_dir_flags(ch);
     uint8_t m;
     uint8_t dir;
@@ -306,7 +476,7 @@ static uint8_t compute_dir_flags(ChannelBlock *ch) {
 }
 
 void param_engine_init(void) {
-    tick_counter = 0;
+    tick_counter = tick_sync_phase();        // 0 unless synced to a host
     master_timer = 0;                        // Initialize master timer
     pending_module_a = 0xFF;
     pending_module_b = 0xFF;
@@ -316,6 +486,8 @@ void param_engine_init(void) {
     gate_timer_a = 0;
     gate_phase_b = 0;
     gate_timer_b = 0;
+    memset(glide, 0, sizeof(glide));
+    glide_fine_mask = 0;
 }
 
 void param_engine_init_directions(void) {
@@ -329,15 +501,18 @@ void param_engine_init_directions(void) {
 
 void param_engine_tick(void) {
     tick_counter++;
+    tick_total++;
+    glide_advance_all();                    // a tick is also a sub-tick slot
 
     // Update 1.91 Hz master timer (every 128 ticks)
-    static uint8_t master_sub = 0;
     master_sub++;
     if (master_sub >= 128) {
         master_sub = 0;
         master_timer++;
     }
 
+    param_engine_refresh_ma();
+
     update_gate_timer(&channel_a, &gate_timer_a, &gate_phase_a);
     update_gate_timer(&channel_b, &gate_timer_b, &gate_phase_b);
 
@@ -345,31 +520,46 @@ void param_engine_tick(void) {
     pending_module_b = 0xFF;
 
     system_config_t *cfg = config_get();
-    uint8_t ma_raw = *MULTI_ADJUST; 
-    uint8_t ma_a = *MULTI_ADJUST;  //map_ma(ma_raw, channel_a.ma_range_high, channel_a.ma_range_low);
-    uint8_t ma_b = *MULTI_ADJUST;  // map_ma(ma_raw, channel_b.ma_range_high, channel_b.ma_range_low);
+    uint8_t ma_a = ma_cache[0].scaled;
+    uint8_t ma_b = ma_cache[1].scaled;
 
-    step_channel(&channel_a, &channel_b, ma_raw, &pending_module_a);
+    step_channel(&channel_a, &channel_b, ma_a, &pending_module_a);
     step_next_module_timer(&channel_a, ma_a, cfg->adv_tempo,
                             channel_b.next_module_timer_max, &pending_module_a);
 
-    step_channel(&channel_b, &channel_a, ma_raw, &pending_module_b);
+    step_channel(&channel_b, &channel_a, ma_b, &pending_module_b);
     step_next_module_timer(&channel_b, ma_b, cfg->adv_tempo,
                             channel_a.next_module_timer_max, &pending_module_b);
 }
 
+// Between two ticks at ENGINE_RATE > 0: glides only, no timers
+void param_engine_subtick(void) {
+    subtick_total++;
+    glide_advance_all();
+}
+
 uint8_t param_engine_get_tick(void) {
     return tick_counter;
 }
 
+// Align tick_counter and the master_timer prescaler to a host-synced tick
+// count (tick_sync.c), so the 30 Hz / 1 Hz timers of all synced boxes fire
+// on the same tick. tick_total is left alone.
+void param_engine_set_phase(uint32_t ticks) {
+    tick_counter = (uint8_t)ticks;
+    master_sub = (uint8_t)(ticks & 0x7F);
+}
+
 uint8_t param_engine_check_module_trigger(ChannelBlock *ch) {
+    uint8_t m;
     if (ch == &channel_a) {
-        uint8_t m = pending_module_a;
+        m = pending_module_a;
         pending_module_a = 0xFF;
-        return m;
+    } else {
+        m = pending_module_b;
+        pending_module_b = 0xFF;
     }
-    uint8_t m = pending_module_b;
-    pending_module_b = 0xFF;
+    if (m != 0xFF) glide_settle_all();
     return m;
 }
 
@@ -377,3 +567,13 @@ uint8_t param_engine_check_module_trigger(ChannelBlock *ch) {
 uint16_t param_engine_get_master_timer(void) {
     return master_timer;
 }
+
+// Monotonic tick count since power-on. Unlike tick_counter it survives
+// param_engine_init() (mode changes), so it can timestamp input events.
+uint32_t param_engine_get_tick_total(void) {
+    return tick_total;
+}
+
+uint32_t param_engine_get_subtick_total(void) {
+    return subtick_total;
+}
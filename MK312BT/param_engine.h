@@ -11,10 +11,22 @@ extern "C" {
 void param_engine_init(void);
 void param_engine_init_directions(void);
 void param_engine_tick(void);
+void param_engine_subtick(void);                   /* ENGINE_RATE sub-tick (tick_sync.h) */
 
 uint8_t param_engine_check_module_trigger(ChannelBlock *ch);
 uint8_t param_engine_get_tick(void);
+void param_engine_set_phase(uint32_t ticks);       /* Host-synced tick (tick_sync.c) */
 uint16_t param_engine_get_master_timer(void);
+uint32_t param_engine_get_tick_total(void);
+uint32_t param_engine_get_subtick_total(void);
+
+/* Multi-Adjust scaled through each channel's ma_range bytes (0x86/0x87).
+ * The values are cached; param_engine_refresh_ma() remaps only a channel
+ * whose range bytes or the knob reading changed. */
+uint8_t map_ma(uint8_t ma_raw, uint8_t at_max, uint8_t at_min);
+void param_engine_set_ma_knob(uint8_t ma_raw);     /* Knob reading 0-255 */
+void param_engine_refresh_ma(void);
+uint8_t param_engine_get_ma(const ChannelBlock *ch);
 
 #ifdef __cplusplus
 }
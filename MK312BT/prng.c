@@ -14,6 +14,7 @@
  */
 
 #include "prng.h"
+#include "input_trace.h"
 
 static uint16_t prng_state = 0xACE1;  /* Non-zero default seed */
 
@@ -23,6 +24,8 @@ void prng_init(uint16_t seed) {
         seed = 0xACE1;
     }
     prng_state = seed;
+    input_trace_log(INPUT_TRACE_SEED_LO, (uint8_t)seed);
+    input_trace_log(INPUT_TRACE_SEED_HI, (uint8_t)(seed >> 8));
 }
 
 /* Generate next 16-bit pseudo-random value */
@@ -12,6 +12,14 @@
 
 volatile ChannelPulseState pulse_ch_a;
 volatile ChannelPulseState pulse_ch_b;
+volatile pulse_mod_t pulse_mod_a;
+volatile pulse_mod_t pulse_mod_b;
+#if DOSE_METER_ENABLE
+volatile pulse_dose_t pulse_dose_a;
+volatile pulse_dose_t pulse_dose_b;
+volatile uint8_t pulse_dose_seq;
+pulse_dose_t pulse_dose_snap[2];
+#endif
 
 void pulse_gen_init(void) {
     pulse_ch_a.gate = PULSE_OFF;
@@ -21,7 +29,12 @@ void pulse_gen_init(void) {
     pulse_ch_a.gap_remaining = 0;
     pulse_ch_a.pending_width = 100;
     pulse_ch_a.pending_period = 5000;
+    pulse_ch_a.polarity = 0;
+    pulse_ch_a.pending_polarity = 0;
     pulse_ch_a.params_dirty = 0;
+    pulse_ch_a.burst_on = 0;
+    pulse_ch_a.burst_left = 0;
+    pulse_ch_a.pending_burst_on = 0;
 
     pulse_ch_b.gate = PULSE_OFF;
     pulse_ch_b.width_ticks = 100;
@@ -30,7 +43,12 @@ void pulse_gen_init(void) {
     pulse_ch_b.gap_remaining = 0;
     pulse_ch_b.pending_width = 100;
     pulse_ch_b.pending_period = 5000;
+    pulse_ch_b.polarity = 0;
+    pulse_ch_b.pending_polarity = 0;
     pulse_ch_b.params_dirty = 0;
+    pulse_ch_b.burst_on = 0;
+    pulse_ch_b.burst_left = 0;
+    pulse_ch_b.pending_burst_on = 0;
 
     /* Ensure all H-bridge pins start LOW (both channels off) */
     PORTB &= ~HBRIDGE_FETS_MASK;
@@ -60,7 +78,7 @@ void pulse_gen_init(void) {
 }
 
 void pulse_set_width_a(uint8_t width_us) {
-    if (width_us < 70) width_us = 70;
+    if (width_us < PULSE_WIDTH_MIN) width_us = PULSE_WIDTH_MIN;
     uint8_t sreg = SREG;
     cli();
     pulse_ch_a.pending_width = width_us;
@@ -69,7 +87,7 @@ void pulse_set_width_a(uint8_t width_us) {
 }
 
 void pulse_set_width_b(uint8_t width_us) {
-    if (width_us < 70) width_us = 70;
+    if (width_us < PULSE_WIDTH_MIN) width_us = PULSE_WIDTH_MIN;
     uint8_t sreg = SREG;
     cli();
     pulse_ch_b.pending_width = width_us;
@@ -118,3 +136,104 @@ void pulse_set_frequency_b(uint16_t period_us) {
     pulse_ch_b.params_dirty = 1;
     SREG = sreg;
 }
+
+void pulse_set_polarity_a(uint8_t pol) {
+    uint8_t sreg = SREG;
+    cli();
+    pulse_ch_a.pending_polarity = pol & PULSE_POL_MASK;
+    pulse_ch_a.params_dirty = 1;
+    SREG = sreg;
+}
+
+void pulse_set_polarity_b(uint8_t pol) {
+    uint8_t sreg = SREG;
+    cli();
+    pulse_ch_b.pending_polarity = pol & PULSE_POL_MASK;
+    pulse_ch_b.params_dirty = 1;
+    SREG = sreg;
+}
+
+void pulse_set_burst_a(uint8_t on_pulses, uint8_t off_periods) {
+    uint8_t sreg = SREG;
+    cli();
+    pulse_ch_a.pending_burst_on = on_pulses;
+    pulse_ch_a.pending_burst_off = off_periods;
+    SREG = sreg;
+}
+
+void pulse_set_burst_b(uint8_t on_pulses, uint8_t off_periods) {
+    uint8_t sreg = SREG;
+    cli();
+    pulse_ch_b.pending_burst_on = on_pulses;
+    pulse_ch_b.pending_burst_off = off_periods;
+    SREG = sreg;
+}
+
+#if DOSE_METER_ENABLE
+/* 10-bit DAC value (inverted) to an 8-bit drive; one byte, so no cli */
+static uint8_t dac_drive(uint16_t dac_value) {
+    if (dac_value >= DAC_MAX_VALUE) return 0;
+    return (uint8_t)((DAC_MAX_VALUE - dac_value) >> 2);
+}
+
+void pulse_set_drive_a(uint16_t dac_value) {
+    pulse_ch_a.drive = dac_drive(dac_value);
+}
+
+void pulse_set_drive_b(uint16_t dac_value) {
+    pulse_ch_b.drive = dac_drive(dac_value);
+}
+
+static void dose_copy(pulse_dose_t *dst, volatile pulse_dose_t *now) {
+    dst->pulses    = now->pulses;
+    dst->on_pos_us = now->on_pos_us;
+    dst->on_neg_us = now->on_neg_us;
+    dst->energy    = now->energy;
+}
+
+/* Take d out of the live counters, one 32-bit field per short cli */
+static void dose_sub(volatile pulse_dose_t *live, const pulse_dose_t *d) {
+    volatile uint32_t *p = &live->pulses;
+    const uint32_t *v = &d->pulses;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t sreg = SREG;
+        cli();
+        p[i] -= v[i];
+        SREG = sreg;
+    }
+}
+
+/* Both channels are read in one pass without blocking the ISRs: they bump
+ * pulse_dose_seq after booking a pulse, and a pass that saw it move is
+ * repeated (pulses are at least 500 us apart, a pass is a few hundred
+ * cycles). A and B come from the same instant. The live counters run
+ * from the last reset, so the pass copies them straight into
+ * pulse_dose_snap; SNAPSHOT | RESET then subtracts that one reading, and
+ * pulses booked since stay counted for the next interval. */
+void pulse_dose_control(uint8_t ctrl) {
+    uint8_t seq;
+
+    if (ctrl & PULSE_DOSE_SNAPSHOT) {
+        do {
+            seq = pulse_dose_seq;
+            dose_copy(&pulse_dose_snap[0], &pulse_dose_a);
+            dose_copy(&pulse_dose_snap[1], &pulse_dose_b);
+        } while (seq != pulse_dose_seq);
+        if (ctrl & PULSE_DOSE_RESET) {
+            dose_sub(&pulse_dose_a, &pulse_dose_snap[0]);
+            dose_sub(&pulse_dose_b, &pulse_dose_snap[1]);
+        }
+    } else if (ctrl & PULSE_DOSE_RESET) {
+        volatile uint32_t *a = &pulse_dose_a.pulses;
+        volatile uint32_t *b = &pulse_dose_b.pulses;
+        uint8_t sreg = SREG;
+        cli();
+        for (uint8_t i = 0; i < 4; i++) {
+            a[i] = 0;
+            b[i] = 0;
+        }
+        SREG = sreg;
+    }
+}
+#endif
@@ -11,17 +11,41 @@
  *   PH_DEADTIME2 -> Both LOW for 4 us     (prevent FET shoot-through)
  *   PH_GAP       -> Both LOW              (inter-pulse gap)
  *
+ * Polarity comes from the gate_value polarity bits (PULSE_POL_*). An
+ * inverted or alternated pulse drives Gate- in PH_POSITIVE and Gate+ in
+ * PH_NEGATIVE. A monophasic pulse (one of POS/NEG set) ends after
+ * PH_POSITIVE and goes straight to PH_GAP: two interrupts instead of five.
+ *
  * H-bridge pin assignments:
  *   Channel A: PB2 = Gate+, PB3 = Gate-
  *   Channel B: PB0 = Gate+, PB1 = Gate-
  *
  * The main loop sets width, period, and gate on/off.
  * Timer ISRs (in interrupts.c) run the state machine autonomously.
+ *
+ * Optional pulse-count gating: with burst_on = N the ISR emits N pulses,
+ * then keeps the bridge off for burst_off = M whole periods, and repeats
+ * while the gate is on. Every gate-on starts a fresh burst, so each burst
+ * has exactly N pulses whatever the 244 Hz gate timer does.
+ *
+ * Per-pulse width modulation: pulse_mod_a/b hold up to PULSE_MOD_STEPS
+ * signed width offsets. Each pulse the ISR adds the next one to the
+ * width set by the main loop, wrapping after len entries and restarting
+ * with every burst, so width can change faster than the 244 Hz engine.
+ *
+ * Dose meter (DOSE_METER_ENABLE builds only): the ISR adds every pulse it
+ * starts to pulse_dose_a/b, with its scheduled on-time per polarity and
+ * that on-time weighted by the DAC drive in effect (set from the DAC write
+ * path). The counters are 32-bit, count from the last reset and wrap; the
+ * main loop reads them without locking, rereading both channels while
+ * pulse_dose_seq moves, and a reset takes the snapshot out of them with
+ * interrupts off for one 32-bit subtraction at a time.
  */
 #ifndef PULSE_GEN_H
 #define PULSE_GEN_H
 
 #include <stdint.h>
+#include "MK312BT_Constants.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +54,17 @@ extern "C" {
 #define PULSE_OFF   0
 #define PULSE_ON    1
 
+#define PULSE_WIDTH_MIN  70      // Narrowest half-cycle in us, also for modulated widths
+#define PULSE_MOD_STEPS  15      // Width offsets per channel table
+
+/* Polarity flags, the same bits as GATE_POL_* / GATE_ALT_POL / GATE_INV_POL
+ * in gate_value. Neither or both of NEG/POS = biphasic. */
+#define PULSE_POL_NEG    0x02    // Negative half-cycle only
+#define PULSE_POL_POS    0x04    // Positive half-cycle only
+#define PULSE_POL_ALT    0x08    // Flip polarity on every pulse
+#define PULSE_POL_INV    0x10    // Swap positive and negative
+#define PULSE_POL_MASK   0x1E
+
 /* 5-phase biphasic pulse state machine */
 typedef enum {
     PH_POSITIVE,    // Gate+ on, Gate- off
@@ -46,17 +81,64 @@ typedef enum {
 typedef struct {
     volatile uint8_t gate;           // PULSE_ON or PULSE_OFF
     volatile uint8_t width_ticks;    // Pulse half-cycle width in us (min 20)
+    volatile uint8_t pulse_width;    // Width of the pulse in progress (after modulation)
+    volatile uint8_t mod_index;      // Next pulse_mod entry
+    volatile uint8_t polarity;       // PULSE_POL_* flags in effect
+    volatile uint8_t pulse_neg;      // Pulse in progress starts with Gate-
+    volatile uint8_t pulse_mono;     // Pulse in progress has one half-cycle
+    volatile uint8_t alt_flip;       // PULSE_POL_ALT state, toggled per pulse
     volatile uint16_t period_ticks;  // Full pulse period in us (min 500)
     volatile PulsePhase phase;       // Current state machine phase
     volatile uint16_t gap_remaining; // Timer2 only: multi-step gap countdown
     volatile uint8_t pending_width;  // Double-buffered width (main loop writes)
     volatile uint16_t pending_period; // Double-buffered period (main loop writes)
+    volatile uint8_t pending_polarity; // Double-buffered polarity (main loop writes)
     volatile uint8_t params_dirty;   // Set by main loop, cleared by ISR after copy
+    volatile uint8_t burst_on;       // Pulses per burst, 0 = no pulse-count gating
+    volatile uint8_t burst_off;      // Silent periods after each burst
+    volatile uint8_t burst_left;     // Periods left in the current part
+    volatile uint8_t burst_idle;     // 1 while in the silent part
+    volatile uint8_t pending_burst_on;  // Taken by the ISR when a burst starts
+    volatile uint8_t pending_burst_off;
+#if DOSE_METER_ENABLE
+    volatile uint8_t drive;          // DAC drive in effect, 0 = off, 255 = full scale
+    volatile uint8_t energy_frac;    // Dose energy below 1 us at full scale
+#endif
 } ChannelPulseState;
 
 extern volatile ChannelPulseState pulse_ch_a;  // Timer1 CompA ISR state
 extern volatile ChannelPulseState pulse_ch_b;  // Timer2 Comp ISR state
 
+/* Per-pulse width table, serial 0x43C0 (A) / 0x43D0 (B), bytecode 0x3C0 /
+ * 0x3D0. Read by the ISR as it goes; cleared on every mode change. */
+typedef struct {
+    uint8_t len;                     // Entries in use, 0 = off (above 15 = 15)
+    int8_t  step[PULSE_MOD_STEPS];   // Width offset in us for successive pulses
+} pulse_mod_t;
+
+extern volatile pulse_mod_t pulse_mod_a;
+extern volatile pulse_mod_t pulse_mod_b;
+
+#if DOSE_METER_ENABLE
+/* Delivered output per channel. Snapshots (since the last reset) are at
+ * serial 0x43B0 (A) / 0x43F0 (B), little-endian, taken by DOSE_CTRL. */
+typedef struct {
+    uint32_t pulses;                 // Pulses started
+    uint32_t on_pos_us;              // Gate+ on-time
+    uint32_t on_neg_us;              // Gate- on-time
+    uint32_t energy;                 // On-time times drive / 256: us at full scale
+} pulse_dose_t;
+
+extern volatile pulse_dose_t pulse_dose_a;     // Live, written by the ISRs
+extern volatile pulse_dose_t pulse_dose_b;
+extern volatile uint8_t pulse_dose_seq;         // Bumped by the ISRs per booked pulse
+extern pulse_dose_t pulse_dose_snap[2];         // DOSE_CTRL snapshot, A then B
+
+/* DOSE_CTRL write bits */
+#define PULSE_DOSE_SNAPSHOT  0x01    // Copy both channels into pulse_dose_snap
+#define PULSE_DOSE_RESET     0x80    // Count from zero again (after SNAPSHOT)
+#endif
+
 /* Initialize Timer1 and Timer2 in CTC mode with /8 prescaler.
  * Starts both timers with gates OFF. Enables CompA and Comp2 interrupts. */
 void pulse_gen_init(void);
@@ -73,6 +155,33 @@ void pulse_set_gate_b(uint8_t on);
 void pulse_set_frequency_a(uint16_t period_us);
 void pulse_set_frequency_b(uint16_t period_us);
 
+/* Set the pulse polarity from gate_value (masked with PULSE_POL_MASK).
+ * Takes effect at the next pulse. */
+void pulse_set_polarity_a(uint8_t pol);
+void pulse_set_polarity_b(uint8_t pol);
+
+/* Pulse-count gating: on_pulses pulses, then off_periods silent periods.
+ * on_pulses = 0 turns it off. Takes effect at the next burst start. */
+void pulse_set_burst_a(uint8_t on_pulses, uint8_t off_periods);
+void pulse_set_burst_b(uint8_t on_pulses, uint8_t off_periods);
+
+#if DOSE_METER_ENABLE
+
+/* DAC value now driving the channel (DAC_MAX_VALUE = off), for the dose
+ * meter. Called by the DAC driver whenever an output is updated. */
+void pulse_set_drive_a(uint16_t dac_value);
+void pulse_set_drive_b(uint16_t dac_value);
+
+void pulse_dose_control(uint8_t ctrl);         // DOSE_CTRL write
+
+#else
+
+#define pulse_set_drive_a(dac_value)  ((void)0)
+#define pulse_set_drive_b(dac_value)  ((void)0)
+#define pulse_dose_control(ctrl)      ((void)0)
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
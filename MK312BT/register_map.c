@@ -0,0 +1,267 @@
+/*
+ * register_map.c - Virtual Register Map tables (generated)
+ *
+ * GENERATED by Host/tools/gen_register_map.py from
+ * Host/tools/register_map.def. Do not edit by hand: change the .def file
+ * and regenerate.
+ */
+
+#include "register_map.h"
+#include "MK312BT_Constants.h"
+#include "MK312BT_Memory.h"
+#include "channel_mem.h"
+#include "config.h"
+#include "serial.h"
+#include "input_trace.h"
+#include "mode_dispatcher.h"
+#include "tick_sync.h"
+#include "pulse_gen.h"
+#include "audio_processor.h"
+#include "lcd_fb.h"
+#include <avr/pgmspace.h>
+#include <stddef.h>
+
+/* Linear storage chunk: one 16-byte block of a block directive */
+typedef struct {
+    void   *ptr;
+    uint8_t access;
+} reg_chunk_t;
+
+#define REGMAP_LINEAR  0x80
+
+#define REGMAP_FIRST_FLASH    0
+#define REGMAP_FIRST_RAM      16
+#define REGMAP_FIRST_EEPROM   80
+#define REGMAP_BLOCKS        112
+
+static const reg_desc_t regmap_desc[] PROGMEM = {
+    /*  1 */ { REG_KIND_CONST,     REG_ACC_R,               SERIAL_PROTOCOL_VERSION,                   NULL },  /* 0x00FB VIRT_FLASH_PROTO_VERSION */
+    /*  2 */ { REG_KIND_CONST,     REG_ACC_R,               BOX_MODEL_MK312BT,                         NULL },  /* 0x00FC VIRT_FLASH_BOX_MODEL */
+    /*  3 */ { REG_KIND_CONST,     REG_ACC_R,               FIRMWARE_VER_MAJ,                          NULL },  /* 0x00FD VIRT_FLASH_FW_MAJ */
+    /*  4 */ { REG_KIND_CONST,     REG_ACC_R,               FIRMWARE_VER_MIN,                          NULL },  /* 0x00FE VIRT_FLASH_FW_MIN */
+    /*  5 */ { REG_KIND_CONST,     REG_ACC_R,               FIRMWARE_VER_INT,                          NULL },  /* 0x00FF VIRT_FLASH_FW_INT */
+    /*  6 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&g_mk312bt_state.pot_lockout_flags },  /* 0x400F VIRT_RAM_POT_LOCKOUT */
+    /*  7 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&g_mk312bt_state.multi_adjust_offset },  /* 0x4061 VIRT_RAM_MA_OFFSET */
+    /*  8 */ { REG_KIND_HANDLER,   REG_ACC_R,               REG_H_RAM_LEVEL_A,                         NULL },  /* 0x4064 VIRT_RAM_LEVEL_A */
+    /*  9 */ { REG_KIND_HANDLER,   REG_ACC_R,               REG_H_RAM_LEVEL_B,                         NULL },  /* 0x4065 VIRT_RAM_LEVEL_B */
+    /* 10 */ { REG_KIND_CONST,     REG_ACC_R,               0x02,                                      NULL },  /* 0x406D VIRT_RAM_MENU_STATE */
+    /* 11 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_BOX_COMMAND,                     NULL },  /* 0x4070 VIRT_RAM_BOX_COMMAND */
+    /* 12 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_CURRENT_MODE,                    NULL },  /* 0x407B VIRT_RAM_CURRENT_MODE */
+    /* 13 */ { REG_KIND_CFG_MODE,  REG_ACC_R,               offsetof(system_config_t, current_mode),   NULL },  /* 0x41F3 VIRT_RAM_TOP_MODE */
+    /* 14 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_POWER_LEVEL,                     NULL },  /* 0x41F4 VIRT_RAM_POWER_LEVEL */
+    /* 15 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, split_a_mode),   NULL },  /* 0x41F5 VIRT_RAM_SPLIT_MODE_A */
+    /* 16 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, split_b_mode),   NULL },  /* 0x41F6 VIRT_RAM_SPLIT_MODE_B */
+    /* 17 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, favorite_mode),  NULL },  /* 0x41F7 VIRT_RAM_FAVOURITE */
+    /* 18 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_ramp_level), NULL },  /* 0x41F8 VIRT_RAM_ADV_RAMP_LVL */
+    /* 19 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_ramp_time),  NULL },  /* 0x41F9 VIRT_RAM_ADV_RAMP_TIME */
+    /* 20 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_depth),      NULL },  /* 0x41FA VIRT_RAM_ADV_DEPTH */
+    /* 21 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_tempo),      NULL },  /* 0x41FB VIRT_RAM_ADV_TEMPO */
+    /* 22 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_frequency),  NULL },  /* 0x41FC VIRT_RAM_ADV_FREQUENCY */
+    /* 23 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_effect),     NULL },  /* 0x41FD VIRT_RAM_ADV_EFFECT */
+    /* 24 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_width),      NULL },  /* 0x41FE VIRT_RAM_ADV_WIDTH */
+    /* 25 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_pace),       NULL },  /* 0x41FF VIRT_RAM_ADV_PACE */
+    /* 26 */ { REG_KIND_HANDLER,   REG_ACC_R,               REG_H_RAM_BATTERY_LEVEL,                   NULL },  /* 0x4203 VIRT_RAM_BATTERY_LEVEL */
+    /* 27 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&g_mk312bt_state.multi_adjust },  /* 0x420D VIRT_RAM_MULTI_ADJUST */
+    /* 28 */ { REG_KIND_CONST,     REG_ACC_R,               0x00,                                      NULL },  /* 0x4213 VIRT_RAM_BOX_KEY */
+    /* 29 */ { REG_KIND_CONST,     REG_ACC_R,               0x02,                                      NULL },  /* 0x4215 VIRT_RAM_POWER_SUPPLY */
+    /* 30 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&lcd_fb.pos },  /* 0x4240 VIRT_RAM_LCD_POS */
+    /* 31 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&lcd_fb.arg },  /* 0x4241 VIRT_RAM_LCD_ARG */
+    /* 32 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_LCD_CTRL,                        NULL },  /* 0x4242 VIRT_RAM_LCD_CTRL */
+    /* 33 */ { REG_KIND_HANDLER,   REG_ACC_R,               REG_H_RAM_LCD_PENDING,                     NULL },  /* 0x4243 VIRT_RAM_LCD_PENDING */
+    /* 34 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&deferred_stats.depth },  /* 0x4390 VIRT_RAM_DEFER_DEPTH */
+    /* 35 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&deferred_stats.peak },  /* 0x4391 VIRT_RAM_DEFER_PEAK */
+    /* 36 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&deferred_stats.coalesced },  /* 0x4392 VIRT_RAM_DEFER_MERGED */
+    /* 37 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&deferred_stats.dropped },  /* 0x4393 VIRT_RAM_DEFER_DROPPED */
+    /* 38 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_tx_stats.reply_peak },  /* 0x4394 VIRT_RAM_TX_REPLY_PEAK */
+    /* 39 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_tx_stats.reply_dropped },  /* 0x4395 VIRT_RAM_TX_REPLY_DROP */
+    /* 40 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_tx_stats.stream_sent },  /* 0x4396 VIRT_RAM_TX_STREAM_SENT */
+    /* 41 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_tx_stats.stream_dropped },  /* 0x4397 VIRT_RAM_TX_STREAM_DROP */
+    /* 42 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&mode_switch.xfade_ticks },  /* 0x4398 VIRT_RAM_MODE_XFADE */
+    /* 43 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&mode_switch.switches },  /* 0x4399 VIRT_RAM_MODE_SWITCHES */
+    /* 44 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_rx_stats.timeout_ms },  /* 0x439A VIRT_RAM_RX_TIMEOUT */
+    /* 45 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_rx_stats.resyncs },  /* 0x439B VIRT_RAM_RX_RESYNCS */
+    /* 46 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_rx_stats.bad_checksum },  /* 0x439C VIRT_RAM_RX_BAD_CSUM */
+    /* 47 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_rx_stats.junk },  /* 0x439D VIRT_RAM_RX_JUNK */
+    /* 48 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&serial_rx_stats.overruns },  /* 0x439E VIRT_RAM_RX_OVERRUNS */
+    /* 49 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_rate },  /* 0x439F VIRT_RAM_ENGINE_RATE */
+    /* 50 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_regs.ref[0] },  /* 0x43A0 VIRT_RAM_SYNC_REF0 */
+    /* 51 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_regs.ref[1] },  /* 0x43A1 VIRT_RAM_SYNC_REF1 */
+    /* 52 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_regs.ref[2] },  /* 0x43A2 VIRT_RAM_SYNC_REF2 */
+    /* 53 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_regs.ref[3] },  /* 0x43A3 VIRT_RAM_SYNC_REF3 */
+    /* 54 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_SYNC_CTRL,                       NULL },  /* 0x43A4 VIRT_RAM_SYNC_CTRL */
+    /* 55 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.latch[0] },  /* 0x43A5 VIRT_RAM_SYNC_LATCH0 */
+    /* 56 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.latch[1] },  /* 0x43A6 VIRT_RAM_SYNC_LATCH1 */
+    /* 57 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.latch[2] },  /* 0x43A7 VIRT_RAM_SYNC_LATCH2 */
+    /* 58 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.latch[3] },  /* 0x43A8 VIRT_RAM_SYNC_LATCH3 */
+    /* 59 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.error[0] },  /* 0x43A9 VIRT_RAM_SYNC_ERROR_LO */
+    /* 60 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.error[1] },  /* 0x43AA VIRT_RAM_SYNC_ERROR_HI */
+    /* 61 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.trim[0] },  /* 0x43AB VIRT_RAM_SYNC_TRIM_LO */
+    /* 62 */ { REG_KIND_RAM8,      REG_ACC_R,               0,                                         (void*)&tick_sync_regs.trim[1] },  /* 0x43AC VIRT_RAM_SYNC_TRIM_HI */
+    /* 63 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W,   0,                                         (void*)&tick_sync_regs.steps },  /* 0x43AD VIRT_RAM_SYNC_STEPS */
+    /* 64 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.period_a[0] },  /* 0x43E0 VIRT_RAM_AUDIO_A_LO */
+    /* 65 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.period_a[1] },  /* 0x43E1 VIRT_RAM_AUDIO_A_HI */
+    /* 66 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.period_b[0] },  /* 0x43E2 VIRT_RAM_AUDIO_B_LO */
+    /* 67 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.period_b[1] },  /* 0x43E3 VIRT_RAM_AUDIO_B_HI */
+    /* 68 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.ctrl },  /* 0x43E4 VIRT_RAM_AUDIO_FOLLOW */
+    /* 69 */ { REG_KIND_RAM8,      REG_ACC_R | REG_ACC_W | REG_ACC_BC, 0,                                         (void*)&audio_freq.overloads },  /* 0x43E5 VIRT_RAM_AUDIO_OVERLOAD */
+    /* 70 */ { REG_KIND_CONST,     REG_ACC_R,               0x55,                                      NULL },  /* 0x8001 VIRT_EE_PROVISIONED */
+    /* 71 */ { REG_KIND_CONST,     REG_ACC_R,               0x01,                                      NULL },  /* 0x8002 VIRT_EE_BOX_SERIAL_LO */
+    /* 72 */ { REG_KIND_CONST,     REG_ACC_R,               0x00,                                      NULL },  /* 0x8003 VIRT_EE_BOX_SERIAL_HI */
+    /* 73 */ { REG_KIND_CONST,     REG_ACC_R,               0x01,                                      NULL },  /* 0x8006 VIRT_EE_ELINK_SIG1 */
+    /* 74 */ { REG_KIND_CONST,     REG_ACC_R,               0x01,                                      NULL },  /* 0x8007 VIRT_EE_ELINK_SIG2 */
+    /* 75 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, current_mode),   NULL },  /* 0x8008 VIRT_EE_TOP_MODE */
+    /* 76 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_EE_POWER_LEVEL,                      NULL },  /* 0x8009 VIRT_EE_POWER_LEVEL */
+    /* 77 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, split_a_mode),   NULL },  /* 0x800A VIRT_EE_SPLIT_MODE_A */
+    /* 78 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, split_b_mode),   NULL },  /* 0x800B VIRT_EE_SPLIT_MODE_B */
+    /* 79 */ { REG_KIND_CFG_MODE,  REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, favorite_mode),  NULL },  /* 0x800C VIRT_EE_FAVOURITE_MODE */
+    /* 80 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_ramp_level), NULL },  /* 0x800D VIRT_EE_ADV_RAMP_LEVEL */
+    /* 81 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_ramp_time),  NULL },  /* 0x800E VIRT_EE_ADV_RAMP_TIME */
+    /* 82 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_depth),      NULL },  /* 0x800F VIRT_EE_ADV_DEPTH */
+    /* 83 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_tempo),      NULL },  /* 0x8010 VIRT_EE_ADV_TEMPO */
+    /* 84 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_frequency),  NULL },  /* 0x8011 VIRT_EE_ADV_FREQUENCY */
+    /* 85 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_effect),     NULL },  /* 0x8012 VIRT_EE_ADV_EFFECT */
+    /* 86 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_width),      NULL },  /* 0x8013 VIRT_EE_ADV_WIDTH */
+    /* 87 */ { REG_KIND_CFG,       REG_ACC_R | REG_ACC_W,   offsetof(system_config_t, adv_pace),       NULL },  /* 0x8014 VIRT_EE_ADV_PACE */
+#if INPUT_TRACE_ENABLE
+    /* 88 */ { REG_KIND_HANDLER,   REG_ACC_R | REG_ACC_W,   REG_H_RAM_TRACE_HEAD,                      NULL },  /* 0x4380 VIRT_RAM_TRACE_HEAD */
+#else
+    /* -- */ { REG_KIND_NONE,      0,                       0,                                         NULL },
+#endif
+#if DOSE_METER_ENABLE
+    /* 89 */ { REG_KIND_HANDLER,   REG_ACC_W,               REG_H_RAM_DOSE_CTRL,                       NULL },  /* 0x43AF VIRT_RAM_DOSE_CTRL */
+#endif
+};
+
+static const reg_chunk_t regmap_chunk[] PROGMEM = {
+    { (uint8_t*)&channel_a + 0x00, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_a + 0x10, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_a + 0x20, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_a + 0x30, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_b + 0x00, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_b + 0x10, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_b + 0x20, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&channel_b + 0x30, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&lcd_fb.text + 0x00, REG_ACC_R },
+    { (uint8_t*)&lcd_fb.text + 0x10, REG_ACC_R },
+    { (uint8_t*)&pulse_mod_a + 0x00, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+    { (uint8_t*)&pulse_mod_b + 0x00, REG_ACC_R | REG_ACC_W | REG_ACC_BC },
+#if INPUT_TRACE_ENABLE
+    { (uint8_t*)&input_trace_ring + 0x00, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x10, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x20, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x30, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x40, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x50, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x60, REG_ACC_R },
+    { (uint8_t*)&input_trace_ring + 0x70, REG_ACC_R },
+#else
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+    { NULL, 0 },
+#endif
+#if DOSE_METER_ENABLE
+    { (uint8_t*)&pulse_dose_snap[0] + 0x00, REG_ACC_R },
+    { (uint8_t*)&pulse_dose_snap[1] + 0x00, REG_ACC_R },
+#endif
+};
+
+/* Sparse pages: descriptor number (1-based) per address, 0 = unmapped */
+static const uint8_t regmap_page[][16] PROGMEM = {
+    {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  2,  3,  4,  5 },
+    {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  6 },
+    {  0,  7,  0,  0,  8,  9,  0,  0,  0,  0,  0,  0,  0, 10,  0,  0 },
+    { 11,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 12,  0,  0,  0,  0 },
+    {  0,  0,  0, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25 },
+    {  0,  0,  0, 26,  0,  0,  0,  0,  0,  0,  0,  0,  0, 27,  0,  0 },
+    {  0,  0,  0, 28,  0, 29,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    { 30, 31, 32, 33,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    { 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49 },
+    { 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,  0, (DOSE_METER_ENABLE ? 89 : 0) },
+    { 64, 65, 66, 67, 68, 69,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    {  0, 70, 71, 72,  0,  0, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82 },
+    { 83, 84, 85, 86, 87,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    { (INPUT_TRACE_ENABLE ? 88 : 0),  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+};
+
+/* Block index: 0 = region default, 1..0x7F = page + 1, 0x80|n = chunk n */
+static const uint8_t regmap_index[REGMAP_BLOCKS] PROGMEM = {
+    /* FLASH */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    /* RAM */
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x04, 0x80, 0x81, 0x82, 0x83, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x84, 0x85, 0x86, 0x87, 0x00, 0x00, 0x00, 0x05,
+    0x06, 0x07, 0x88, 0x89, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    (INPUT_TRACE_ENABLE ? 0x8C : 0), (INPUT_TRACE_ENABLE ? 0x8D : 0), (INPUT_TRACE_ENABLE ? 0x8E : 0), (INPUT_TRACE_ENABLE ? 0x8F : 0), (INPUT_TRACE_ENABLE ? 0x90 : 0), (INPUT_TRACE_ENABLE ? 0x91 : 0), (INPUT_TRACE_ENABLE ? 0x92 : 0), (INPUT_TRACE_ENABLE ? 0x93 : 0), (INPUT_TRACE_ENABLE ? 0x0E : 0), 0x09, 0x0A, (DOSE_METER_ENABLE ? 0x94 : 0), 0x8A, 0x8B, 0x0B, (DOSE_METER_ENABLE ? 0x95 : 0),
+    /* EEPROM */
+    0x0C, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+uint8_t regmap_decode(uint16_t addr, reg_desc_t *out) {
+    uint8_t blk, dflt, entry, slot;
+
+    if ((uint16_t)(addr - VIRT_FLASH_BASE) < (VIRT_FLASH_END - VIRT_FLASH_BASE)) {
+        blk  = REGMAP_FIRST_FLASH + ((addr - VIRT_FLASH_BASE) >> 4);
+        dflt = REG_KIND_NONE;
+    } else if ((uint16_t)(addr - VIRT_RAM_BASE) < (VIRT_RAM_END - VIRT_RAM_BASE)) {
+        blk  = REGMAP_FIRST_RAM + ((addr - VIRT_RAM_BASE) >> 4);
+        dflt = REG_KIND_NONE;
+    } else if ((uint16_t)(addr - VIRT_EEPROM_BASE) < (VIRT_EEPROM_END - VIRT_EEPROM_BASE)) {
+        blk  = REGMAP_FIRST_EEPROM + ((addr - VIRT_EEPROM_BASE) >> 4);
+        dflt = REG_KIND_EEPROM;
+    } else {
+        blk  = 0;
+        dflt = REG_KIND_NONE;
+        goto unmapped;
+    }
+
+    entry = pgm_read_byte(&regmap_index[blk]);
+    if (entry & REGMAP_LINEAR) {
+        const reg_chunk_t *c = &regmap_chunk[entry & ~REGMAP_LINEAR];
+        out->kind   = REG_KIND_RAM8;
+        out->access = pgm_read_byte(&c->access);
+        out->arg    = 0;
+        out->ptr    = (uint8_t*)pgm_read_ptr(&c->ptr) + (addr & 0x0F);
+        return REG_KIND_RAM8;
+    }
+    if (entry) {
+        slot = pgm_read_byte(&regmap_page[entry - 1][addr & 0x0F]);
+        if (slot) {
+            memcpy_P(out, &regmap_desc[slot - 1], sizeof(reg_desc_t));
+            return out->kind;
+        }
+    }
+
+unmapped:
+    out->kind   = dflt;
+    out->access = (dflt == REG_KIND_NONE) ? 0 : (REG_ACC_R | REG_ACC_W);
+    out->arg    = 0;
+    out->ptr    = NULL;
+    return dflt;
+}
+
+/* Bytecode addresses are RAM region offsets (0x000-0x3FF). */
+uint8_t* regmap_bytecode_ptr(uint16_t addr) {
+    uint8_t entry, slot;
+    const reg_chunk_t *c;
+    const reg_desc_t *d;
+
+    if (addr >= (VIRT_RAM_END - VIRT_RAM_BASE)) return NULL;
+    entry = pgm_read_byte(&regmap_index[REGMAP_FIRST_RAM + (addr >> 4)]);
+    if (entry & REGMAP_LINEAR) {
+        c = &regmap_chunk[entry & ~REGMAP_LINEAR];
+        if (!(pgm_read_byte(&c->access) & REG_ACC_BC)) return NULL;
+        return (uint8_t*)pgm_read_ptr(&c->ptr) + (addr & 0x0F);
+    }
+    if (!entry) return NULL;
+    slot = pgm_read_byte(&regmap_page[entry - 1][addr & 0x0F]);
+    if (!slot) return NULL;
+    d = &regmap_desc[slot - 1];
+    if (!(pgm_read_byte(&d->access) & REG_ACC_BC)) return NULL;
+    return (uint8_t*)pgm_read_ptr(&d->ptr);
+}
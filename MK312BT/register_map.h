@@ -0,0 +1,187 @@
+/*
+ * register_map.h - Virtual Register Map (generated)
+ *
+ * GENERATED by Host/tools/gen_register_map.py from
+ * Host/tools/register_map.def. Do not edit by hand: change the .def file
+ * and regenerate.
+ *
+ * Every address the serial protocol or the mode bytecode can touch is
+ * described once. regmap_decode() turns a virtual address into a
+ * descriptor in constant time; serial_mem.c acts on the descriptor.
+ */
+#ifndef REGISTER_MAP_H
+#define REGISTER_MAP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Virtual memory region boundaries */
+#define VIRT_FLASH_BASE         0x0000
+#define VIRT_FLASH_END          0x0100
+#define VIRT_RAM_BASE           0x4000
+#define VIRT_RAM_END            0x4400
+#define VIRT_EEPROM_BASE        0x8000
+#define VIRT_EEPROM_END         0x8200
+
+/* FLASH registers */
+#define VIRT_FLASH_PROTO_VERSION   0x00FB
+#define VIRT_FLASH_BOX_MODEL       0x00FC
+#define VIRT_FLASH_FW_MAJ          0x00FD
+#define VIRT_FLASH_FW_MIN          0x00FE
+#define VIRT_FLASH_FW_INT          0x00FF
+
+/* RAM registers */
+#define VIRT_RAM_CHAN_A_BASE       0x4080
+#define VIRT_RAM_CHAN_A_END        0x40C0
+#define VIRT_RAM_CHAN_B_BASE       0x4180
+#define VIRT_RAM_CHAN_B_END        0x41C0
+#define VIRT_RAM_LCD_FB_BASE       0x4220
+#define VIRT_RAM_LCD_FB_END        0x4240
+#define VIRT_RAM_TRACE_BASE        0x4300
+#define VIRT_RAM_TRACE_END         0x4380
+#define VIRT_RAM_DOSE_A_BASE       0x43B0
+#define VIRT_RAM_DOSE_A_END        0x43C0
+#define VIRT_RAM_PULSE_MOD_A_BASE  0x43C0
+#define VIRT_RAM_PULSE_MOD_A_END   0x43D0
+#define VIRT_RAM_PULSE_MOD_B_BASE  0x43D0
+#define VIRT_RAM_PULSE_MOD_B_END   0x43E0
+#define VIRT_RAM_DOSE_B_BASE       0x43F0
+#define VIRT_RAM_DOSE_B_END        0x4400
+#define VIRT_RAM_POT_LOCKOUT       0x400F
+#define VIRT_RAM_MA_OFFSET         0x4061
+#define VIRT_RAM_LEVEL_A           0x4064
+#define VIRT_RAM_LEVEL_B           0x4065
+#define VIRT_RAM_MENU_STATE        0x406D
+#define VIRT_RAM_BOX_COMMAND       0x4070
+#define VIRT_RAM_CURRENT_MODE      0x407B
+#define VIRT_RAM_TOP_MODE          0x41F3
+#define VIRT_RAM_POWER_LEVEL       0x41F4
+#define VIRT_RAM_SPLIT_MODE_A      0x41F5
+#define VIRT_RAM_SPLIT_MODE_B      0x41F6
+#define VIRT_RAM_FAVOURITE         0x41F7
+#define VIRT_RAM_ADV_RAMP_LVL      0x41F8
+#define VIRT_RAM_ADV_RAMP_TIME     0x41F9
+#define VIRT_RAM_ADV_DEPTH         0x41FA
+#define VIRT_RAM_ADV_TEMPO         0x41FB
+#define VIRT_RAM_ADV_FREQUENCY     0x41FC
+#define VIRT_RAM_ADV_EFFECT        0x41FD
+#define VIRT_RAM_ADV_WIDTH         0x41FE
+#define VIRT_RAM_ADV_PACE          0x41FF
+#define VIRT_RAM_BATTERY_LEVEL     0x4203
+#define VIRT_RAM_MULTI_ADJUST      0x420D
+#define VIRT_RAM_BOX_KEY           0x4213
+#define VIRT_RAM_POWER_SUPPLY      0x4215
+#define VIRT_RAM_LCD_POS           0x4240
+#define VIRT_RAM_LCD_ARG           0x4241
+#define VIRT_RAM_LCD_CTRL          0x4242
+#define VIRT_RAM_LCD_PENDING       0x4243
+#define VIRT_RAM_TRACE_HEAD        0x4380
+#define VIRT_RAM_DEFER_DEPTH       0x4390
+#define VIRT_RAM_DEFER_PEAK        0x4391
+#define VIRT_RAM_DEFER_MERGED      0x4392
+#define VIRT_RAM_DEFER_DROPPED     0x4393
+#define VIRT_RAM_TX_REPLY_PEAK     0x4394
+#define VIRT_RAM_TX_REPLY_DROP     0x4395
+#define VIRT_RAM_TX_STREAM_SENT    0x4396
+#define VIRT_RAM_TX_STREAM_DROP    0x4397
+#define VIRT_RAM_MODE_XFADE        0x4398
+#define VIRT_RAM_MODE_SWITCHES     0x4399
+#define VIRT_RAM_RX_TIMEOUT        0x439A
+#define VIRT_RAM_RX_RESYNCS        0x439B
+#define VIRT_RAM_RX_BAD_CSUM       0x439C
+#define VIRT_RAM_RX_JUNK           0x439D
+#define VIRT_RAM_RX_OVERRUNS       0x439E
+#define VIRT_RAM_ENGINE_RATE       0x439F
+#define VIRT_RAM_SYNC_REF0         0x43A0
+#define VIRT_RAM_SYNC_REF1         0x43A1
+#define VIRT_RAM_SYNC_REF2         0x43A2
+#define VIRT_RAM_SYNC_REF3         0x43A3
+#define VIRT_RAM_SYNC_CTRL         0x43A4
+#define VIRT_RAM_SYNC_LATCH0       0x43A5
+#define VIRT_RAM_SYNC_LATCH1       0x43A6
+#define VIRT_RAM_SYNC_LATCH2       0x43A7
+#define VIRT_RAM_SYNC_LATCH3       0x43A8
+#define VIRT_RAM_SYNC_ERROR_LO     0x43A9
+#define VIRT_RAM_SYNC_ERROR_HI     0x43AA
+#define VIRT_RAM_SYNC_TRIM_LO      0x43AB
+#define VIRT_RAM_SYNC_TRIM_HI      0x43AC
+#define VIRT_RAM_SYNC_STEPS        0x43AD
+#define VIRT_RAM_DOSE_CTRL         0x43AF
+#define VIRT_RAM_AUDIO_A_LO        0x43E0
+#define VIRT_RAM_AUDIO_A_HI        0x43E1
+#define VIRT_RAM_AUDIO_B_LO        0x43E2
+#define VIRT_RAM_AUDIO_B_HI        0x43E3
+#define VIRT_RAM_AUDIO_FOLLOW      0x43E4
+#define VIRT_RAM_AUDIO_OVERLOAD    0x43E5
+
+/* EEPROM registers (offsets from VIRT_EEPROM_BASE) */
+#define VIRT_EE_PROVISIONED        0x0001
+#define VIRT_EE_BOX_SERIAL_LO      0x0002
+#define VIRT_EE_BOX_SERIAL_HI      0x0003
+#define VIRT_EE_ELINK_SIG1         0x0006
+#define VIRT_EE_ELINK_SIG2         0x0007
+#define VIRT_EE_TOP_MODE           0x0008
+#define VIRT_EE_POWER_LEVEL        0x0009
+#define VIRT_EE_SPLIT_MODE_A       0x000A
+#define VIRT_EE_SPLIT_MODE_B       0x000B
+#define VIRT_EE_FAVOURITE_MODE     0x000C
+#define VIRT_EE_ADV_RAMP_LEVEL     0x000D
+#define VIRT_EE_ADV_RAMP_TIME      0x000E
+#define VIRT_EE_ADV_DEPTH          0x000F
+#define VIRT_EE_ADV_TEMPO          0x0010
+#define VIRT_EE_ADV_FREQUENCY      0x0011
+#define VIRT_EE_ADV_EFFECT         0x0012
+#define VIRT_EE_ADV_WIDTH          0x0013
+#define VIRT_EE_ADV_PACE           0x0014
+
+/* Descriptor kinds */
+#define REG_KIND_NONE              0
+#define REG_KIND_CONST             1
+#define REG_KIND_RAM8              2
+#define REG_KIND_CFG               3
+#define REG_KIND_CFG_MODE          4
+#define REG_KIND_HANDLER           5
+#define REG_KIND_EEPROM            6
+
+/* Access rights */
+#define REG_ACC_R                  0x01
+#define REG_ACC_W                  0x02
+#define REG_ACC_BC                 0x04  /* reachable from mode bytecode */
+
+/* Side-effect handler ids (implemented in serial_mem.c) */
+enum {
+    REG_H_RAM_LEVEL_A,
+    REG_H_RAM_LEVEL_B,
+    REG_H_RAM_BOX_COMMAND,
+    REG_H_RAM_CURRENT_MODE,
+    REG_H_RAM_POWER_LEVEL,
+    REG_H_RAM_BATTERY_LEVEL,
+    REG_H_RAM_LCD_CTRL,
+    REG_H_RAM_LCD_PENDING,
+    REG_H_RAM_SYNC_CTRL,
+    REG_H_EE_POWER_LEVEL,
+    REG_H_RAM_TRACE_HEAD,
+    REG_H_RAM_DOSE_CTRL,
+    REG_H_COUNT
+};
+
+/* Decoded register. ptr is the byte to access for REG_KIND_RAM8; arg is
+ * the value (CONST), system_config_t offset (CFG, CFG_MODE) or handler id. */
+typedef struct {
+    uint8_t kind;
+    uint8_t access;
+    uint8_t arg;
+    void   *ptr;
+} reg_desc_t;
+
+uint8_t  regmap_decode(uint16_t addr, reg_desc_t *out);  /* Returns out->kind */
+uint8_t* regmap_bytecode_ptr(uint16_t addr);             /* NULL unless REG_ACC_BC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,3 +1,37 @@
+/*
+ * serial.c - ET-312 Serial Protocol Handler
+ *
+ * Interrupt-driven RX/TX rings at 19200 baud; frames are parsed and
+ * executed from serial_process() in the main loop.
+ *
+ * Legacy frames (SYNC, KEY_EXCHANGE, READ, WRITE) are answered one at a
+ * time exactly as on the original box. A host that reads
+ * VIRT_FLASH_PROTO_VERSION >= 2 may instead wrap READ/WRITE frames as
+ * [0x5A][seq][frame][checksum] and keep several in flight; each gets a
+ * tagged [0x5B] reply carrying the RX ring credit. Both forms can be
+ * mixed on the same link and share the same encryption.
+ *
+ * LCD_WRITE ([0x4C][pos][len][text][checksum], protocol version 3) puts
+ * up to a row of text into the LCD framebuffer in one frame, either form.
+ * Its length is only known at its third byte.
+ *
+ * TX has two lanes and never waits. Replies go to the TX ring, which the
+ * UDRE ISR serves first; serial_process() only starts a frame when the
+ * ring has room for its reply, so it never fills, and a byte that still
+ * finds it full is counted and dropped instead of stalling loop().
+ * Best-effort streams hand over one record at a time, sent from the
+ * producer's buffer between replies; a record offered while the last one
+ * is still going out is dropped and counted, which thins the stream to
+ * what the link carries.
+ *
+ * A byte lost or corrupted inside a frame would leave the parser waiting
+ * for the rest of it and then misread the next frame. When the line has
+ * been idle for serial_rx_stats.timeout_ms with a frame half received,
+ * the partial frame is dropped instead. The check runs only with the RX
+ * ring empty, so bytes that waited in the ring are never mistaken for a
+ * gap on the line.
+ */
+
 #include "serial.h"
 #include "serial_mem.h"
 #include <avr/interrupt.h>
@@ -5,6 +39,8 @@
 #include <stdbool.h>
 #include "MK312BT_Constants.h"
 #include "prng.h"
+#include "input_trace.h"
+#include "lcd_fb.h"
 
 extern unsigned long millis(void);
 
@@ -27,6 +63,13 @@ static volatile uint8_t tx_ring[TX_RING_SIZE];
 static volatile uint8_t tx_head = 0;
 static volatile uint8_t tx_tail = 0;
 
+static const uint8_t *volatile stream_ptr;     /* Next record byte, producer's buffer */
+static volatile uint8_t stream_left = 0;       /* Record bytes not sent yet */
+static volatile bool stream_on = false;        /* Record started: finish it before replies */
+
+serial_tx_stats_t serial_tx_stats;
+serial_rx_stats_t serial_rx_stats;
+
 /* =========================
    Protocol State
    ========================= */
@@ -34,7 +77,7 @@ static volatile uint8_t tx_tail = 0;
 static uint8_t encryption_key = 0x00;
 static bool encryption_enabled = false;
 
-static uint8_t rx_buffer[16];
+static uint8_t rx_buffer[SERIAL_RX_FRAME_MAX];
 static uint8_t rx_index = 0;
 static uint8_t expected_bytes = 0;
 static unsigned long rx_last_byte_ms = 0;
@@ -43,26 +86,83 @@ static unsigned long rx_last_byte_ms = 0;
    Interrupt Handlers
    ========================= */
 
+/*
+ * Both USART handlers re-enable interrupts as soon as their own source is
+ * masked, so the pulse timer compares can preempt them. ISR_NOBLOCK would
+ * set I before that: RXC and UDRE are level interrupts and would re-enter
+ * at once. Clearing RXCIE/UDRIE is the reentrancy guard; it is set again
+ * under cli() and takes effect after RETI. Main-line code never runs
+ * inside the window, and the timer ISRs do not touch this state. The
+ * INT0/INT1 audio handlers follow the same rule; only the pulse timer
+ * ISRs run with interrupts off from entry to RETI.
+ */
+
 ISR(USART_RXC_vect)
 {
-    uint8_t next = (rx_head + 1) % RX_RING_SIZE;
     uint8_t data = UDR;
+    UCSRB &= ~(1 << RXCIE);
+    sei();
 
+    uint8_t next = (rx_head + 1) % RX_RING_SIZE;
+    input_trace_log(INPUT_TRACE_RX, data);
     if (next != rx_tail) {
         rx_ring[rx_head] = data;
         rx_head = next;
+    } else if (serial_rx_stats.overruns != 0xFF) {
+        serial_rx_stats.overruns++;
     }
+
+    cli();
+    UCSRB |= (1 << RXCIE);
+}
+
+static bool tx_idle(void)
+{
+    return tx_head == tx_tail && stream_left == 0;
+}
+
+/* Replies first, but never inside a stream record */
+static uint8_t tx_next(void)
+{
+    if (stream_left != 0 && (stream_on || tx_head == tx_tail)) {
+        stream_on = --stream_left != 0;
+        return *stream_ptr++;
+    }
+
+    uint8_t data = tx_ring[tx_tail];
+    tx_tail = (tx_tail + 1) % TX_RING_SIZE;
+    return data;
 }
 
 ISR(USART_UDRE_vect)
 {
-    if (tx_head == tx_tail) {
-        UCSRB &= ~(1 << UDRIE);  // disable interrupt
+    UCSRB &= ~(1 << UDRIE);  // disable interrupt (stays off when idle)
+    if (tx_idle()) {
         return;
     }
+    sei();
 
-    UDR = tx_ring[tx_tail];
-    tx_tail = (tx_tail + 1) % TX_RING_SIZE;
+    UDR = tx_next();
+
+    cli();
+    UCSRB |= (1 << UDRIE);
+}
+
+/* =========================
+   Ring Occupancy
+   ========================= */
+
+/* Free bytes in the RX ring: the credit advertised in v2 replies */
+static uint8_t serial_rx_free(void)
+{
+    uint8_t used = (uint8_t)(rx_head - rx_tail) % RX_RING_SIZE;
+    return (RX_RING_SIZE - 1) - used;
+}
+
+static uint8_t serial_tx_free(void)
+{
+    uint8_t used = (uint8_t)(tx_head - tx_tail) % TX_RING_SIZE;
+    return (TX_RING_SIZE - 1) - used;
 }
 
 /* =========================
@@ -73,13 +173,17 @@ static void tx_enqueue(uint8_t data)
 {
     uint8_t next = (tx_head + 1) % TX_RING_SIZE;
 
-    while (next == tx_tail) {
-        // buffer full — wait (rare, but safe)
+    if (next == tx_tail) {
+        if (serial_tx_stats.reply_dropped != 0xFF) serial_tx_stats.reply_dropped++;
+        return;
     }
 
     tx_ring[tx_head] = data;
     tx_head = next;
 
+    uint8_t used = (uint8_t)(next - tx_tail) % TX_RING_SIZE;
+    if (used > serial_tx_stats.reply_peak) serial_tx_stats.reply_peak = used;
+
     UCSRB |= (1 << UDRIE);  // enable TX interrupt
 }
 
@@ -88,6 +192,27 @@ void serial_send_byte(uint8_t data)
     tx_enqueue(data);
 }
 
+bool serial_send_stream(const uint8_t *data, uint8_t len)
+{
+    if (len == 0) return true;
+    if (stream_left != 0) {
+        if (serial_tx_stats.stream_dropped != 0xFF) serial_tx_stats.stream_dropped++;
+        return false;
+    }
+
+    stream_ptr = data;
+    stream_left = len;      /* Publishes the record to the ISR */
+    serial_tx_stats.stream_sent++;
+
+    UCSRB |= (1 << UDRIE);  // enable TX interrupt
+    return true;
+}
+
+bool serial_stream_busy(void)
+{
+    return stream_left != 0;
+}
+
 static void serial_send_buffer(uint8_t *data, uint8_t len)
 {
     for (uint8_t i = 0; i < len; i++) {
@@ -149,15 +274,70 @@ static void serial_handle_read(uint16_t address)
     serial_send_buffer(response, 3);
 }
 
-static void serial_handle_write(uint16_t address, uint8_t length)
+static void serial_write_data(uint16_t address, const uint8_t *data, uint8_t length)
 {
     for (uint8_t i = 0; i < length; i++) {
-        serial_mem_write(address + i, rx_buffer[3 + i]);
+        serial_mem_write(address + i, data[i]);
     }
+}
 
+static void serial_handle_write(uint16_t address, uint8_t length)
+{
+    serial_write_data(address, &rx_buffer[3], length);
     serial_send_byte(SERIAL_REPLY_OK);
 }
 
+/* v2 reply: [0x5B][seq][status][value][credit][checksum].
+ * credit is the RX ring free space after this frame was consumed; the
+ * host keeps its unacknowledged bytes below the last credit it saw. */
+static void serial_v2_reply(uint8_t seq, uint8_t status, uint8_t value)
+{
+    uint8_t response[SERIAL_V2_REPLY_LEN];
+    response[0] = SERIAL_V2_REPLY;
+    response[1] = seq;
+    response[2] = status;
+    response[3] = value;
+    response[4] = serial_rx_free();
+    response[5] = serial_calculate_checksum(response, SERIAL_V2_REPLY_LEN);
+
+    serial_send_buffer(response, SERIAL_V2_REPLY_LEN);
+}
+
+/* Execute the legacy READ/WRITE frame carried inside a v2 frame.
+ * frame points at the legacy opcode, after [0x5A][seq]. */
+static void serial_v2_execute(uint8_t seq, const uint8_t *frame)
+{
+    uint8_t cmd = frame[0];
+    uint16_t addr = ((uint16_t)frame[1] << 8) | frame[2];
+
+    if (cmd == SERIAL_CMD_READ) {
+        serial_v2_reply(seq, SERIAL_REPLY_READ, serial_mem_read(addr));
+    }
+    else if (cmd == SERIAL_CMD_LCD_WRITE) {
+        lcd_fb_write(frame[1], &frame[3], frame[2]);
+        serial_v2_reply(seq, SERIAL_REPLY_OK, 0);
+    }
+    else {
+        serial_write_data(addr, &frame[3], (cmd >> 4) - 3);
+        serial_v2_reply(seq, SERIAL_REPLY_OK, 0);
+    }
+}
+
+/* Total length of a legacy frame (opcode through checksum), or 0 if the
+ * byte does not start one. WRITE needs len >= 3 (opcode + address).
+ * LCD_WRITE gives its header; the length byte extends it. */
+static uint8_t serial_frame_length(uint8_t cmd)
+{
+    if ((cmd & 0x0F) == SERIAL_CMD_WRITE) {
+        uint8_t len = cmd >> 4;
+        return (len >= 3) ? len + 1 : 0;
+    }
+    if (cmd == SERIAL_CMD_READ) return 4;
+    if (cmd == SERIAL_CMD_KEY_EXCHANGE) return 3;
+    if (cmd == SERIAL_CMD_LCD_WRITE) return 4;
+    return 0;
+}
+
 /* =========================
    Public API
    ========================= */
@@ -169,12 +349,31 @@ void serial_init(void)
     rx_index = 0;
     expected_bytes = 0;
     rx_last_byte_ms = 0;
+    serial_rx_stats.timeout_ms = SERIAL_PACKET_TIMEOUT_MS;
+}
+
+static void rx_count(uint8_t *counter)
+{
+    if (*counter != 0xFF) (*counter)++;
 }
 
 void serial_process(void)
 {
+    if (rx_index != 0 && rx_head == rx_tail && serial_rx_stats.timeout_ms &&
+        millis() - rx_last_byte_ms >= serial_rx_stats.timeout_ms) {
+        rx_index = 0;
+        expected_bytes = 0;
+        rx_count(&serial_rx_stats.resyncs);
+    }
+
     while (rx_head != rx_tail) {
 
+        /* Don't start a frame whose reply could block on a full TX ring;
+         * the bytes stay queued and the shrinking credit throttles a v2 host. */
+        if (rx_index == 0 && serial_tx_free() < SERIAL_V2_REPLY_LEN) {
+            break;
+        }
+
         uint8_t raw_byte = rx_ring[rx_tail];
         rx_tail = (rx_tail + 1) % RX_RING_SIZE;
 
@@ -194,6 +393,7 @@ void serial_process(void)
         if (rx_index >= sizeof(rx_buffer)) {
             rx_index = 0;
             expected_bytes = 0;
+            rx_count(&serial_rx_stats.junk);
             serial_send_byte(SERIAL_REPLY_ERROR);
             continue;
         }
@@ -201,45 +401,77 @@ void serial_process(void)
         rx_buffer[rx_index++] = received;
 
         if (rx_index == 1) {
-            uint8_t cmd = rx_buffer[0];
-
-            if ((cmd & 0x0F) == SERIAL_CMD_WRITE) {
-                uint8_t len = (cmd >> 4);
-                expected_bytes = len + 1;
+            if (received == SERIAL_V2_FRAME) {
+                expected_bytes = 0;             /* length known after opcode */
+                continue;
             }
-            else if (cmd == SERIAL_CMD_READ) {
-                expected_bytes = 4;
+
+            expected_bytes = serial_frame_length(received);
+            if (expected_bytes == 0) {
+                rx_index = 0;
+                rx_count(&serial_rx_stats.junk);
+                continue;
             }
-            else if (cmd == SERIAL_CMD_KEY_EXCHANGE) {
-                expected_bytes = 3;
+        }
+        else if (rx_index == 3 && rx_buffer[0] == SERIAL_V2_FRAME) {
+            uint8_t len = serial_frame_length(received);
+
+            if (len == 0 || received == SERIAL_CMD_KEY_EXCHANGE) {
+                serial_v2_reply(rx_buffer[1], SERIAL_REPLY_ERROR, 0);
+                rx_index = 0;
+                rx_count(&serial_rx_stats.junk);
+                continue;
             }
-            else {
+            expected_bytes = len + SERIAL_V2_HEADER_LEN;
+        }
+
+        uint8_t at = (rx_buffer[0] == SERIAL_V2_FRAME) ? SERIAL_V2_HEADER_LEN : 0;
+        if (rx_index == at + 3 && rx_buffer[at] == SERIAL_CMD_LCD_WRITE) {
+            if (received == 0 || received > SERIAL_LCD_WRITE_MAX) {
+                if (at) {
+                    serial_v2_reply(rx_buffer[1], SERIAL_REPLY_ERROR, 0);
+                } else {
+                    serial_send_byte(SERIAL_REPLY_ERROR);
+                }
                 rx_index = 0;
                 expected_bytes = 0;
+                rx_count(&serial_rx_stats.junk);
                 continue;
             }
+            expected_bytes = at + 4 + received;
         }
 
         if (expected_bytes > 0 && rx_index >= expected_bytes) {
 
             uint8_t checksum = serial_calculate_checksum(rx_buffer, expected_bytes);
+            uint8_t cmd = rx_buffer[0];
 
             if (checksum != rx_buffer[expected_bytes - 1]) {
-                serial_send_byte(SERIAL_REPLY_ERROR);
+                rx_count(&serial_rx_stats.bad_checksum);
+                if (cmd == SERIAL_V2_FRAME) {
+                    serial_v2_reply(rx_buffer[1], SERIAL_REPLY_ERROR, 0);
+                } else {
+                    serial_send_byte(SERIAL_REPLY_ERROR);
+                }
                 rx_index = 0;
                 expected_bytes = 0;
                 continue;
             }
 
-            uint8_t cmd = rx_buffer[0];
-
-            if (cmd == SERIAL_CMD_KEY_EXCHANGE) {
+            if (cmd == SERIAL_V2_FRAME) {
+                serial_v2_execute(rx_buffer[1], &rx_buffer[SERIAL_V2_HEADER_LEN]);
+            }
+            else if (cmd == SERIAL_CMD_KEY_EXCHANGE) {
                 serial_handle_key_exchange(rx_buffer[1]);
             }
             else if (cmd == SERIAL_CMD_READ) {
                 uint16_t addr = ((uint16_t)rx_buffer[1] << 8) | rx_buffer[2];
                 serial_handle_read(addr);
             }
+            else if (cmd == SERIAL_CMD_LCD_WRITE) {
+                lcd_fb_write(rx_buffer[1], &rx_buffer[3], rx_buffer[2]);
+                serial_send_byte(SERIAL_REPLY_OK);
+            }
             else if ((cmd & 0x0F) == SERIAL_CMD_WRITE) {
                 uint16_t addr = ((uint16_t)rx_buffer[1] << 8) | rx_buffer[2];
                 uint8_t data_len = (cmd >> 4) - 3;
@@ -22,6 +22,7 @@ extern "C" {
 #define SERIAL_CMD_READ         0x3C  /* Read one byte from address */
 #define SERIAL_CMD_WRITE        0x0D  /* Write bytes to address (low nibble) */
 #define SERIAL_CMD_KEY_EXCHANGE 0x2F  /* Initiate encryption key exchange */
+#define SERIAL_CMD_LCD_WRITE    0x4C  /* [0x4C][pos][len][text...][checksum] (lcd_fb.h) */
 
 /* Reply opcodes (sent by device) */
 #define SERIAL_REPLY_SYNC         0x07  /* Handshake sync acknowledgment */
@@ -30,21 +31,61 @@ extern "C" {
 #define SERIAL_REPLY_OK           0x06  /* Command acknowledged successfully */
 #define SERIAL_REPLY_ERROR        0x07  /* Checksum mismatch or error */
 
+/* Protocol v2: pipelined, tagged READ/WRITE (see SERIAL_PROTOCOL.md) */
+#define SERIAL_PROTOCOL_VERSION   0x03  /* Reported at VIRT_FLASH_PROTO_VERSION (3: LCD_WRITE) */
+#define SERIAL_V2_FRAME           0x5A  /* [0x5A][seq][READ/WRITE frame w/o checksum][checksum] */
+#define SERIAL_V2_REPLY           0x5B  /* [0x5B][seq][status][value][credit][checksum] */
+#define SERIAL_V2_HEADER_LEN      2     /* 0x5A + seq */
+#define SERIAL_V2_REPLY_LEN       6
+#define SERIAL_LCD_WRITE_MAX      16    /* Characters per LCD_WRITE frame */
+#define SERIAL_RX_FRAME_MAX       (4 + SERIAL_LCD_WRITE_MAX + SERIAL_V2_HEADER_LEN)  /* Largest LCD_WRITE, v2-wrapped */
+
 /* Protocol constants */
 #define SERIAL_EXTRA_ENCRYPT_KEY    0x55  /* XOR key mixed into encryption derivation */
-#define SERIAL_PACKET_TIMEOUT_MS    500   /* Timeout for incomplete packets (ms) */
+#define SERIAL_PACKET_TIMEOUT_MS    100   /* Default inter-byte timeout for partial frames (ms, max 255) */
 #define SERIAL_MAX_BYTES_PER_POLL   32    /* Max bytes to process per serial_process() call */
 #define SERIAL_MODE_PROTOCOL_BASE   0x76  /* Offset mapping internal mode index to protocol mode number */
 
 void serial_init(void);                                         /* Initialize serial state */
 void serial_process(void);                                      /* Poll USART and process packets */
-void serial_send_byte(uint8_t data);                           /* Transmit one byte (blocking) */
+void serial_send_byte(uint8_t data);                           /* Queue one reply byte (never waits) */
+
+/* Best-effort stream lane: sends one record between replies, straight
+ * from data, which must stay unchanged until serial_stream_busy() is
+ * false. A record offered while the last one is still going out is
+ * dropped and false returned. Records are sent as given, unencrypted, so
+ * they must be self-delimiting and only sent to a host that asked. */
+bool serial_send_stream(const uint8_t *data, uint8_t len);
+bool serial_stream_busy(void);                                 /* Last record still going out */
 uint8_t serial_calculate_checksum(uint8_t *data, uint8_t length); /* Compute packet checksum */
 void serial_handle_read_command(uint16_t address);             /* Process READ request */
 void serial_handle_write_command(uint16_t address, uint8_t length); /* Process WRITE request */
 void serial_handle_key_exchange(uint8_t host_key);             /* Process KEY_EXCHANGE request */
 void serial_set_encryption_key(uint8_t box_key, uint8_t host_key); /* Derive shared XOR key */
 
+/* TX lane statistics, readable at 0x4394-0x4397 */
+typedef struct {
+    uint8_t reply_peak;     /* Highest TX ring occupancy (bytes) */
+    uint8_t reply_dropped;  /* Reply bytes lost to a full ring (saturates, should stay 0) */
+    uint8_t stream_sent;    /* Stream records accepted (wraps) */
+    uint8_t stream_dropped; /* Stream records dropped, lane busy (saturates) */
+} serial_tx_stats_t;
+
+extern serial_tx_stats_t serial_tx_stats;
+
+/* RX parser, readable at 0x439A-0x439E. A partial frame is dropped when
+ * the line has been idle for timeout_ms, so the next frame parses from
+ * its first byte. Counters saturate; write 0 to reset. */
+typedef struct {
+    uint8_t timeout_ms;     /* Inter-byte timeout, 0 = off */
+    uint8_t resyncs;        /* Partial frames dropped by the timeout */
+    uint8_t bad_checksum;   /* Complete frames with a wrong checksum */
+    uint8_t junk;           /* Bytes that start no frame, oversize frames */
+    uint8_t overruns;       /* Bytes lost to a full RX ring */
+} serial_rx_stats_t;
+
+extern serial_rx_stats_t serial_rx_stats;
+
 
 #ifdef __cplusplus
 }
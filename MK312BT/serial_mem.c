@@ -8,9 +8,15 @@
  *
  * RAM addresses in the 0x4080-0x40BF range map to channel_a registers.
  * RAM addresses in the 0x4180-0x41BF range map to channel_b registers.
+ *
+ * Address decoding is table driven: regmap_decode() (register_map.c,
+ * generated from Host/tools/register_map.def) returns a descriptor and
+ * this file only implements what each descriptor kind does, plus the
+ * handlers for registers with side effects.
  */
 
 #include "serial_mem.h"
+#include "register_map.h"
 #include "serial.h"
 #include "MK312BT_Memory.h"
 #include "MK312BT_Constants.h"
@@ -21,6 +27,11 @@
 #include "mode_dispatcher.h"
 #include "lcd.h"
 #include "adc.h"
+#include "input_trace.h"
+#include "tick_sync.h"
+#include "pulse_gen.h"
+#include "lcd_fb.h"
+#include "menu.h"
 #include <string.h>
 
 static uint8_t mode_to_protocol(uint8_t mode) {
@@ -33,196 +44,76 @@ static uint8_t protocol_to_mode(uint8_t proto) {
     return (m < MODE_COUNT) ? m : 0;
 }
 
-static uint8_t read_flash(uint16_t address) {
-    switch (address) {
-        case VIRT_FLASH_BOX_MODEL: return BOX_MODEL_MK312BT;
-        case VIRT_FLASH_FW_MAJ:   return FIRMWARE_VER_MAJ;
-        case VIRT_FLASH_FW_MIN:   return FIRMWARE_VER_MIN;
-        case VIRT_FLASH_FW_INT:   return FIRMWARE_VER_INT;
-        default:                  return 0x00;
-    }
-}
-
-static uint8_t read_eeprom_region(uint16_t address) {
-    uint16_t offset = address - VIRT_EEPROM_BASE;
-    system_config_t* cfg = config_get();
-
-    switch (offset) {
-        case VIRT_EE_PROVISIONED:    return 0x55;
-        case VIRT_EE_BOX_SERIAL_LO:  return 0x01;
-        case VIRT_EE_BOX_SERIAL_HI:  return 0x00;
-        case VIRT_EE_ELINK_SIG1:     return 0x01;
-        case VIRT_EE_ELINK_SIG2:     return 0x01;
-        case VIRT_EE_TOP_MODE:       return mode_to_protocol(cfg->current_mode);
-        case VIRT_EE_POWER_LEVEL:    return cfg->power_level;
-        case VIRT_EE_SPLIT_MODE_A:   return mode_to_protocol(cfg->split_a_mode);
-        case VIRT_EE_SPLIT_MODE_B:   return mode_to_protocol(cfg->split_b_mode);
-        case VIRT_EE_FAVOURITE_MODE: return mode_to_protocol(cfg->favorite_mode);
-        case VIRT_EE_ADV_RAMP_LEVEL: return cfg->adv_ramp_level;
-        case VIRT_EE_ADV_RAMP_TIME:  return cfg->adv_ramp_time;
-        case VIRT_EE_ADV_DEPTH:      return cfg->adv_depth;
-        case VIRT_EE_ADV_TEMPO:      return cfg->adv_tempo;
-        case VIRT_EE_ADV_FREQUENCY:  return cfg->adv_frequency;
-        case VIRT_EE_ADV_EFFECT:     return cfg->adv_effect;
-        case VIRT_EE_ADV_WIDTH:      return cfg->adv_width;
-        case VIRT_EE_ADV_PACE:       return cfg->adv_pace;
-        default:
-            return mk312bt_eeprom_read_byte(offset);
-    }
-}
-
-static void write_eeprom_region(uint16_t address, uint8_t value) {
-    uint16_t offset = address - VIRT_EEPROM_BASE;
-    system_config_t* cfg = config_get();
-
-    switch (offset) {
-        case VIRT_EE_TOP_MODE:
-            cfg->current_mode = protocol_to_mode(value);
-            break;
-        case VIRT_EE_POWER_LEVEL:
-            if (value <= 2) cfg->power_level = value;
-            break;
-        case VIRT_EE_SPLIT_MODE_A:
-            cfg->split_a_mode = protocol_to_mode(value);
-            break;
-        case VIRT_EE_SPLIT_MODE_B:
-            cfg->split_b_mode = protocol_to_mode(value);
-            break;
-        case VIRT_EE_FAVOURITE_MODE:
-            cfg->favorite_mode = protocol_to_mode(value);
-            break;
-        case VIRT_EE_ADV_RAMP_LEVEL: cfg->adv_ramp_level = value; break;
-        case VIRT_EE_ADV_RAMP_TIME:  cfg->adv_ramp_time = value; break;
-        case VIRT_EE_ADV_DEPTH:      cfg->adv_depth = value; break;
-        case VIRT_EE_ADV_TEMPO:      cfg->adv_tempo = value; break;
-        case VIRT_EE_ADV_FREQUENCY:  cfg->adv_frequency = value; break;
-        case VIRT_EE_ADV_EFFECT:     cfg->adv_effect = value; break;
-        case VIRT_EE_ADV_WIDTH:      cfg->adv_width = value; break;
-        case VIRT_EE_ADV_PACE:       cfg->adv_pace = value; break;
-        case VIRT_EE_PROVISIONED:
-        case VIRT_EE_ELINK_SIG1:
-        case VIRT_EE_ELINK_SIG2:
-            break;
-        default:
-            if (offset >= sizeof(eeprom_config_t))
-                mk312bt_eeprom_write_byte(offset, value);
-            break;
-    }
-}
-
 static void execute_box_command(uint8_t cmd);
 static uint8_t last_box_command = 0xFF;
 
-static uint8_t read_ram(uint16_t address) {
+/* Registers whose access has side effects or needs computation.
+ * Ids and addresses come from register_map.def. */
+static uint8_t handler_read(uint8_t id) {
     system_config_t* cfg = config_get();
 
-    if (address >= VIRT_RAM_CHAN_A_BASE && address < VIRT_RAM_CHAN_A_END) {
-        uint8_t offset = address - VIRT_RAM_CHAN_A_BASE;
-        return ((uint8_t*)&channel_a)[offset];
-    }
-    if (address >= VIRT_RAM_CHAN_B_BASE && address < VIRT_RAM_CHAN_B_END) {
-        uint8_t offset = address - VIRT_RAM_CHAN_B_BASE;
-        return ((uint8_t*)&channel_b)[offset];
-    }
-
-    switch (address) {
-        case VIRT_RAM_LEVEL_A:
-            return (uint8_t)(adc_read_level_a() >> 2);
-        case VIRT_RAM_LEVEL_B:
-            return (uint8_t)(adc_read_level_b() >> 2);
-
-        case VIRT_RAM_BOX_COMMAND: return last_box_command;
-        case VIRT_RAM_POT_LOCKOUT:  return *POT_LOCKOUT_FLAGS;
-        case VIRT_RAM_MENU_STATE:   return 0x02;
-        case VIRT_RAM_CURRENT_MODE: return mode_to_protocol(cfg->current_mode);
-
-        case VIRT_RAM_TOP_MODE:     return mode_to_protocol(cfg->current_mode);
-        case VIRT_RAM_POWER_LEVEL:  return cfg->power_level+1;
-        case VIRT_RAM_SPLIT_MODE_A: return mode_to_protocol(cfg->split_a_mode);
-        case VIRT_RAM_SPLIT_MODE_B: return mode_to_protocol(cfg->split_b_mode);
-        case VIRT_RAM_FAVOURITE:    return mode_to_protocol(cfg->favorite_mode);
-        case VIRT_RAM_ADV_RAMP_LVL: return cfg->adv_ramp_level;
-        case VIRT_RAM_ADV_RAMP_TIME:return cfg->adv_ramp_time;
-        case VIRT_RAM_ADV_DEPTH:    return cfg->adv_depth;
-        case VIRT_RAM_ADV_TEMPO:    return cfg->adv_tempo;
-        case VIRT_RAM_ADV_FREQUENCY:return cfg->adv_frequency;
-        case VIRT_RAM_ADV_EFFECT:   return cfg->adv_effect;
-        case VIRT_RAM_ADV_WIDTH:    return cfg->adv_width;
-        case VIRT_RAM_ADV_PACE:     return cfg->adv_pace;
-        case VIRT_RAM_BATTERY_LEVEL: { uint16_t battery = adc_read_battery();
+    switch (id) {
+        case REG_H_RAM_LEVEL_A:      return (uint8_t)(adc_read_level_a() >> 2);
+        case REG_H_RAM_LEVEL_B:      return (uint8_t)(adc_read_level_b() >> 2);
+        case REG_H_RAM_BOX_COMMAND:  return last_box_command;
+        case REG_H_RAM_CURRENT_MODE: return mode_to_protocol(cfg->current_mode);
+        case REG_H_RAM_POWER_LEVEL:  return cfg->power_level+1;
+        case REG_H_EE_POWER_LEVEL:   return cfg->power_level;
+        case REG_H_RAM_SYNC_CTRL:    return tick_sync_regs.status;
+        case REG_H_RAM_LCD_CTRL:     return lcd_fb_owned() ? LCD_FB_CTRL_HOST : 0;
+        case REG_H_RAM_LCD_PENDING:  return lcd_fb_pending();
+        case REG_H_RAM_BATTERY_LEVEL: { uint16_t battery = adc_read_battery();
                                        return (battery > BATTERY_ADC_EMPTY) ? ((battery - BATTERY_ADC_EMPTY) * 100) / BATTERY_ADC_RANGE : 0; }
-        case VIRT_RAM_MA_OFFSET:    return *MULTI_ADJUST_OFFSET;
-        case VIRT_RAM_MULTI_ADJUST: return *MULTI_ADJUST; 
-        case VIRT_RAM_BOX_KEY:      return 0x00;
-        case VIRT_RAM_POWER_SUPPLY: return 0x02;
-
-        default: return 0x00;
+#if INPUT_TRACE_ENABLE
+        case REG_H_RAM_TRACE_HEAD:   return input_trace_head;
+#endif
+        default:                     return 0x00;
     }
 }
 
-static void write_ram(uint16_t address, uint8_t value) {
+static void handler_write(uint8_t id, uint8_t value) {
     system_config_t* cfg = config_get();
 
-    if (address >= VIRT_RAM_CHAN_A_BASE && address < VIRT_RAM_CHAN_A_END) {
-        uint8_t offset = address - VIRT_RAM_CHAN_A_BASE;
-        ((uint8_t*)&channel_a)[offset] = value;
-        return;
-    }
-    if (address >= VIRT_RAM_CHAN_B_BASE && address < VIRT_RAM_CHAN_B_END) {
-        uint8_t offset = address - VIRT_RAM_CHAN_B_BASE;
-        ((uint8_t*)&channel_b)[offset] = value;
-        return;
-    }
-
-    switch (address) {
-        case VIRT_RAM_BOX_COMMAND:
+    switch (id) {
+        case REG_H_RAM_BOX_COMMAND:
             last_box_command = value;
             execute_box_command(value);
             last_box_command = 0xFF;
             break;
 
-        case VIRT_RAM_CURRENT_MODE:
-            cfg->current_mode = protocol_to_mode(value);
+        case REG_H_RAM_CURRENT_MODE:
+            config_set(CONFIG_FIELD(current_mode), protocol_to_mode(value));
             mode_dispatcher_request_mode(cfg->current_mode);
             break;
 
-        case VIRT_RAM_POT_LOCKOUT:
-            *POT_LOCKOUT_FLAGS = value;
-            break;
-
-        case VIRT_RAM_POWER_LEVEL:
-            if (value <= 2) cfg->power_level = value;
+        case REG_H_RAM_POWER_LEVEL:
+            if (value <= 2) config_set(CONFIG_FIELD(power_level), value);
             *POWER_LEVEL_CONFIG = value;
             break;
 
-        case VIRT_RAM_SPLIT_MODE_A:
-            cfg->split_a_mode = protocol_to_mode(value);
+        case REG_H_EE_POWER_LEVEL:
+            if (value <= 2) {
+                config_set(CONFIG_FIELD(power_level), value);
+                config_commit(CONFIG_FIELD(power_level));
+            }
             break;
 
-        case VIRT_RAM_SPLIT_MODE_B:
-            cfg->split_b_mode = protocol_to_mode(value);
+        case REG_H_RAM_SYNC_CTRL:
+            tick_sync_control(value);
             break;
 
-        case VIRT_RAM_FAVOURITE:
-            cfg->favorite_mode = protocol_to_mode(value);
+#if DOSE_METER_ENABLE
+        case REG_H_RAM_DOSE_CTRL:
+            pulse_dose_control(value);
             break;
+#endif
 
-        case VIRT_RAM_ADV_RAMP_LVL: cfg->adv_ramp_level = value; break;
-        case VIRT_RAM_ADV_RAMP_TIME:cfg->adv_ramp_time = value; break;
-        case VIRT_RAM_ADV_DEPTH:    cfg->adv_depth = value; break;
-        case VIRT_RAM_ADV_TEMPO:    cfg->adv_tempo = value; break;
-        case VIRT_RAM_ADV_FREQUENCY:cfg->adv_frequency = value; break;
-        case VIRT_RAM_ADV_EFFECT:   cfg->adv_effect = value; break;
-        case VIRT_RAM_ADV_WIDTH:    cfg->adv_width = value; break;
-        case VIRT_RAM_ADV_PACE:     cfg->adv_pace = value; break;
-
-        case VIRT_RAM_MULTI_ADJUST:
-         //   *MULTI_ADJUST_VALUE = value;
-            //cfg->multi_adjust = value;
+        case REG_H_RAM_LCD_CTRL:
+            lcd_fb_control(value);
             break;
 
-        case VIRT_RAM_BOX_KEY:
-            //if (value == 0) serial_reset_encryption();
+        case REG_H_RAM_TRACE_HEAD:   /* Any write restarts the trace */
+            input_trace_clear();
             break;
 
         default:
@@ -238,6 +129,7 @@ static void execute_box_command(uint8_t cmd) {
 
         case BOX_CMD_EXIT_MENU:
         case BOX_CMD_MAIN_MENU:
+            lcd_fb_release();
             break;
 
         case BOX_CMD_MUTE:
@@ -256,10 +148,27 @@ static void execute_box_command(uint8_t cmd) {
             mode_dispatcher_request_reload();
             break;
 
+        /* LCD commands take their argument from LCD_ARG and write at
+         * LCD_POS; the text reaches the panel from the main loop */
         case BOX_CMD_LCD_WRITE_CHAR:
+            lcd_fb_put(lcd_fb.arg);
+            break;
+
         case BOX_CMD_LCD_WRITE_NUM:
-        case BOX_CMD_LCD_WRITE_STR:
+            lcd_fb_put_number(lcd_fb.arg);
+            break;
+
+        case BOX_CMD_LCD_WRITE_STR: {   /* Name of mode LCD_ARG (0x76-) */
+            char name[9];
+            if (lcd_fb.arg < SERIAL_MODE_PROTOCOL_BASE ||
+                lcd_fb.arg - SERIAL_MODE_PROTOCOL_BASE >= MODE_COUNT) break;
+            menuGetModeName(name, lcd_fb.arg - SERIAL_MODE_PROTOCOL_BASE);
+            for (const char* p = name; *p; p++) lcd_fb_put((uint8_t)*p);
+            break;
+        }
+
         case BOX_CMD_LCD_SET_POS:
+            lcd_fb.pos = lcd_fb.arg & (LCD_FB_SIZE - 1);
             break;
 
         case BOX_CMD_START_RAMP:
@@ -288,23 +197,48 @@ static void execute_box_command(uint8_t cmd) {
 }
 
 uint8_t serial_mem_read(uint16_t address) {
-    if (address < VIRT_FLASH_END) {
-        return read_flash(address);
-    }
-    else if (address >= VIRT_RAM_BASE && address < VIRT_RAM_END) {
-        return read_ram(address);
-    }
-    else if (address >= VIRT_EEPROM_BASE && address < VIRT_EEPROM_END) {
-        return read_eeprom_region(address);
+    reg_desc_t reg;
+
+    switch (regmap_decode(address, &reg)) {
+        case REG_KIND_CONST:    return reg.arg;
+        case REG_KIND_RAM8:     return *(volatile uint8_t*)reg.ptr;
+        case REG_KIND_CFG:      return ((uint8_t*)config_get())[reg.arg];
+        case REG_KIND_CFG_MODE: return mode_to_protocol(((uint8_t*)config_get())[reg.arg]);
+        case REG_KIND_HANDLER:  return handler_read(reg.arg);
+        case REG_KIND_EEPROM:   return mk312bt_eeprom_read_byte(address - VIRT_EEPROM_BASE);
+        default:                return 0x00;
     }
-    return 0x00;
 }
 
 void serial_mem_write(uint16_t address, uint8_t value) {
-    if (address >= VIRT_RAM_BASE && address < VIRT_RAM_END) {
-        write_ram(address, value);
-    }
-    else if (address >= VIRT_EEPROM_BASE && address < VIRT_EEPROM_END) {
-        write_eeprom_region(address, value);
+    reg_desc_t reg;
+    uint16_t offset;
+
+    regmap_decode(address, &reg);
+    if (!(reg.access & REG_ACC_W)) return;
+
+    switch (reg.kind) {
+        case REG_KIND_RAM8:
+            *(volatile uint8_t*)reg.ptr = value;
+            break;
+        case REG_KIND_CFG:
+        case REG_KIND_CFG_MODE:
+            /* RAM registers change the live setting; EEPROM registers
+             * also commit it, as on the original box, one byte per tick
+             * from the main loop */
+            config_set(reg.arg, reg.kind == REG_KIND_CFG_MODE ? protocol_to_mode(value) : value);
+            if (address >= VIRT_EEPROM_BASE) config_commit(reg.arg);
+            break;
+        case REG_KIND_HANDLER:
+            handler_write(reg.arg, value);
+            break;
+        case REG_KIND_EEPROM:
+            /* The settings block is owned by config_save() */
+            offset = address - VIRT_EEPROM_BASE;
+            if (offset >= EEPROM_CONFIG_END)
+                mk312bt_eeprom_write_byte(offset, value);
+            break;
+        default:
+            break;
     }
 }
@@ -0,0 +1,334 @@
+/*
+ * session_rec.c - Live Session Recorder and Session Mode Playback
+ *
+ * Recording samples the six output values every SESSION_REC_TICKS_PER_FRAME
+ * engine ticks and encodes each frame against the previous one (see the
+ * token format in session_rec.h). Encoded bytes go through a small RAM
+ * queue and are written to EEPROM one byte per tick without waiting, so
+ * the main loop never stalls on the ~8.5 ms EEPROM write time. When the
+ * queue is full a changed frame is coded as a repeat instead: timing is
+ * kept and the values catch up on the next frame that fits.
+ *
+ * Closing a recording (stop or full) emits the pending repeat, drains the
+ * queue, then writes the header with the magic byte last.
+ *
+ * Recording and playback share the frame buffer; selecting MODE_SESSION
+ * stops a running recording first.
+ */
+
+#include "session_rec.h"
+#include "eeprom.h"
+#include "channel_mem.h"
+#include "MK312BT_Constants.h"
+#include <avr/wdt.h>
+#include <string.h>
+
+#define FRAME_VALUES    6
+#define RUN_MAX         128     /* Longest repeat one token can hold */
+
+#define TOK_DELTA       0x80
+#define TOK_ABSOLUTE    0xC0
+
+static uint8_t valid;                   /* Stored header passed its checks */
+static uint8_t status;                  /* SESSION_REC_* */
+static uint8_t closing;                 /* Draining before the header write */
+static uint8_t close_status;            /* Status once closing completes */
+static uint8_t frame[FRAME_VALUES];     /* Last frame coded or decoded */
+static uint8_t tick_div;
+
+/* Recorder */
+static uint8_t run;                     /* Repeats not yet emitted */
+static uint8_t used;                    /* Data bytes emitted */
+static uint8_t written;                 /* Data bytes already in EEPROM */
+static uint8_t header_step;
+static uint8_t checksum;
+static uint8_t queue[SESSION_REC_QUEUE];
+static uint8_t q_head;
+static uint8_t q_count;
+
+/* Playback */
+static uint8_t play_len;
+static uint8_t play_pos;
+static uint8_t play_rep;
+static uint8_t play_div;
+
+void session_rec_init(void) {
+    valid = 0;
+    status = SESSION_REC_IDLE;
+    closing = 0;
+
+    if (mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE) != SESSION_MAGIC) return;
+    uint8_t div = mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE + 1);
+    uint8_t len = mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE + 2);
+    uint8_t sum = mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE + 3);
+    if (div == 0 || len == 0 || len > SESSION_DATA_SIZE) return;
+
+    for (uint8_t i = 0; i < len; i++) {
+        sum ^= mk312bt_eeprom_read_byte(EEPROM_SESSION_DATA + i);
+    }
+    valid = (sum == 0);
+}
+
+uint8_t session_rec_is_valid(void) {
+    return valid;
+}
+
+uint8_t session_rec_status(void) {
+    return status;
+}
+
+uint8_t session_rec_bytes_used(void) {
+    return used;
+}
+
+/* ---- Recorder ---- */
+
+static uint8_t effective_intensity(const ChannelBlock *ch) {
+    if (!(ch->gate_value & GATE_ON_BIT)) return 0;
+    return (uint8_t)(((uint16_t)ch->intensity_value * ch->ramp_value) >> 8);
+}
+
+static void put(uint8_t b) {
+    queue[(q_head + q_count) & (SESSION_REC_QUEUE - 1)] = b;
+    q_count++;
+    used++;
+    checksum ^= b;
+}
+
+static void flush_run(void) {
+    if (run) {
+        put(run - 1);
+        run = 0;
+    }
+}
+
+static void begin_close(uint8_t final_status) {
+    closing = 1;
+    close_status = final_status;
+    header_step = 0;
+}
+
+/* Write at most one pending byte: queued data first, then the header with
+ * the magic byte last. Returns 1 while work remains. */
+static uint8_t drain_step(void) {
+    if (closing && run && q_count < SESSION_REC_QUEUE) flush_run();
+    if (q_count) {
+        if (mk312bt_eeprom_write_byte_nb(EEPROM_SESSION_DATA + written, queue[q_head])) {
+            q_head = (q_head + 1) & (SESSION_REC_QUEUE - 1);
+            q_count--;
+            written++;
+        }
+        return 1;
+    }
+    if (!closing) return 0;
+
+    uint8_t field = (header_step + 1) & 3;     /* 1, 2, 3, then magic */
+    uint8_t value;
+    switch (field) {
+        case 1:  value = SESSION_REC_TICKS_PER_FRAME; break;
+        case 2:  value = used; break;
+        case 3:  value = checksum; break;
+        default: value = SESSION_MAGIC; break;
+    }
+    if (mk312bt_eeprom_write_byte_nb(EEPROM_SESSION_BASE + field, value)) {
+        if (++header_step == 4) {
+            closing = 0;
+            valid = (used != 0);
+            status = close_status;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void encode_frame(const uint8_t *f) {
+    uint8_t mask = 0, n = 0, small = 1;
+
+    for (uint8_t i = 0; i < FRAME_VALUES; i++) {
+        if (f[i] != frame[i]) {
+            int8_t d = (int8_t)(f[i] - frame[i]);
+            mask |= (uint8_t)(1 << i);
+            n++;
+            if (d < -8 || d > 7) small = 0;
+        }
+    }
+
+    if (mask) {
+        uint8_t need = (run ? 1 : 0) + 1 + (small ? (uint8_t)((n + 1) >> 1) : n);
+
+        /* Keep one byte spare so a final repeat token always fits */
+        if ((uint16_t)used + need >= SESSION_DATA_SIZE) {
+            begin_close(SESSION_REC_FULL);
+            return;
+        }
+        if (need <= SESSION_REC_QUEUE - q_count) {
+            flush_run();
+            put((small ? TOK_DELTA : TOK_ABSOLUTE) | mask);
+            if (small) {
+                uint8_t packed = 0, half = 0;
+                for (uint8_t i = 0; i < FRAME_VALUES; i++) {
+                    if (!(mask & (1 << i))) continue;
+                    uint8_t nib = (uint8_t)(f[i] - frame[i]) & 0x0F;
+                    if (half) {
+                        put(packed | (uint8_t)(nib << 4));
+                        half = 0;
+                    } else {
+                        packed = nib;
+                        half = 1;
+                    }
+                }
+                if (half) put(packed);
+            } else {
+                for (uint8_t i = 0; i < FRAME_VALUES; i++) {
+                    if (mask & (1 << i)) put(f[i]);
+                }
+            }
+            memcpy(frame, f, FRAME_VALUES);
+            return;
+        }
+        /* Queue full: fall through and code a repeat */
+    }
+
+    if (++run == RUN_MAX) {
+        if ((uint16_t)used + 1 >= SESSION_DATA_SIZE) begin_close(SESSION_REC_FULL);
+        else flush_run();
+    }
+}
+
+void session_rec_start(void) {
+    if (status == SESSION_REC_RUNNING) return;
+
+    /* Invalidate first: a power cut mid-recording leaves no valid header */
+    mk312bt_eeprom_write_byte(EEPROM_SESSION_BASE, 0xFF);
+    valid = 0;
+
+    memset(frame, 0, FRAME_VALUES);
+    run = 0;
+    used = 0;
+    written = 0;
+    checksum = 0;
+    q_head = 0;
+    q_count = 0;
+    closing = 0;
+    tick_div = 0;
+    status = SESSION_REC_RUNNING;
+}
+
+uint8_t session_rec_stop(void) {
+    if (status != SESSION_REC_RUNNING) return status;
+    if (!closing) begin_close(SESSION_REC_SAVED);
+    while (drain_step()) {
+        wdt_reset();
+    }
+    return status;
+}
+
+void session_rec_tick(void) {
+    if (status != SESSION_REC_RUNNING) return;
+
+    drain_step();
+    if (closing) return;
+
+    if (tick_div) {
+        tick_div--;
+        return;
+    }
+    tick_div = SESSION_REC_TICKS_PER_FRAME - 1;
+
+    uint8_t f[FRAME_VALUES];
+    f[0] = effective_intensity(&channel_a);
+    f[1] = channel_a.freq_value;
+    f[2] = channel_a.width_value;
+    f[3] = effective_intensity(&channel_b);
+    f[4] = channel_b.freq_value;
+    f[5] = channel_b.width_value;
+    encode_frame(f);
+}
+
+/* ---- Playback ---- */
+
+static uint8_t next_byte(void) {
+    if (play_pos >= play_len) return 0;
+    return mk312bt_eeprom_read_byte(EEPROM_SESSION_DATA + play_pos++);
+}
+
+static void decode_frame(void) {
+    if (play_rep) {
+        play_rep--;
+        return;
+    }
+    if (play_pos >= play_len) {
+        play_pos = 0;
+        memset(frame, 0, FRAME_VALUES);
+    }
+
+    uint8_t tok = next_byte();
+    if (!(tok & TOK_DELTA)) {
+        play_rep = tok;         /* This frame is the first of tok + 1 */
+        return;
+    }
+
+    uint8_t packed = 0, half = 0;
+    for (uint8_t i = 0; i < FRAME_VALUES; i++) {
+        if (!(tok & (1 << i))) continue;
+        if ((tok & TOK_ABSOLUTE) == TOK_ABSOLUTE) {
+            frame[i] = next_byte();
+        } else {
+            if (!half) {
+                packed = next_byte();
+                half = 2;
+            }
+            int8_t d = (int8_t)(packed & 0x0F);
+            if (d & 0x08) d -= 16;
+            frame[i] += (uint8_t)d;
+            packed >>= 4;
+            half--;
+        }
+    }
+}
+
+static void apply_channel(ChannelBlock *ch, const uint8_t *f) {
+    ch->intensity_value = f[0];
+    ch->freq_value = f[1];
+    ch->width_value = f[2];
+    if (f[0]) ch->gate_value |= GATE_ON_BIT;
+    else      ch->gate_value &= ~GATE_ON_BIT;
+}
+
+static void hold_channel(ChannelBlock *ch) {
+    ch->ramp_value = 0xFF;
+    ch->ramp_select = SEL_TIMER_NONE;
+    ch->intensity_select = SEL_TIMER_NONE;
+    ch->freq_select = SEL_TIMER_NONE;
+    ch->width_select = SEL_TIMER_NONE;
+    ch->gate_select = SEL_TIMER_NONE;
+    ch->next_module_select = SEL_TIMER_NONE;
+    ch->gate_value = GATE_POL_BIPHASIC;
+}
+
+void session_play_start(void) {
+    session_rec_stop();
+
+    hold_channel(&channel_a);
+    hold_channel(&channel_b);
+
+    play_len = valid ? mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE + 2) : 0;
+    play_div = valid ? mk312bt_eeprom_read_byte(EEPROM_SESSION_BASE + 1) : 1;
+    play_pos = 0;
+    play_rep = 0;
+    tick_div = 0;
+    memset(frame, 0, FRAME_VALUES);
+}
+
+void session_play_tick(void) {
+    if (!play_len) return;
+    if (tick_div) {
+        tick_div--;
+        return;
+    }
+    tick_div = play_div - 1;
+
+    decode_frame();
+    apply_channel(&channel_a, &frame[0]);
+    apply_channel(&channel_b, &frame[3]);
+}
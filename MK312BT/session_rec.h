@@ -0,0 +1,70 @@
+/*
+ * session_rec.h - Live Session Recorder and Session Mode Playback
+ *
+ * Records the trajectories a session actually produced (per channel:
+ * effective intensity, frequency and width) at a reduced rate and stores
+ * them delta/RLE-compressed in the EEPROM space after the user program
+ * slots. MODE_SESSION plays the recording back in a loop.
+ *
+ * EEPROM layout (EEPROM_SESSION_BASE):
+ *   [0]    SESSION_MAGIC (0xE5) — written last, so an interrupted
+ *          recording never reads back as valid
+ *   [1]    engine ticks per frame
+ *   [2]    data length in bytes
+ *   [3]    XOR checksum of the data
+ *   [4..]  token stream, up to SESSION_DATA_SIZE bytes
+ *
+ * A frame is 6 values: intensity A, freq A, width A, intensity B, freq B,
+ * width B (bits 0..5 of the masks below). Intensity is ramp-scaled and
+ * reads 0 while the channel's gate is off. Tokens:
+ *   0x00-0x7F        previous frame repeated (n + 1) times
+ *   0x80 | mask      changed values as signed 4-bit deltas, two per byte,
+ *                    low nibble first (odd count: high nibble unused)
+ *   0xC0 | mask      changed values as absolute bytes
+ * Decoding starts from an all-zero frame.
+ *
+ * The level pots stay live during playback: they scale the DAC exactly as
+ * in any other mode, so a recording can never exceed the current setting.
+ */
+
+#ifndef SESSION_REC_H
+#define SESSION_REC_H
+
+#include <stdint.h>
+#include "eeprom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SESSION_MAGIC           0xE5
+#define SESSION_DATA_SIZE       (EEPROM_SESSION_END - EEPROM_SESSION_DATA)
+
+/* Stop reasons returned by session_rec_stop() / session_rec_status() */
+#define SESSION_REC_IDLE        0
+#define SESSION_REC_RUNNING     1
+#define SESSION_REC_SAVED       2
+#define SESSION_REC_FULL        3   /* Stopped automatically, data kept */
+
+/* Read the stored header; call once at startup after the EEPROM is ready */
+void    session_rec_init(void);
+uint8_t session_rec_is_valid(void);
+
+/* Recording. session_rec_tick() is called once per engine tick while the
+ * output runs; it samples every SESSION_REC_TICKS_PER_FRAME ticks and
+ * starts at most one EEPROM byte write (non-blocking) per call. */
+void    session_rec_start(void);
+uint8_t session_rec_stop(void);     /* Flushes and commits; returns SAVED/IDLE */
+void    session_rec_tick(void);
+uint8_t session_rec_status(void);
+uint8_t session_rec_bytes_used(void);
+
+/* Playback for MODE_SESSION, driven by the mode dispatcher */
+void    session_play_start(void);
+void    session_play_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
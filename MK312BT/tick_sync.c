@@ -0,0 +1,188 @@
+/*
+ * tick_sync.c - Engine Tick Schedule and Cross-Box Synchronization
+ *
+ * The schedule keeps the deadline of the next tick in micros() time and
+ * adds TICK_SYNC_PERIOD_US plus the trim after every tick, so loop jitter
+ * does not accumulate. Ticks owed after a short stall are caught up one
+ * per loop pass; after a long one the schedule re-anchors and the skipped
+ * ticks are added to the sync time (and, once locked, the engine phase),
+ * so the phase the host locked stays valid. Sub-ticks hang off the tick
+ * that was just due, so they follow the trim. They are never owed: the
+ * ones a slow loop pass missed are folded into the next sub-tick or tick
+ * (tick_sync_slots()), which therefore always runs on time.
+ *
+ * The servo runs only on SYNC_CTRL writes. Per APPLY, with e = ref - latch
+ * (1/256 tick) over a host interval of n ticks, e * PERIOD / n is the trim
+ * that would cancel e within one interval. Half of it is applied as phase
+ * correction for the next n ticks (so a late host does not over-correct),
+ * a sixteenth is integrated into the frequency trim that absorbs the
+ * crystal offset. With the one-interval
+ * delay of the latch/apply pipeline this settles in about ten rounds.
+ *
+ * The latched sync time and the applied trim live only in their read-only
+ * registers (tick_sync_regs.latch / .trim). A sub-tick deadline is never
+ * more than one tick ahead of micros(), so it is kept as the low 16 bits.
+ */
+
+#include "tick_sync.h"
+#include "param_engine.h"
+
+extern unsigned long micros(void);
+
+tick_sync_regs_t tick_sync_regs;
+uint8_t tick_sync_rate;
+
+static uint16_t next_sub_us;        /* Deadline of the next sub-tick, low 16 bits */
+static uint8_t  sub_left;           /* Sub-ticks still owed this tick */
+static uint8_t  sub_shift;          /* tick_sync_rate latched at the tick */
+static uint8_t  slots;              /* Sub-tick slots the last due covered */
+
+static unsigned long next_tick_us;  /* Deadline of the next tick */
+static uint32_t sync_ticks;         /* Ticks since power-on, plus steps */
+static int16_t  trim_freq;          /* Integrated crystal correction */
+static int16_t  trim_phase;         /* Slew for phase_ticks ticks */
+static uint16_t phase_ticks;
+static int16_t  trim_acc;           /* Sub-microsecond remainder */
+static uint32_t prev_ref;
+static uint8_t  have_latch;
+
+static void put16(uint8_t *p, int16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static int16_t get16(const uint8_t *p) {
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int16_t clamp_trim(int32_t v) {
+    if (v > TICK_SYNC_TRIM_MAX) return TICK_SYNC_TRIM_MAX;
+    if (v < -TICK_SYNC_TRIM_MAX) return -TICK_SYNC_TRIM_MAX;
+    return (int16_t)v;
+}
+
+/* Sync time now: whole ticks plus the elapsed part of the current one */
+static uint32_t sync_time(void) {
+    int32_t since = (int32_t)(micros() - (next_tick_us - TICK_SYNC_PERIOD_US));
+    if (since < 0) since = 0;
+    if (since >= TICK_SYNC_PERIOD_US) since = TICK_SYNC_PERIOD_US - 1;
+    return (sync_ticks << 8) | (uint8_t)(((uint32_t)since << 8) / TICK_SYNC_PERIOD_US);
+}
+
+/* Move the sync time and the next deadline by e, realign the engine */
+static void step(int32_t e) {
+    int32_t ticks = e >> 8;             /* Floor; the remainder is 0-255 */
+
+    sync_ticks += (uint32_t)ticks;
+    param_engine_set_phase(sync_ticks);
+    next_tick_us -= ((uint32_t)(e & 0xFF) * TICK_SYNC_PERIOD_US) >> 8;
+    trim_phase = 0;
+    phase_ticks = 0;
+    if (tick_sync_regs.steps != 0xFF) tick_sync_regs.steps++;
+    tick_sync_regs.status = TICK_SYNC_LOCKED | TICK_SYNC_STEPPED;
+}
+
+static void apply(void) {
+    uint32_t ref = get32(tick_sync_regs.ref);
+    int32_t e = (int32_t)(ref - get32(tick_sync_regs.latch));
+    uint32_t interval = (ref - prev_ref) >> 8;
+
+    prev_ref = ref;
+    if (!(tick_sync_regs.status & TICK_SYNC_LOCKED) || interval == 0 || interval > 0x7FFF ||
+        e > TICK_SYNC_STEP_LIMIT || e < -TICK_SYNC_STEP_LIMIT) {
+        step(e);
+    } else {
+        int32_t per_tick = e * TICK_SYNC_PERIOD_US / (int32_t)interval;
+        trim_freq = clamp_trim((int32_t)trim_freq - (per_tick >> 4));
+        trim_phase = clamp_trim(-(per_tick >> 1));
+        phase_ticks = (uint16_t)interval;
+        tick_sync_regs.status = TICK_SYNC_LOCKED;
+    }
+    if (e > 32767) e = 32767;
+    if (e < -32768) e = -32768;
+    put16(tick_sync_regs.error, (int16_t)e);
+    put16(tick_sync_regs.trim, clamp_trim((int32_t)trim_freq + trim_phase));
+}
+
+void tick_sync_init(void) {
+    next_tick_us = micros() + TICK_SYNC_PERIOD_US;
+}
+
+uint8_t tick_sync_due(void) {
+    unsigned long now = micros();
+    unsigned long late = now - next_tick_us;
+
+    if ((long)late < 0) {
+        if (!sub_left || (int16_t)((uint16_t)now - next_sub_us) < 0) return 0;
+        slots = 0;
+        do {
+            slots++;
+            next_sub_us += TICK_SYNC_PERIOD_US >> sub_shift;
+        } while (--sub_left && (int16_t)((uint16_t)now - next_sub_us) >= 0);
+        return TICK_SYNC_SUB;
+    }
+    if (late >= (unsigned long)TICK_SYNC_CATCHUP_MAX * TICK_SYNC_PERIOD_US) {
+        uint32_t owed = late / TICK_SYNC_PERIOD_US;
+        next_tick_us += owed * TICK_SYNC_PERIOD_US;
+        sync_ticks += owed;
+        if (tick_sync_regs.status & TICK_SYNC_LOCKED) param_engine_set_phase(sync_ticks);
+    }
+
+    slots = sub_left + 1;
+    sub_shift = (tick_sync_rate > TICK_SYNC_RATE_MAX) ? TICK_SYNC_RATE_MAX : tick_sync_rate;
+    sub_left = (1 << sub_shift) - 1;
+    next_sub_us = (uint16_t)next_tick_us + (TICK_SYNC_PERIOD_US >> sub_shift);
+
+    trim_acc += get16(tick_sync_regs.trim);
+    int8_t whole = (int8_t)(trim_acc >> 8);
+    trim_acc -= (int16_t)whole * 256;
+    next_tick_us += TICK_SYNC_PERIOD_US + whole;
+    sync_ticks++;
+
+    if (phase_ticks && --phase_ticks == 0) {
+        trim_phase = 0;
+        put16(tick_sync_regs.trim, trim_freq);
+    }
+    return TICK_SYNC_TICK;
+}
+
+void tick_sync_control(uint8_t ctrl) {
+    if (ctrl & TICK_SYNC_RESET) {
+        trim_freq = trim_phase = 0;
+        phase_ticks = 0;
+        have_latch = 0;
+        tick_sync_regs.status = 0;
+        tick_sync_regs.steps = 0;
+        put16(tick_sync_regs.error, 0);
+        put16(tick_sync_regs.trim, 0);
+    }
+    if ((ctrl & TICK_SYNC_APPLY) && have_latch) apply();
+    if (ctrl & TICK_SYNC_LATCH) {
+        put32(tick_sync_regs.latch, sync_time());
+        have_latch = 1;
+    }
+}
+
+uint8_t tick_sync_phase(void) {
+    return (tick_sync_regs.status & TICK_SYNC_LOCKED) ? (uint8_t)sync_ticks : 0;
+}
+
+uint8_t tick_sync_shift(void) {
+    return sub_shift;
+}
+
+uint8_t tick_sync_slots(void) {
+    return slots;
+}
@@ -0,0 +1,83 @@
+/*
+ * tick_sync.h - Engine Tick Schedule and Cross-Box Synchronization
+ *
+ * The parameter engine ticks every TICK_SYNC_PERIOD_US on a microsecond
+ * schedule. The period can be trimmed in 1/256 us steps so that several
+ * boxes driven by one host keep their engine ticks (and with them the
+ * tick_counter phase that gates the 30 Hz / 1 Hz timers) aligned.
+ *
+ * Sync time is the engine tick count plus an offset, in 1/256 tick units
+ * (24.8 fixed point, wrapping). The host exchanges it over serial:
+ *
+ *   1. Write SYNC_CTRL = LATCH: the box stores its sync time at the moment
+ *      the frame is executed in SYNC_LATCH. The host notes when the reply
+ *      arrived and converts that to its own clock in the same units.
+ *   2. Write SYNC_REF (host time of that latch) and SYNC_CTRL = APPLY |
+ *      LATCH in one frame: the box compares REF with the previous latch
+ *      and latches again for the next round.
+ *
+ * An error above TICK_SYNC_STEP_LIMIT (or the first APPLY) steps the sync
+ * time and the engine counters; smaller errors are slewed by a PI loop on
+ * the period trim. See SERIAL_PROTOCOL.md, "Tick Synchronization".
+ *
+ * ENGINE_RATE (0x439F) splits every tick into 1 << rate sub-ticks, evenly
+ * spaced after it: 250, 500 or 1000 Hz. Only the ticks count towards the
+ * sync time and the engine timers; sub-ticks just move the swept values
+ * between steps (param_engine_subtick()). The rate is latched at each tick.
+ * A loop pass slower than a sub-tick merges sub-ticks instead of delaying
+ * the next tick, so the effective update rate is capped by the loop.
+ */
+
+#ifndef TICK_SYNC_H
+#define TICK_SYNC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TICK_SYNC_PERIOD_US   4000   /* Nominal engine tick (250 Hz) */
+#define TICK_SYNC_STEP_LIMIT  (8 * 256)  /* Errors above 8 ticks are stepped */
+#define TICK_SYNC_TRIM_MAX    1024   /* 4 us per tick = 1000 ppm */
+#define TICK_SYNC_CATCHUP_MAX 64     /* Ticks owed before the schedule re-anchors */
+#define TICK_SYNC_RATE_MAX    2      /* ENGINE_RATE: 4 sub-ticks per tick (1000 Hz) */
+
+/* tick_sync_due() results */
+#define TICK_SYNC_TICK        1      /* Engine tick */
+#define TICK_SYNC_SUB         2      /* Sub-tick between two ticks */
+
+/* SYNC_CTRL write bits */
+#define TICK_SYNC_APPLY       0x01   /* Compare SYNC_REF with the last latch */
+#define TICK_SYNC_LATCH       0x02   /* Latch the sync time now */
+#define TICK_SYNC_RESET       0x80   /* Unlock and clear the trim */
+
+/* SYNC_CTRL read bits */
+#define TICK_SYNC_LOCKED      0x01   /* At least one APPLY since reset */
+#define TICK_SYNC_STEPPED     0x02   /* Last APPLY stepped instead of slewing */
+
+/* Serial registers 0x43A0-0x43AD (register_map.def), little-endian */
+typedef struct {
+    uint8_t ref[4];         /* Host sync time of the last latch (W) */
+    uint8_t latch[4];       /* Box sync time at the last latch */
+    uint8_t error[2];       /* Last APPLY: ref - latch, 1/256 tick, saturated */
+    uint8_t trim[2];        /* Period trim, 1/256 us per tick */
+    uint8_t steps;          /* Steps since reset (saturates) */
+    uint8_t status;         /* TICK_SYNC_LOCKED | TICK_SYNC_STEPPED */
+} tick_sync_regs_t;
+
+extern tick_sync_regs_t tick_sync_regs;
+extern uint8_t tick_sync_rate;       /* ENGINE_RATE, 0-TICK_SYNC_RATE_MAX (R/W) */
+
+void tick_sync_init(void);           /* Start the schedule one period from now */
+uint8_t tick_sync_due(void);         /* TICK_SYNC_TICK / _SUB when due, else 0 (call every loop) */
+void tick_sync_control(uint8_t ctrl);  /* SYNC_CTRL write */
+uint8_t tick_sync_phase(void);       /* Low byte of the sync tick, 0 while unlocked */
+uint8_t tick_sync_shift(void);       /* Rate latched at the last tick */
+uint8_t tick_sync_slots(void);       /* Sub-tick slots the last due covered, 1-4 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,8 +1,12 @@
 /*
  * user_programs.c - User-programmable bytecode module storage
  *
- * Maintains a RAM cache of 7 user program slots.  Each slot is
- * USER_PROG_SLOT_SIZE (32) bytes loaded from EEPROM at startup.
+ * The 7 user program slots stay in EEPROM, USER_PROG_SLOT_SIZE (32)
+ * bytes each; there is no RAM copy. A slot only runs when its mode is
+ * selected, and an EEPROM byte reads in 4 cycles, so a RAM cache of all
+ * slots (224 bytes, a fifth of the SRAM) bought nothing. A read waits
+ * for an EEPROM write in progress (at most ~8.5 ms, once per mode
+ * selection).
  *
  * Execution uses the same SET opcode interpreter as execute_module()
  * in mode_dispatcher.c.  Only SET instructions (0x80+) are supported
@@ -13,36 +17,31 @@
 #include "user_programs.h"
 #include "eeprom.h"
 #include "channel_mem.h"
-#include <string.h>
 
-static uint8_t prog_cache[USER_PROG_SLOT_COUNT][USER_PROG_SLOT_SIZE];
-
-void user_programs_init(void) {
-    for (uint8_t s = 0; s < USER_PROG_SLOT_COUNT; s++) {
-        eeprom_load_user_prog(s, prog_cache[s]);
-    }
+static uint16_t slot_address(uint8_t slot) {
+    return EEPROM_USER_PROG_BASE + (uint16_t)slot * USER_PROG_SLOT_SIZE;
 }
 
 uint8_t user_prog_is_valid(uint8_t slot) {
     if (slot >= USER_PROG_SLOT_COUNT) return 0;
-    return (prog_cache[slot][0] == USER_PROG_MAGIC) ? 1 : 0;
+    return (mk312bt_eeprom_read_byte(slot_address(slot)) == USER_PROG_MAGIC) ? 1 : 0;
 }
 
 void user_prog_execute(uint8_t slot) {
     if (!user_prog_is_valid(slot)) return;
 
-    const uint8_t *pc = &prog_cache[slot][1];
-    const uint8_t *end = &prog_cache[slot][USER_PROG_SLOT_SIZE];
+    uint16_t pc = slot_address(slot) + 1;
+    uint16_t end = slot_address(slot) + USER_PROG_SLOT_SIZE;
 
     while (pc < end) {
-        uint8_t opcode = *pc;
+        uint8_t opcode = mk312bt_eeprom_read_byte(pc);
 
         if (opcode == 0x00) break;
 
         if (opcode & 0x80) {
             if (pc + 1 >= end) break;
             uint8_t offset = opcode & 0x3F;
-            uint8_t value  = *(pc + 1);
+            uint8_t value  = mk312bt_eeprom_read_byte(pc + 1);
 
             if (opcode & 0x40) {
                 uint8_t *reg = channel_get_reg_ptr(0x180 + offset);
@@ -67,20 +66,15 @@ void user_prog_execute(uint8_t slot) {
 
 void user_prog_write(uint8_t slot, const uint8_t *buf) {
     if (slot >= USER_PROG_SLOT_COUNT) return;
-    memcpy(prog_cache[slot], buf, USER_PROG_SLOT_SIZE);
-    prog_cache[slot][USER_PROG_SLOT_SIZE - 1] = 0x00;
-    eeprom_save_user_prog(slot, prog_cache[slot]);
+    eeprom_save_user_prog(slot, buf);
 }
 
 void user_prog_erase(uint8_t slot) {
     if (slot >= USER_PROG_SLOT_COUNT) return;
-    memset(prog_cache[slot], 0xFF, USER_PROG_SLOT_SIZE);
-    prog_cache[slot][0] = 0xFF;
     eeprom_erase_user_prog(slot);
 }
 
 uint8_t user_prog_read(uint8_t slot, uint8_t *buf) {
     if (slot >= USER_PROG_SLOT_COUNT) return 0;
-    memcpy(buf, prog_cache[slot], USER_PROG_SLOT_SIZE);
-    return (buf[0] == USER_PROG_MAGIC) ? 1 : 0;
+    return eeprom_load_user_prog(slot, buf);
 }
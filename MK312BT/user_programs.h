@@ -1,9 +1,9 @@
 /*
  * user_programs.h - User-programmable bytecode module storage
  *
- * Provides a RAM cache of the 7 user program slots read from EEPROM.
+ * The 7 user program slots live in EEPROM only (no RAM copy).
  * The dispatcher calls user_prog_execute() to run a slot's bytecode
- * exactly like the built-in execute_module() but from EEPROM/RAM.
+ * exactly like the built-in execute_module() but from EEPROM.
  *
  * Each slot is USER_PROG_SLOT_SIZE bytes:
  *   [0]      USER_PROG_MAGIC (0xE3) — validity marker
@@ -27,10 +27,6 @@
 extern "C" {
 #endif
 
-/* Load all user program slots from EEPROM into RAM cache.
- * Call once at startup (after eeprom drivers are ready). */
-void user_programs_init(void);
-
 /* Execute user program slot (0-6) against channel registers.
  * Uses channel_a.apply_channel routing (same as built-in modules).
  * Does nothing if the slot has no valid program. */
@@ -43,7 +39,7 @@ uint8_t user_prog_is_valid(uint8_t slot);
  * buf must be USER_PROG_SLOT_SIZE bytes; caller sets buf[0]=USER_PROG_MAGIC. */
 void user_prog_write(uint8_t slot, const uint8_t *buf);
 
-/* Erase a slot in RAM cache and EEPROM. */
+/* Erase a slot in EEPROM. */
 void user_prog_erase(uint8_t slot);
 
 /* Read current slot contents into buf (USER_PROG_SLOT_SIZE bytes).